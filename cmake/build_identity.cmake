@@ -0,0 +1,26 @@
+# Write ${OUTPUT}, a header defining GLTF_INSIGHT_SOURCES_HASH: a hash of every
+# file of ${SOURCE_DIR}/src and ${SOURCE_DIR}/shaders. Run as a script
+# (cmake -P) at every build, so the cached data keyed on it is discarded as
+# soon as the decoders change, committed or not. The header is only rewritten
+# when the hash changes, an unchanged tree doesn't rebuild anything
+file(GLOB IDENTITY_SOURCES ${SOURCE_DIR}/src/* ${SOURCE_DIR}/shaders/*)
+list(SORT IDENTITY_SOURCES)
+
+set(IDENTITY "")
+foreach(IDENTITY_SOURCE ${IDENTITY_SOURCES})
+  file(SHA1 ${IDENTITY_SOURCE} IDENTITY_SOURCE_HASH)
+  file(RELATIVE_PATH IDENTITY_SOURCE_NAME ${SOURCE_DIR} ${IDENTITY_SOURCE})
+  set(IDENTITY "${IDENTITY}${IDENTITY_SOURCE_NAME} ${IDENTITY_SOURCE_HASH}\n")
+endforeach()
+string(SHA1 IDENTITY_HASH "${IDENTITY}")
+
+set(HEADER "#pragma once\n\n// Generated by cmake/build_identity.cmake\n")
+set(HEADER "${HEADER}#define GLTF_INSIGHT_SOURCES_HASH \"${IDENTITY_HASH}\"\n")
+
+set(PREVIOUS_HEADER "")
+if(EXISTS ${OUTPUT})
+  file(READ ${OUTPUT} PREVIOUS_HEADER)
+endif()
+if(NOT HEADER STREQUAL PREVIOUS_HEADER)
+  file(WRITE ${OUTPUT} "${HEADER}")
+endif()
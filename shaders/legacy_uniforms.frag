@@ -0,0 +1,39 @@
+in vec3 interpolated_normal;
+in float selected;
+
+out vec4 output_color;
+
+uniform vec3 camera_position;
+uniform vec3 light_direction;
+uniform vec3 light_color;
+uniform vec4 debug_color;
+uniform int use_ibl;
+uniform sampler2D normal_texture;
+uniform sampler2D occlusion_texture;
+uniform sampler2D emissive_texture;
+uniform vec3 emissive_factor;
+uniform int alpha_mode;
+uniform float alpha_cutoff;
+uniform sampler2D base_color_texture;
+uniform sampler2D metallic_roughness_texture;
+uniform vec4 base_color_factor;
+uniform float metallic_factor;
+uniform float roughness_factor;
+
+void main()
+{
+  vec2 uv = interpolated_normal.xy;
+  vec4 color = base_color_factor * texture(base_color_texture, uv);
+  color += selected * debug_color;
+  color.rgb += light_color * texture(occlusion_texture, uv).r
+             * max(dot(interpolated_normal, light_direction), 0.0f);
+  color.rgb += emissive_factor * texture(emissive_texture, uv).rgb;
+  color.rgb += camera_position * texture(normal_texture, uv).rgb;
+  color.rgb *= texture(metallic_roughness_texture, uv).rgb
+             * vec3(1.0f, roughness_factor, metallic_factor);
+  if (use_ibl != 0)
+    color.rgb *= 0.5f;
+  if (alpha_mode == 1 && color.a < alpha_cutoff)
+    discard;
+  output_color = color;
+}
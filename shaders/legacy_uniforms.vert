@@ -0,0 +1,29 @@
+#define NB_JOINTS $nb_joints
+
+layout (location = 0) in vec3 input_position;
+
+//Per draw uniforms of the shaders before the uniform blocks and the joint
+//palette, only used to time how they were updated (see
+//benchmark_uniform_updates). All of them are used so none is optimized out
+uniform mat4 model;
+uniform mat4 mvp;
+uniform mat3 normal;
+uniform int active_joint;
+uniform vec3 active_vertex;
+#if NB_JOINTS > 0
+uniform mat4 joint_matrix[NB_JOINTS];
+#endif
+
+out vec3 interpolated_normal;
+out float selected;
+
+void main()
+{
+  vec4 position = vec4(input_position, 1.0f);
+#if NB_JOINTS > 0
+  position = joint_matrix[active_joint] * position;
+#endif
+  gl_Position = mvp * model * position;
+  interpolated_normal = normal * input_position;
+  selected = distance(input_position, active_vertex);
+}
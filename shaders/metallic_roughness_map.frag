@@ -1,7 +1,14 @@
 in vec2 interpolated_uv;
 uniform sampler2D metallic_roughness_texture;
-uniform float metallic_factor;
-uniform float roughness_factor;
+layout(std140) uniform material_block
+{
+  vec4 base_color_factor;
+  vec3 emissive_factor;
+  float metallic_factor;
+  float roughness_factor;
+  float alpha_cutoff;
+  int alpha_mode;
+};
 out vec4 output_color;
 
 void main()
@@ -5,15 +5,23 @@ layout (location = 2) in vec2 input_uv;
 layout (location = 3) in vec4 input_colors;
 layout (location = 4) in vec4 input_joints;
 layout (location = 5) in vec4 input_weights;
+layout (location = 6) in vec4 input_tangent;
+layout (location = 7) in mat4 instance_model;
+layout (location = 11) in mat3 instance_normal;
 
 uniform mat4 model;
 uniform mat4 mvp;
 uniform mat3 normal;
+// Instanced draws take the transforms of each instance from the per instance
+// inputs, and only share the view and projection
+uniform bool instanced;
+uniform mat4 view_projection;
 uniform int active_joint;
 
 uniform vec3 active_vertex;
 
 out vec3 interpolated_normal;
+out vec4 interpolated_tangent;
 out vec3 fragment_world_position;
 out vec4 interpolated_colors;
 
@@ -66,9 +74,16 @@ vec4 weight_color()
 
 void main()
 {
-  gl_Position = mvp * vec4(input_position, 1.0f);
-  interpolated_normal = normal * normalize(input_normal);
-  fragment_world_position = vec3(model * vec4(input_position, 1.0f));
+  mat4 model_matrix = instanced ? instance_model : model;
+  mat3 normal_matrix = instanced ? instance_normal : normal;
+
+  if(instanced)
+    gl_Position = view_projection * model_matrix * vec4(input_position, 1.0f);
+  else
+    gl_Position = mvp * vec4(input_position, 1.0f);
+  interpolated_normal = normal_matrix * normalize(input_normal);
+  interpolated_tangent = vec4(mat3(model_matrix) * input_tangent.xyz, input_tangent.w);
+  fragment_world_position = vec3(model_matrix * vec4(input_position, 1.0f));
   
   interpolated_uv = input_uv;
   interpolated_weights = weight_color();
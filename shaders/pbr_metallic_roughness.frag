@@ -6,6 +6,7 @@ out vec4 output_color;
 in float selected;
 
 in vec3 interpolated_normal;
+in vec4 interpolated_tangent;
 in vec3 fragment_world_position;
 in vec2 interpolated_uv;
 in vec4 interpolated_weights;
@@ -21,18 +22,25 @@ uniform sampler2D metallic_roughness_texture;
 //TODO BRDF lookup table here
 uniform sampler2D brdf_lut;
 
-uniform vec4 base_color_factor;
-uniform float metallic_factor;
-uniform float roughness_factor;
-uniform vec3 emissive_factor;
-uniform int alpha_mode;
-uniform float alpha_cutoff;
-
-uniform vec3 camera_position;
-uniform vec3 light_direction;
-uniform vec3 light_color;
+layout(std140) uniform material_block
+{
+  vec4 base_color_factor;
+  vec3 emissive_factor;
+  float metallic_factor;
+  float roughness_factor;
+  float alpha_cutoff;
+  int alpha_mode;
+};
 
-uniform vec4 highlight_color;
+layout(std140) uniform frame_block
+{
+  vec4 highlight_color;
+  vec3 camera_position;
+  bool use_ibl;
+  vec3 light_direction;
+  bool dual_quaternion_skinning;
+  vec3 light_color;
+};
 
 
 //To hold the data during computation
@@ -55,34 +63,18 @@ struct pbr_info
 const float PI =  3.141592653589793;
 const float min_roughness = 0.04;
 
-mat3 cotangent_frame(vec3 N, vec3 p, vec2 uv)
+// Perturb normal with the tangent frame of the vertex. Submeshes without a
+// normal map have no tangents, and keep their normal
+vec3 perturb_normal(vec3 N)
 {
+	vec3 T = interpolated_tangent.xyz - N * dot(N, interpolated_tangent.xyz);
+	if(dot(T, T) < 1e-8f)
+		return N;
 
- vec3 dp1 = dFdx( p );
- vec3 dp2 = dFdy( p );
- vec2 duv1 = dFdx( uv );
- vec2 duv2 = dFdy( uv );
-
- vec3 dp2perp = cross( dp2, N );
- vec3 dp1perp = cross( N, dp1 );
-
-
- vec3 T = dp2perp * duv1.x + dp1perp * duv2.x;
- vec3 B = dp2perp * duv1.y + dp1perp * duv2.y;
-
- float invmax = inversesqrt(max(dot(T,T), dot(B,B)));
- return mat3( T * invmax, B * invmax, N );
-
-}
-
-// Perturb normal, see http://www.thetenthplanet.de/archives/1180
-vec3 perturb_normal(vec3 N, vec3 V)
-{
+	T = normalize(T);
+	vec3 B = cross(N, T) * (interpolated_tangent.w < 0.f ? -1.f : 1.f);
 	vec3 sampled_normal_map = texture(normal_texture, interpolated_uv).rgb * 255.f/127.f - 128.f/127.f;
-	sampled_normal_map.y = - sampled_normal_map.y;
-
-	mat3 TBN = cotangent_frame(N, -V, interpolated_uv);
-	return normalize(TBN * sampled_normal_map);
+	return normalize(mat3(T, B, N) * sampled_normal_map);
 }
 
 //TODO divide or don't divide by pi?
@@ -120,7 +112,6 @@ float microfaced_distribution(pbr_info pbr_inputs)
 
 
 //IBL / ENV LIGHTING 
-uniform bool use_ibl;
 uniform float gamma;
 uniform float exposure;
 
@@ -214,7 +205,7 @@ void main()
 
 	//vec3 n = normalize(interpolated_normal);
 	vec3 v = normalize(camera_position - fragment_world_position);
-	vec3 n = perturb_normal(normalize(interpolated_normal), v); //TODO fix my tangent space for normal mapping!
+	vec3 n = perturb_normal(normalize(interpolated_normal));
 	vec3 l = normalize(-light_direction);
 	vec3 h = normalize(l+v);
 	vec3 reflection = -normalize(reflect(v, n));
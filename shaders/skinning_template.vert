@@ -6,6 +6,7 @@ layout (location = 2) in vec2 input_uv;
 layout (location = 3) in vec4 input_colors;
 layout (location = 4) in vec4 input_joints;
 layout (location = 5) in vec4 input_weights;
+layout (location = 6) in vec4 input_tangent;
 
 uniform mat4 model;
 uniform mat4 mvp;
@@ -13,12 +14,31 @@ uniform mat3 normal;
 uniform int active_joint;
 uniform vec3 active_vertex;
 
-//TODO this array of matrices can represent too much uniform data for some rigging schemes.
-//Should replace this with another skinning method (dual quaternion skinning?) to prevent that.
-uniform mat4 joint_matrix[$nb_joints];
-//uniform mat4 joint_matrix[4];
+//Joint transforms of every skinned mesh of the frame, the ones of this mesh
+//start at row joint_palette_offset. With linear blend skinning each joint is
+//stored as the 3 first rows of its matrix, the last one is always
+//(0, 0, 0, 1). With dual quaternion skinning each joint is 2 rows, the real
+//then the dual part. WebGL has no buffer textures, the rows are in a 2D
+//texture 1024 texels wide there (see joint_palette)
+#ifdef GL_ES
+uniform highp sampler2D joint_palette;
+#else
+uniform samplerBuffer joint_palette;
+#endif
+uniform int joint_palette_offset;
+
+layout(std140) uniform frame_block
+{
+  vec4 highlight_color;
+  vec3 camera_position;
+  bool use_ibl;
+  vec3 light_direction;
+  bool dual_quaternion_skinning;
+  vec3 light_color;
+};
 
 out vec3 interpolated_normal;
+out vec4 interpolated_tangent;
 out vec3 fragment_world_position;
 out vec4 interpolated_colors;
 
@@ -27,6 +47,71 @@ out vec4 interpolated_weights;
 
 out float selected;
 
+vec4 joint_palette_row(int index)
+{
+#ifdef GL_ES
+  return texelFetch(joint_palette, ivec2(index % 1024, index / 1024), 0);
+#else
+  return texelFetch(joint_palette, index);
+#endif
+}
+
+mat4 joint_matrix(float joint)
+{
+  int first_row = joint_palette_offset + 3 * int(joint);
+  return transpose(mat4(joint_palette_row(first_row),
+                        joint_palette_row(first_row + 1),
+                        joint_palette_row(first_row + 2),
+                        vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+}
+
+//Blend of the joint dual quaternions, with the sign of each one flipped to the
+//side of the first (q and -q are the same rotation), turned into a matrix.
+//It is a rigid transform, so it is also the matrix of the normals
+mat4 dual_quaternion_skin_matrix()
+{
+  int row_x = joint_palette_offset + 2 * int(input_joints.x);
+  int row_y = joint_palette_offset + 2 * int(input_joints.y);
+  int row_z = joint_palette_offset + 2 * int(input_joints.z);
+  int row_w = joint_palette_offset + 2 * int(input_joints.w);
+  vec4 real_x = joint_palette_row(row_x);
+  vec4 real_y = joint_palette_row(row_y);
+  vec4 real_z = joint_palette_row(row_z);
+  vec4 real_w = joint_palette_row(row_w);
+
+  vec4 weights = input_weights;
+  if(dot(real_x, real_y) < 0.0f) weights.y = -weights.y;
+  if(dot(real_x, real_z) < 0.0f) weights.z = -weights.z;
+  if(dot(real_x, real_w) < 0.0f) weights.w = -weights.w;
+
+  vec4 real = weights.x * real_x + weights.y * real_y
+            + weights.z * real_z + weights.w * real_w;
+  vec4 dual = weights.x * joint_palette_row(row_x + 1)
+            + weights.y * joint_palette_row(row_y + 1)
+            + weights.z * joint_palette_row(row_z + 1)
+            + weights.w * joint_palette_row(row_w + 1);
+
+  float norm = length(real);
+  real /= norm;
+  dual /= norm;
+
+  vec3 translation = 2.0f * (real.w * dual.xyz - dual.w * real.xyz
+                             + cross(real.xyz, dual.xyz));
+
+  float x = real.x;
+  float y = real.y;
+  float z = real.z;
+  float w = real.w;
+  return mat4(
+    vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z),
+         2.0f * (x * z - w * y), 0.0f),
+    vec4(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z),
+         2.0f * (y * z + w * x), 0.0f),
+    vec4(2.0f * (x * z + w * y), 2.0f * (y * z - w * x),
+         1.0f - 2.0f * (x * x + y * y), 0.0f),
+    vec4(translation, 1.0f));
+}
+
 vec3 float_to_rgb(float value)
 {
  vec3 color = vec3(0.0f, 0.0f, 0.0f);
@@ -72,17 +157,29 @@ vec4 weight_color()
 void main()
 {
   //compute skinning matrix
-  mat4 skin_matrix =
-    input_weights.x * joint_matrix[int(input_joints.x)]
-  + input_weights.y * joint_matrix[int(input_joints.y)]
-  + input_weights.z * joint_matrix[int(input_joints.z)]
-  + input_weights.w * joint_matrix[int(input_joints.w)];
+  mat4 skin_matrix;
+  mat3 normal_skin_matrix;
+  if(dual_quaternion_skinning)
+  {
+    skin_matrix = dual_quaternion_skin_matrix();
+    normal_skin_matrix = mat3(skin_matrix);
+  }
+  else
+  {
+    skin_matrix =
+      input_weights.x * joint_matrix(input_joints.x)
+    + input_weights.y * joint_matrix(input_joints.y)
+    + input_weights.z * joint_matrix(input_joints.z)
+    + input_weights.w * joint_matrix(input_joints.w);
 
-  mat3 normal_skin_matrix = mat3(transpose(inverse(skin_matrix)));
+    normal_skin_matrix = mat3(transpose(inverse(skin_matrix)));
+  }
   gl_Position = mvp * skin_matrix * vec4(input_position, 1.0f);
   vec3 skinned_normal = normal_skin_matrix * input_normal;
 
   interpolated_normal = normal * normalize(skinned_normal);
+  vec3 skinned_tangent = mat3(skin_matrix) * input_tangent.xyz;
+  interpolated_tangent = vec4(mat3(model) * skinned_tangent, input_tangent.w);
   fragment_world_position = vec3(model * vec4(input_position, 1.0f));
 
   interpolated_uv = input_uv;
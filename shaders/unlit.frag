@@ -8,11 +8,25 @@ in float selected;
 uniform sampler2D base_color_texture;
 uniform sampler2D emissive_texture;
 
-uniform vec3 emissive_factor;
-uniform vec4 base_color_factor;
-uniform int alpha_mode;
-uniform float alpha_cutoff;
-uniform vec4 highlight_color;
+layout(std140) uniform material_block
+{
+  vec4 base_color_factor;
+  vec3 emissive_factor;
+  float metallic_factor;
+  float roughness_factor;
+  float alpha_cutoff;
+  int alpha_mode;
+};
+
+layout(std140) uniform frame_block
+{
+  vec4 highlight_color;
+  vec3 camera_position;
+  bool use_ibl;
+  vec3 light_direction;
+  bool dual_quaternion_skinning;
+  vec3 light_color;
+};
 
 #define ALPHA_OPAQUE 0
 #define ALPHA_MASK 1
@@ -4,7 +4,15 @@ in vec4 interpolated_weights;
 
 out vec4 output_color;
 
-uniform vec4 highlight_color;
+layout(std140) uniform frame_block
+{
+  vec4 highlight_color;
+  vec3 camera_position;
+  bool use_ibl;
+  vec3 light_direction;
+  bool dual_quaternion_skinning;
+  vec3 light_color;
+};
 
 void main()
 {
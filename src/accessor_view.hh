@@ -0,0 +1,410 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "buffer_data.hh"
+#include "tiny_gltf.h"
+
+namespace gltf_insight {
+
+namespace accessor_detail {
+
+/// glTF component type matching a C++ type
+template <typename T>
+struct component_type_of {
+  static constexpr int value = -1;
+};
+template <>
+struct component_type_of<int8_t> {
+  static constexpr int value = TINYGLTF_COMPONENT_TYPE_BYTE;
+};
+template <>
+struct component_type_of<uint8_t> {
+  static constexpr int value = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+};
+template <>
+struct component_type_of<int16_t> {
+  static constexpr int value = TINYGLTF_COMPONENT_TYPE_SHORT;
+};
+template <>
+struct component_type_of<uint16_t> {
+  static constexpr int value = TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+};
+template <>
+struct component_type_of<uint32_t> {
+  static constexpr int value = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+};
+template <>
+struct component_type_of<float> {
+  static constexpr int value = TINYGLTF_COMPONENT_TYPE_FLOAT;
+};
+template <>
+struct component_type_of<double> {
+  static constexpr int value = TINYGLTF_COMPONENT_TYPE_DOUBLE;
+};
+
+/// Normalized integer to float, as defined by the glTF 2.0 specification
+/// (§3.11 "Animations", same rules for vertex attributes)
+template <typename In>
+inline typename std::enable_if<std::is_floating_point<In>::value, float>::type
+normalize(In v) {
+  return float(v);
+}
+
+template <typename In>
+inline typename std::enable_if<std::is_unsigned<In>::value, float>::type
+normalize(In v) {
+  return float(v) / float(std::numeric_limits<In>::max());
+}
+
+template <typename In>
+inline typename std::enable_if<std::is_signed<In>::value &&
+                                   std::is_integral<In>::value,
+                               float>::type
+normalize(In v) {
+  return std::max(float(v) / float(std::numeric_limits<In>::max()), -1.f);
+}
+
+template <typename In, typename Out, bool Normalize>
+struct converter {
+  static Out apply(In v) { return static_cast<Out>(v); }
+};
+
+template <typename In, typename Out>
+struct converter<In, Out, true> {
+  static Out apply(In v) { return static_cast<Out>(normalize(v)); }
+};
+
+/// Read `components` values of type `In` from each of the `count` elements
+/// starting at `source`, and write them converted at the start of each
+/// `output_components` wide element of `output`.
+template <typename In, typename Out, bool Normalize>
+void convert(const unsigned char* source, size_t byte_stride, size_t count,
+             size_t components, Out* output, size_t output_components) {
+  using conv = converter<In, Out, Normalize>;
+
+  // Tightly packed on both sides: this is a flat array conversion
+  if (byte_stride == components * sizeof(In) &&
+      output_components == components) {
+    const size_t nb_values = count * components;
+    if (std::is_same<In, Out>::value && !Normalize) {
+      memcpy(output, source, nb_values * sizeof(Out));
+      return;
+    }
+
+    for (size_t i = 0; i < nb_values; ++i) {
+      In value;
+      memcpy(&value, source + i * sizeof(In), sizeof(In));
+      output[i] = conv::apply(value);
+    }
+    return;
+  }
+
+  for (size_t element = 0; element < count; ++element) {
+    const unsigned char* input = source + element * byte_stride;
+    Out* out = output + element * output_components;
+    for (size_t c = 0; c < components; ++c) {
+      In value;
+      memcpy(&value, input + c * sizeof(In), sizeof(In));
+      out[c] = conv::apply(value);
+    }
+  }
+}
+
+template <typename Out, bool Normalize>
+void convert_from(int component_type, const unsigned char* source,
+                  size_t byte_stride, size_t count, size_t components,
+                  Out* output, size_t output_components) {
+  switch (component_type) {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+      convert<int8_t, Out, Normalize>(source, byte_stride, count, components,
+                                      output, output_components);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      convert<uint8_t, Out, Normalize>(source, byte_stride, count, components,
+                                       output, output_components);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+      convert<int16_t, Out, Normalize>(source, byte_stride, count, components,
+                                       output, output_components);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      convert<uint16_t, Out, Normalize>(source, byte_stride, count, components,
+                                        output, output_components);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_INT:
+      convert<int32_t, Out, Normalize>(source, byte_stride, count, components,
+                                       output, output_components);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+      convert<uint32_t, Out, Normalize>(source, byte_stride, count, components,
+                                        output, output_components);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+      convert<float, Out, Normalize>(source, byte_stride, count, components,
+                                     output, output_components);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_DOUBLE:
+      convert<double, Out, Normalize>(source, byte_stride, count, components,
+                                      output, output_components);
+      break;
+    default:
+      throw std::runtime_error("accessor uses an unknown component type");
+  }
+}
+
+}  // namespace accessor_detail
+
+/// Read-only view over the elements of a glTF accessor. This is the one place
+/// that does the accessor -> bufferView -> buffer pointer arithmetic, and
+/// handles byte stride, component type conversion, normalized integers and
+/// sparse storage. Buffer content is read through `buffers`, the overrides
+/// loaded with `model`. Throws std::runtime_error on malformed accessors.
+class accessor_view {
+ public:
+  accessor_view(const tinygltf::Model& model,
+                const buffer_data::overrides& buffers, int accessor_index)
+      : accessor_view(model, buffers,
+                      model.accessors[size_t(accessor_index)]) {}
+
+  accessor_view(const tinygltf::Model& model,
+                const buffer_data::overrides& buffers,
+                const tinygltf::Accessor& accessor)
+      : model_(model), buffers_(buffers), accessor_(accessor) {
+    component_size_ = size_t(
+        tinygltf::GetComponentSizeInBytes(uint32_t(accessor.componentType)));
+    components_ = size_t(tinygltf::GetTypeSizeInBytes(uint32_t(accessor.type)));
+    normalized_ = accessor.normalized;
+
+    if (component_size_ == 0 || components_ == 0)
+      throw std::runtime_error("accessor has an invalid type");
+
+    // Without a bufferView, the accessor is zero initialized (then usually
+    // patched by sparse data)
+    if (accessor.bufferView < 0) return;
+
+    const auto& buffer_view = model.bufferViews[size_t(accessor.bufferView)];
+    const int stride = accessor.ByteStride(buffer_view);
+    if (stride <= 0)
+      throw std::runtime_error("accessor has an invalid byte stride");
+    byte_stride_ = size_t(stride);
+
+    const size_t byte_length =
+        count() > 0 ? byte_stride_ * (count() - 1) + element_size() : 0;
+    data_ = buffer_view_data(accessor.bufferView, accessor.byteOffset,
+                             byte_length);
+  }
+
+  /// Core glTF requires integer colors, joint weights and rotation or morph
+  /// weight keyframes to be normalized, but some exporters forget to set the
+  /// flag. Don't use it for attributes that KHR_mesh_quantization allows to be
+  /// plain integers, like UVs
+  accessor_view& assume_normalized() {
+    normalized_ = true;
+    return *this;
+  }
+
+  size_t count() const { return accessor_.count; }
+  size_t components() const { return components_; }
+  int component_type() const { return accessor_.componentType; }
+  bool normalized() const { return normalized_; }
+  bool is_sparse() const { return accessor_.sparse.isSparse; }
+
+  /// Size in bytes of one element as stored in the buffer
+  size_t element_size() const { return component_size_ * components_; }
+  size_t byte_stride() const { return byte_stride_; }
+
+  /// Address of the first element, nullptr if there's no bufferView
+  const unsigned char* data() const { return data_; }
+
+  bool is_tightly_packed() const {
+    return data_ && byte_stride_ == element_size();
+  }
+
+  /// The accessor content as an array of `count() * components()` T, if it can
+  /// be used without any conversion. nullptr otherwise.
+  template <typename T>
+  const T* tightly_packed_data() const {
+    if (!is_tightly_packed() || is_sparse() ||
+        component_type() != accessor_detail::component_type_of<T>::value ||
+        (normalized_ && std::is_integral<T>::value))
+      return nullptr;
+    return reinterpret_cast<const T*>(data_);
+  }
+
+  /// Decode every element into `output`, converted to T. Normalized integers
+  /// are only converted to [0, 1] / [-1, 1] when T is a floating point type.
+  /// Each element takes `output_components` values (0 means `components()`).
+  /// Extra components are set to `fill`, e.g. to turn RGB colors into RGBA.
+  template <typename T>
+  void copy_to(std::vector<T>& output, size_t output_components = 0,
+               T fill = T(0)) const {
+    if (output_components == 0) output_components = components_;
+    output.resize(count() * output_components);
+    copy_to(output.data(), output_components, fill);
+  }
+
+  template <typename T>
+  void copy_to(T* output, size_t output_components, T fill) const {
+    const size_t copied = std::min(components_, output_components);
+
+    if (data_) {
+      if (copied < output_components)
+        std::fill(output, output + count() * output_components, fill);
+      convert(component_type(), data_, byte_stride_, count(), copied, output,
+              output_components);
+    } else {
+      for (size_t i = 0; i < count(); ++i) {
+        T* element = output + i * output_components;
+        std::fill(element, element + copied, T(0));
+        std::fill(element + copied, element + output_components, fill);
+      }
+    }
+
+    if (is_sparse()) apply_sparse(output, output_components, copied);
+  }
+
+  /// True if the accessor is zero everywhere, except for its sparse elements
+  bool is_sparse_only() const { return is_sparse() && !data_; }
+
+  /// Decode only the sparse elements: their indices, and their values with
+  /// the same conversion and layout rules as `copy_to`
+  template <typename T>
+  void copy_sparse_to(std::vector<uint32_t>& indices, std::vector<T>& values,
+                      size_t output_components = 0, T fill = T(0)) const {
+    if (output_components == 0) output_components = components_;
+    const size_t copied = std::min(components_, output_components);
+
+    std::vector<T> packed;
+    read_sparse(indices, packed, copied);
+    if (copied == output_components) {
+      values = std::move(packed);
+      return;
+    }
+
+    values.assign(indices.size() * output_components, fill);
+    for (size_t i = 0; i < indices.size(); ++i)
+      std::copy(packed.begin() + std::ptrdiff_t(i * copied),
+                packed.begin() + std::ptrdiff_t((i + 1) * copied),
+                values.begin() + std::ptrdiff_t(i * output_components));
+  }
+
+ private:
+  const tinygltf::Model& model_;
+  const buffer_data::overrides& buffers_;
+  const tinygltf::Accessor& accessor_;
+  const unsigned char* data_ = nullptr;
+  size_t byte_stride_ = 0;
+  size_t component_size_ = 0;
+  size_t components_ = 0;
+  bool normalized_ = false;
+
+  const unsigned char* buffer_view_data(int buffer_view_index,
+                                        size_t byte_offset,
+                                        size_t byte_length) const {
+    if (buffer_view_index < 0 ||
+        size_t(buffer_view_index) >= model_.bufferViews.size())
+      throw std::runtime_error("accessor references an invalid bufferView");
+
+    size_t view_length = 0;
+    const unsigned char* view =
+        buffers_.get_buffer_view(model_, buffer_view_index, view_length);
+    if (!view || byte_offset + byte_length > view_length)
+      throw std::runtime_error("accessor reads past the end of its buffer");
+
+    return view + byte_offset;
+  }
+
+  template <typename T>
+  void convert(int type, const unsigned char* source, size_t byte_stride,
+               size_t count, size_t components, T* output,
+               size_t output_components) const {
+    const bool is_float_data = type == TINYGLTF_COMPONENT_TYPE_FLOAT ||
+                               type == TINYGLTF_COMPONENT_TYPE_DOUBLE;
+    if (normalized_ && !is_float_data && std::is_floating_point<T>::value)
+      accessor_detail::convert_from<T, true>(type, source, byte_stride, count,
+                                             components, output,
+                                             output_components);
+    else
+      accessor_detail::convert_from<T, false>(type, source, byte_stride, count,
+                                              components, output,
+                                              output_components);
+  }
+
+  // Indices and values of the sparse elements, `copied` components each
+  template <typename T>
+  void read_sparse(std::vector<uint32_t>& indices, std::vector<T>& values,
+                   size_t copied) const {
+    const auto& sparse = accessor_.sparse;
+    const size_t nb_values = size_t(sparse.count);
+
+    const size_t index_size = size_t(tinygltf::GetComponentSizeInBytes(
+        uint32_t(sparse.indices.componentType)));
+    const unsigned char* indices_data =
+        buffer_view_data(sparse.indices.bufferView,
+                         size_t(sparse.indices.byteOffset),
+                         nb_values * index_size);
+    indices.resize(nb_values);
+    accessor_detail::convert_from<uint32_t, false>(
+        sparse.indices.componentType, indices_data, index_size, nb_values, 1,
+        indices.data(), 1);
+
+    // Values are tightly packed, and use the accessor's own type
+    const unsigned char* values_data =
+        buffer_view_data(sparse.values.bufferView,
+                         size_t(sparse.values.byteOffset),
+                         nb_values * element_size());
+    values.resize(nb_values * copied);
+    convert(component_type(), values_data, element_size(), nb_values, copied,
+            values.data(), copied);
+
+    for (const auto index : indices)
+      if (index >= count())
+        throw std::runtime_error("sparse accessor index is out of range");
+  }
+
+  template <typename T>
+  void apply_sparse(T* output, size_t output_components, size_t copied) const {
+    std::vector<uint32_t> indices;
+    std::vector<T> values;
+    read_sparse(indices, values, copied);
+
+    for (size_t i = 0; i < indices.size(); ++i) {
+      std::copy(values.begin() + std::ptrdiff_t(i * copied),
+                values.begin() + std::ptrdiff_t((i + 1) * copied),
+                output + size_t(indices[i]) * output_components);
+    }
+  }
+};
+
+}  // namespace gltf_insight
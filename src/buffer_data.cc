@@ -0,0 +1,72 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "buffer_data.hh"
+
+using namespace gltf_insight;
+
+void buffer_data::overrides::override_buffer(int buffer,
+                                             external_bytes bytes) {
+  buffers_[buffer] = std::move(bytes);
+}
+
+void buffer_data::overrides::override_buffer_view(int buffer_view,
+                                                  external_bytes bytes) {
+  buffer_views_[buffer_view] = std::move(bytes);
+}
+
+const unsigned char* buffer_data::overrides::get_buffer(
+    const tinygltf::Model& model, int buffer, size_t& byte_length) const {
+  byte_length = 0;
+  if (buffer < 0 || size_t(buffer) >= model.buffers.size()) return nullptr;
+
+  const auto buffer_it = buffers_.find(buffer);
+  if (buffer_it != buffers_.end()) {
+    byte_length = buffer_it->second.size;
+    return buffer_it->second.data;
+  }
+
+  byte_length = model.buffers[size_t(buffer)].data.size();
+  return model.buffers[size_t(buffer)].data.data();
+}
+
+const unsigned char* buffer_data::overrides::get_buffer_view(
+    const tinygltf::Model& model, int buffer_view, size_t& byte_length) const {
+  byte_length = 0;
+  if (buffer_view < 0 || size_t(buffer_view) >= model.bufferViews.size())
+    return nullptr;
+  const auto& view = model.bufferViews[size_t(buffer_view)];
+
+  const auto view_it = buffer_views_.find(buffer_view);
+  if (view_it != buffer_views_.end()) {
+    byte_length = view_it->second.size;
+    return view_it->second.data;
+  }
+
+  size_t buffer_size = 0;
+  const unsigned char* buffer = get_buffer(model, view.buffer, buffer_size);
+  if (!buffer || view.byteOffset + view.byteLength > buffer_size)
+    return nullptr;
+  byte_length = view.byteLength;
+  return buffer + view.byteOffset;
+}
@@ -0,0 +1,77 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+
+#include "tiny_gltf.h"
+
+namespace gltf_insight {
+
+/// glTF buffer contents that don't live in `tinygltf::Buffer::data`. A buffer
+/// can be redirected to external memory (e.g. the BIN chunk of a memory mapped
+/// GLB file), and a bufferView can be replaced by data decoded at load time.
+/// All reads of buffer content should go through `get_buffer_view`.
+namespace buffer_data {
+
+/// Memory that holds the content of a buffer or a bufferView. `owner` keeps it
+/// alive for as long as it is registered.
+struct external_bytes {
+  const unsigned char* data = nullptr;
+  size_t size = 0;
+  std::shared_ptr<const void> owner;
+};
+
+/// The overrides of one model, kept next to it. They are only registered
+/// while the model is loaded, by one thread at a time, and then only read,
+/// which needs no lock.
+class overrides {
+ public:
+  /// Use `bytes` as the content of `model.buffers[buffer]`
+  void override_buffer(int buffer, external_bytes bytes);
+
+  /// Use `bytes` as the content of `model.bufferViews[buffer_view]`
+  void override_buffer_view(int buffer_view, external_bytes bytes);
+
+  /// Content of `model.buffers[buffer]`, with `byte_length` set to its size.
+  /// Returns nullptr if the buffer is invalid.
+  const unsigned char* get_buffer(const tinygltf::Model& model, int buffer,
+                                  size_t& byte_length) const;
+
+  /// Start of the data of `model.bufferViews[buffer_view]`, with
+  /// `byte_length` set to its size. Returns nullptr if the bufferView or its
+  /// buffer is invalid.
+  const unsigned char* get_buffer_view(const tinygltf::Model& model,
+                                       int buffer_view,
+                                       size_t& byte_length) const;
+
+ private:
+  std::map<int, external_bytes> buffers_;
+  std::map<int, external_bytes> buffer_views_;
+};
+
+}  // namespace buffer_data
+}  // namespace gltf_insight
@@ -0,0 +1,93 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "cache_file.hh"
+
+#include <cstdio>
+#include <random>
+
+using namespace gltf_insight;
+
+bool cache_file::directory::open(const std::string& path) {
+  path_.clear();
+  if (path.empty() || !os_utils::mkdir(path)) return false;
+
+  path_ = path;
+  return true;
+}
+
+std::string cache_file::directory::path_for(uint64_t hash) const {
+  char name[32];
+  std::snprintf(name, sizeof name, "%016llx.",
+                static_cast<unsigned long long>(hash));
+  return path_ + "/" + name + extension_;
+}
+
+std::shared_ptr<os_utils::mapped_file> cache_file::directory::map(
+    uint64_t hash, uint32_t magic, uint32_t version) const {
+  if (!enabled()) return nullptr;
+
+  auto file = std::make_shared<os_utils::mapped_file>();
+  if (!file->open(path_for(hash))) return nullptr;
+
+  if (file->size() < 2 * sizeof(uint32_t) ||
+      read_value<uint32_t>(file->data()) != magic ||
+      read_value<uint32_t>(file->data() + 4) != version)
+    return nullptr;
+
+  return file;
+}
+
+bool cache_file::directory::store(
+    uint64_t hash, uint32_t magic, uint32_t version,
+    const std::function<void(std::ofstream&)>& write) const {
+  if (!enabled()) return false;
+
+  // Each writer uses its own temporary file
+  const std::string path = path_for(hash);
+  std::random_device random;
+  const std::string temporary_path =
+      path + ".tmp" + std::to_string(random()) + std::to_string(random());
+
+  {
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    write_value(file, magic);
+    write_value(file, version);
+    write(file);
+
+    if (!file) {
+      file.close();
+      std::remove(temporary_path.c_str());
+      return false;
+    }
+  }
+
+  if (!os_utils::replace_file(temporary_path, path)) {
+    std::remove(temporary_path.c_str());
+    return false;
+  }
+
+  return true;
+}
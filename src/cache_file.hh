@@ -0,0 +1,92 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "os_utils.hh"
+
+namespace gltf_insight {
+
+/// Plumbing shared by the on disk caches: flat files named after a 64 bits
+/// hash, that start with a magic number and a format version (2 x uint32).
+/// Integers are stored in the byte order of the machine that wrote them, a
+/// file from another byte order is seen as a cache miss.
+namespace cache_file {
+
+template <typename T>
+T read_value(const unsigned char* data) {
+  T value;
+  std::memcpy(&value, data, sizeof value);
+  return value;
+}
+
+template <typename T>
+void write_value(std::ofstream& file, T value) {
+  file.write(reinterpret_cast<const char*>(&value), sizeof value);
+}
+
+inline size_t align_up(size_t offset, size_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+/// Directory holding the `<hash>.<extension>` files of one cache
+class directory {
+ public:
+  explicit directory(const char* extension) : extension_(extension) {}
+
+  /// Use `path`, it is created if needed. Returns false and leaves the cache
+  /// disabled if it can't be used
+  bool open(const std::string& path);
+
+  bool enabled() const { return !path_.empty(); }
+
+  std::string path_for(uint64_t hash) const;
+
+  /// Map the file stored for `hash`. Returns nullptr on a miss, or if the file
+  /// doesn't start with `magic` and `version`
+  std::shared_ptr<os_utils::mapped_file> map(uint64_t hash, uint32_t magic,
+                                             uint32_t version) const;
+
+  /// Store the file for `hash`: `magic` and `version`, followed by what
+  /// `write` outputs. The file is written under a temporary name and then
+  /// renamed, so a reader never sees it half written, and several threads or
+  /// instances of the program can store the same entry at the same time
+  bool store(uint64_t hash, uint32_t magic, uint32_t version,
+             const std::function<void(std::ofstream&)>& write) const;
+
+ private:
+  const char* extension_;
+  std::string path_;
+};
+
+}  // namespace cache_file
+
+}  // namespace gltf_insight
@@ -14,6 +14,7 @@ glm::vec4 configuration::bone_highlight_color = glm::vec4(0.5, 0, 0.5, 1);
 glm::vec4 configuration::joint_highlight_color = glm::vec4(0, 1, 0, 1);
 float configuration::bone_draw_size = 3;
 float configuration::joint_draw_size = 3;
+int configuration::texture_upload_budget_mib = 16;
 bool configuration::editor_configuration_open = false;
 
 void configuration::show_editor_configuration_window() {
@@ -31,6 +32,9 @@ void configuration::show_editor_configuration_window() {
     ImGui::ColorEdit3("Joint (selected)",
                       glm::value_ptr(joint_highlight_color));
     ImGui::SliderFloat("Joint size", &joint_draw_size, 1, 10);
+    ImGui::TextColored(yellow, "Loading:");
+    ImGui::SliderInt("Texture upload (MiB/frame)", &texture_upload_budget_mib,
+                     1, 256);
   }
   ImGui::End();
 }
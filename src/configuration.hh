@@ -12,6 +12,7 @@ struct configuration {
   static glm::vec4 bone_highlight_color;
   static float joint_draw_size;
   static float bone_draw_size;
+  static int texture_upload_budget_mib;
   static bool editor_configuration_open;
   static void show_editor_configuration_window();
 
@@ -0,0 +1,313 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "draco_decoder.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "buffer_data.hh"
+#include "parallel_for.hh"
+#include "tiny_gltf_util.h"
+
+#ifdef GLTF_INSIGHT_WITH_DRACO
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#endif
+
+#include "draco/compression/decode.h"
+#include "draco/mesh/mesh.h"
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+#endif
+
+using namespace gltf_insight;
+
+namespace {
+
+const char* const draco_extension = "KHR_draco_mesh_compression";
+
+// A primitive using KHR_draco_mesh_compression, and the accessors its
+// decoded streams go to
+struct compressed_primitive {
+  int mesh = -1;
+  int primitive = -1;
+  int buffer_view = -1;
+  int indices = -1;
+  // {accessor, Draco attribute unique id}
+  std::vector<std::pair<int, int>> attributes;
+};
+
+// Decoded content of one accessor, tightly packed in the accessor's own format
+struct decoded_stream {
+  int accessor = -1;
+  size_t count = 0;
+  std::shared_ptr<std::vector<unsigned char>> bytes;
+};
+
+std::vector<compressed_primitive> find_compressed_primitives(
+    const tinygltf::Model& model) {
+  std::vector<compressed_primitive> found;
+  for (size_t m = 0; m < model.meshes.size(); ++m) {
+    const auto& primitives = model.meshes[m].primitives;
+    for (size_t p = 0; p < primitives.size(); ++p) {
+      const auto& primitive = primitives[p];
+      const auto extension = primitive.extensions.find(draco_extension);
+      if (extension == primitive.extensions.end()) continue;
+
+      compressed_primitive compressed;
+      compressed.mesh = int(m);
+      compressed.primitive = int(p);
+      compressed.buffer_view =
+          get_int_value(extension->second, "bufferView", -1);
+      compressed.indices = primitive.indices;
+
+      // Attributes that are not in the extension are stored uncompressed
+      if (extension->second.Has("attributes")) {
+        const auto& ids = extension->second.Get("attributes");
+        for (const auto& attribute : primitive.attributes) {
+          const int id = get_int_value(ids, attribute.first.c_str(), -1);
+          if (id >= 0) compressed.attributes.emplace_back(attribute.second, id);
+        }
+      }
+      found.push_back(std::move(compressed));
+    }
+  }
+  return found;
+}
+
+#ifdef GLTF_INSIGHT_WITH_DRACO
+template <typename T>
+void convert_attribute(const draco::Mesh& mesh,
+                       const draco::PointAttribute& attribute,
+                       size_t components, unsigned char* output) {
+  std::vector<T> value(components);
+  for (draco::PointIndex point(0); point < mesh.num_points(); ++point) {
+    if (!attribute.ConvertValue<T>(attribute.mapped_index(point),
+                                   int8_t(components), value.data()))
+      throw std::runtime_error("cannot convert a Draco attribute");
+    std::memcpy(output + point.value() * components * sizeof(T), value.data(),
+                components * sizeof(T));
+  }
+}
+
+decoded_stream decode_indices(const draco::Mesh& mesh,
+                              const tinygltf::Accessor& accessor,
+                              int accessor_index) {
+  decoded_stream stream;
+  stream.accessor = accessor_index;
+  stream.count = size_t(mesh.num_faces()) * 3;
+
+  const size_t index_size = size_t(
+      tinygltf::GetComponentSizeInBytes(uint32_t(accessor.componentType)));
+  if (index_size != 1 && index_size != 2 && index_size != 4)
+    throw std::runtime_error("invalid index type");
+
+  stream.bytes =
+      std::make_shared<std::vector<unsigned char>>(stream.count * index_size);
+  unsigned char* output = stream.bytes->data();
+  for (draco::FaceIndex face(0); face < mesh.num_faces(); ++face) {
+    for (size_t corner = 0; corner < 3; ++corner) {
+      const uint32_t index = mesh.face(face)[corner].value();
+      const uint16_t narrow = uint16_t(index);
+      if (index_size == 1)
+        *output = uint8_t(index);
+      else if (index_size == 2)
+        std::memcpy(output, &narrow, 2);
+      else
+        std::memcpy(output, &index, 4);
+      output += index_size;
+    }
+  }
+  return stream;
+}
+
+decoded_stream decode_attribute(const draco::Mesh& mesh, int unique_id,
+                                const tinygltf::Accessor& accessor,
+                                int accessor_index) {
+  const auto* attribute = mesh.GetAttributeByUniqueId(uint32_t(unique_id));
+  if (!attribute)
+    throw std::runtime_error("missing Draco attribute " +
+                             std::to_string(unique_id));
+
+  decoded_stream stream;
+  stream.accessor = accessor_index;
+  stream.count = size_t(mesh.num_points());
+
+  const size_t components =
+      size_t(tinygltf::GetTypeSizeInBytes(uint32_t(accessor.type)));
+  const size_t component_size = size_t(
+      tinygltf::GetComponentSizeInBytes(uint32_t(accessor.componentType)));
+  stream.bytes = std::make_shared<std::vector<unsigned char>>(
+      stream.count * components * component_size);
+
+  unsigned char* output = stream.bytes->data();
+  switch (accessor.componentType) {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+      convert_attribute<float>(mesh, *attribute, components, output);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+      convert_attribute<int8_t>(mesh, *attribute, components, output);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      convert_attribute<uint8_t>(mesh, *attribute, components, output);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+      convert_attribute<int16_t>(mesh, *attribute, components, output);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      convert_attribute<uint16_t>(mesh, *attribute, components, output);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+      convert_attribute<uint32_t>(mesh, *attribute, components, output);
+      break;
+    default:
+      throw std::runtime_error("invalid attribute type");
+  }
+  return stream;
+}
+
+std::vector<decoded_stream> decode_primitive(
+    const tinygltf::Model& model, const buffer_data::overrides& buffers,
+    const compressed_primitive& compressed) {
+  size_t size = 0;
+  const unsigned char* data =
+      buffers.get_buffer_view(model, compressed.buffer_view, size);
+  if (!data) throw std::runtime_error("invalid Draco bufferView");
+
+  draco::DecoderBuffer buffer;
+  buffer.Init(reinterpret_cast<const char*>(data), size);
+  draco::Decoder decoder;
+  auto decoded = decoder.DecodeMeshFromBuffer(&buffer);
+  if (!decoded.ok())
+    throw std::runtime_error(decoded.status().error_msg_string());
+  const std::unique_ptr<draco::Mesh> mesh = std::move(decoded).value();
+
+  std::vector<decoded_stream> streams;
+  if (compressed.indices >= 0) {
+    const auto& accessor = model.accessors[size_t(compressed.indices)];
+    streams.push_back(decode_indices(*mesh, accessor, compressed.indices));
+  }
+  for (const auto& attribute : compressed.attributes) {
+    const auto& accessor = model.accessors[size_t(attribute.first)];
+    streams.push_back(
+        decode_attribute(*mesh, attribute.second, accessor, attribute.first));
+  }
+  return streams;
+}
+#endif
+
+}  // namespace
+
+bool gltf_insight::draco_available() {
+#ifdef GLTF_INSIGHT_WITH_DRACO
+  return true;
+#else
+  return false;
+#endif
+}
+
+draco_decode_report gltf_insight::decode_draco_primitives(
+    tinygltf::Model& model, buffer_data::overrides& buffers,
+    size_t nb_threads) {
+  const auto compressed = find_compressed_primitives(model);
+  draco_decode_report report;
+  if (compressed.empty()) return report;
+
+#ifdef GLTF_INSIGHT_WITH_DRACO
+  using clock = std::chrono::steady_clock;
+
+  report.nb_primitives = compressed.size();
+  report.nb_threads = parallel_for_thread_count(compressed.size(), nb_threads);
+  report.primitives.resize(compressed.size());
+
+  // Decode everything first, the model only changes once all threads are done
+  std::vector<std::vector<decoded_stream>> decoded(compressed.size());
+  const auto decode_start = clock::now();
+  parallel_for(compressed.size(), nb_threads, [&](size_t i) {
+    const auto primitive_start = clock::now();
+    const auto& primitive = compressed[i];
+    try {
+      decoded[i] = decode_primitive(model, buffers, primitive);
+    } catch (const std::exception& e) {
+      throw std::runtime_error("Cannot decode Draco primitive " +
+                               std::to_string(primitive.primitive) +
+                               " of mesh " + std::to_string(primitive.mesh) +
+                               ": " + e.what());
+    }
+
+    report.primitives[i].mesh = primitive.mesh;
+    report.primitives[i].primitive = primitive.primitive;
+    report.primitives[i].ms = std::chrono::duration<double, std::milli>(
+                                  clock::now() - primitive_start)
+                                  .count();
+  });
+
+  report.decode_wall_ms =
+      std::chrono::duration<double, std::milli>(clock::now() - decode_start)
+          .count();
+  for (const auto& timing : report.primitives)
+    report.decode_cpu_ms += timing.ms;
+
+  // Every stream gets a bufferView of its own, that only exists through
+  // `buffers`
+  for (auto& streams : decoded) {
+    for (auto& stream : streams) {
+      tinygltf::BufferView view;
+      view.byteLength = stream.bytes->size();
+      const int view_index = int(model.bufferViews.size());
+      model.bufferViews.push_back(view);
+
+      auto& accessor = model.accessors[size_t(stream.accessor)];
+      accessor.bufferView = view_index;
+      accessor.byteOffset = 0;
+      accessor.count = stream.count;
+
+      buffer_data::external_bytes bytes;
+      bytes.data = stream.bytes->data();
+      bytes.size = stream.bytes->size();
+      bytes.owner = std::move(stream.bytes);
+      buffers.override_buffer_view(view_index, std::move(bytes));
+    }
+  }
+#else
+  (void)buffers;
+  (void)nb_threads;
+  report.nb_skipped = compressed.size();
+  std::cerr << "Warn: " << compressed.size()
+            << " primitives use KHR_draco_mesh_compression, but gltf-insight "
+               "was built without Draco (GLTF_INSIGHT_USE_DRACO). They will "
+               "not be displayed\n";
+#endif
+
+  return report;
+}
@@ -0,0 +1,72 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "buffer_data.hh"
+#include "parallel_for.hh"
+#include "tiny_gltf.h"
+
+namespace gltf_insight {
+
+/// Timings of a `decode_draco_primitives` call
+struct draco_decode_report {
+  struct primitive_timing {
+    int mesh = -1;
+    int primitive = -1;
+    double ms = 0.0;
+  };
+
+  size_t nb_primitives = 0;
+  // Compressed primitives left empty, gltf-insight was built without Draco
+  size_t nb_skipped = 0;
+  size_t nb_threads = 1;
+  double decode_wall_ms = 0.0;
+  double decode_cpu_ms = 0.0;
+  std::vector<primitive_timing> primitives;
+
+  /// See `gltf_insight::work_overlap`
+  double work_overlap() const {
+    return gltf_insight::work_overlap(decode_cpu_ms, decode_wall_ms);
+  }
+};
+
+/// True if gltf-insight was built with Draco (GLTF_INSIGHT_USE_DRACO)
+bool draco_available();
+
+/// Decode every primitive of `model` compressed with
+/// KHR_draco_mesh_compression, using up to `nb_threads` threads (0 means one
+/// per core). Each decoded index and attribute stream is added to `model` as a
+/// new bufferView whose content is registered in `buffers`, the overrides of
+/// `model`, and the primitive's accessors are pointed to it, so the rest of
+/// the loader reads them like uncompressed data. Without Draco support,
+/// compressed primitives are left empty and a warning is printed. Throws
+/// std::runtime_error if a primitive cannot be decoded.
+draco_decode_report decode_draco_primitives(tinygltf::Model& model,
+                                            buffer_data::overrides& buffers,
+                                            size_t nb_threads);
+
+}  // namespace gltf_insight
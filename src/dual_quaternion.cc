@@ -0,0 +1,80 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "dual_quaternion.hh"
+
+using namespace gltf_insight;
+
+dual_quaternion gltf_insight::to_dual_quaternion(const glm::mat4& transform) {
+  // Without the scale of its axes, what is left of the 3x3 part is a rotation
+  const glm::mat3 rotation(glm::normalize(glm::vec3(transform[0])),
+                           glm::normalize(glm::vec3(transform[1])),
+                           glm::normalize(glm::vec3(transform[2])));
+
+  dual_quaternion result;
+  result.real = glm::normalize(glm::quat_cast(rotation));
+  result.dual =
+      glm::quat(0.f, glm::vec3(transform[3])) * result.real * 0.5f;
+  return result;
+}
+
+dual_quaternion gltf_insight::blend(const std::vector<dual_quaternion>& joints,
+                                    const glm::vec4& indices,
+                                    const glm::vec4& weights) {
+  const auto& first = joints[size_t(indices.x)];
+
+  dual_quaternion result;
+  result.real = glm::quat(0.f, 0.f, 0.f, 0.f);
+  result.dual = glm::quat(0.f, 0.f, 0.f, 0.f);
+  for (glm::length_t i = 0; i < 4; ++i) {
+    const auto& joint = joints[size_t(indices[i])];
+    const float weight =
+        glm::dot(first.real, joint.real) < 0.f ? -weights[i] : weights[i];
+    result.real += joint.real * weight;
+    result.dual += joint.dual * weight;
+  }
+
+  const float norm = glm::length(result.real);
+  if (norm > 0.f) {
+    result.real /= norm;
+    result.dual /= norm;
+  }
+  return result;
+}
+
+glm::vec3 gltf_insight::translation(const dual_quaternion& transform) {
+  const glm::vec3 real(transform.real.x, transform.real.y, transform.real.z);
+  const glm::vec3 dual(transform.dual.x, transform.dual.y, transform.dual.z);
+  return 2.f * (transform.real.w * dual - transform.dual.w * real +
+                glm::cross(real, dual));
+}
+
+glm::vec3 gltf_insight::transform_point(const dual_quaternion& transform,
+                                        const glm::vec3& point) {
+  return transform.real * point + translation(transform);
+}
+
+glm::vec3 gltf_insight::transform_vector(const dual_quaternion& transform,
+                                         const glm::vec3& vector) {
+  return transform.real * vector;
+}
@@ -0,0 +1,70 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#endif
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#include <vector>
+
+namespace gltf_insight {
+
+/// Rigid transform as a unit dual quaternion. `real` is the rotation, `dual`
+/// is half the translation (as a pure quaternion) multiplied by the rotation
+struct dual_quaternion {
+  glm::quat real;
+  glm::quat dual;
+};
+
+/// Rotation and translation of `transform`. A dual quaternion can't hold a
+/// scale or a shear, they are dropped
+dual_quaternion to_dual_quaternion(const glm::mat4& transform);
+
+/// Normalized blend of the 4 dual quaternions `joints[indices[i]]` weighted by
+/// `weights[i]`. q and -q are the same rotation, each one is taken on the side
+/// of the first so the blend follows the shortest path
+dual_quaternion blend(const std::vector<dual_quaternion>& joints,
+                      const glm::vec4& indices, const glm::vec4& weights);
+
+/// Translation part of `transform`
+glm::vec3 translation(const dual_quaternion& transform);
+
+/// Rotate then translate `point`
+glm::vec3 transform_point(const dual_quaternion& transform,
+                          const glm::vec3& point);
+
+/// Rotate `vector`, the translation doesn't apply to directions
+glm::vec3 transform_vector(const dual_quaternion& transform,
+                           const glm::vec3& vector);
+
+}  // namespace gltf_insight
@@ -25,6 +25,9 @@ SOFTWARE.
 #ifdef __EMSCRIPTEN__
 #include <GLES3/gl3.h>
 #endif
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstring>
 #include <iostream>
 
@@ -222,8 +225,28 @@ void draw_space_base(GLuint shader, const float line_width,
             glm::vec4(0, 0, 1, 1), line_width);
 }
 
-void load_shaders(const size_t nb_joints,
-                  std::map<std::string, shader>& shaders) {
+const char* shader_name(shader_id id) {
+  static const char* const names[] = {"unlit",
+                                      "debug_color",
+                                      "debug_uv",
+                                      "debug_normals",
+                                      "debug_normal_map",
+                                      "debug_metallic_roughness_map",
+                                      "debug_occlusion_map",
+                                      "debug_emissive_map",
+                                      "debug_base_color_map",
+                                      "debug_applied_normal_mapping",
+                                      "debug_vertex_color",
+                                      "debug_frag_pos",
+                                      "pbr_metal_rough",
+                                      "weights"};
+  static_assert(sizeof names / sizeof names[0] == size_t(shader_id::count),
+                "every shader_id needs a name");
+  return names[size_t(id)];
+}
+
+void load_shaders(bool skinned, shader_registry& shaders,
+                  const gltf_insight::program_binary_cache* binaries) {
   //"paste in" the bundled shader code
 #include "base_color_map.frag_inc.hh"
 #include "draw_debug_color.frag_inc.hh"
@@ -242,37 +265,15 @@ void load_shaders(const size_t nb_joints,
 #include "weights.frag_inc.hh"
 #include "world_fragment.frag_inc.hh"
 
-  // print some warnings
-  if (nb_joints > 180)
-    std::cerr << "Warning: This is a lot of joints, model may be unsuited for "
-                 "GPU based skinning.\n//TODO investigate dual quaternion "
-                 "based skinning\n";
-
   // TODO put the GLSL code ouside of here, load them from files
-  // Main vertex shader, that perform GPU skinning
+  // Main vertex shader, that perform GPU skinning. It reads the joint matrices
+  // from `joint_palette`, so it works for any number of joints
 
   const std::string no_skinning_vert_src(
       reinterpret_cast<char*>(no_skinning_vert), no_skinning_vert_len);
-
-  const std::string skinning_vert_src = [&] {
-    // TODO a real shader template system may be useful
-    // Write in shader source code the value of `nb_joints`
-    std::string skinning_template_vert_src(
-        reinterpret_cast<char*>(skinning_template_vert),
-        skinning_template_vert_len);
-    size_t index = skinning_template_vert_src.find("$nb_joints");
-    if (index == std::string::npos) {
-      std::cerr
-          << "The skinned mesh vertex shader doesn't have the $nb_joints "
-             "token in it's source code anywhere. We cannot do skinning on "
-             "a shader that cannot receive the joint list.\n";
-      exit(EXIT_FAILURE);
-    }
-
-    skinning_template_vert_src.replace(index, strlen("$nb_joints"),
-                                       std::to_string(nb_joints));
-    return skinning_template_vert_src;
-  }();
+  const std::string skinning_vert_src(
+      reinterpret_cast<char*>(skinning_template_vert),
+      skinning_template_vert_len);
 
   const std::string unlit_frag_src(reinterpret_cast<char*>(unlit_frag),
                                    unlit_frag_len);
@@ -306,65 +307,299 @@ void load_shaders(const size_t nb_joints,
   const std::string vertex_color_frag_src(
       reinterpret_cast<char*>(vertex_color_frag), vertex_color_frag_len);
   const std::string& vert_src =
-      nb_joints != 0 ? skinning_vert_src : no_skinning_vert_src;
-
-  shaders["unlit"] = shader("unlit", vert_src, unlit_frag_src);
-  shaders["debug_color"] =
-      shader("debug_color", no_skinning_vert_src, draw_debug_color_src);
-  shaders["debug_uv"] = shader(
-      "debug_uv", nb_joints != 0 ? skinning_vert_src : no_skinning_vert_src,
-      uv_frag_src);
-  shaders["debug_normals"] =
-      shader("debug_normals", vert_src, normals_frag_src);
-  shaders["debug_normal_map"] =
-      shader("debug_normal_map", vert_src, normal_map_frag_src);
-  shaders["debug_metallic_roughness_map"] =
+      skinned ? skinning_vert_src : no_skinning_vert_src;
+
+  shaders[shader_id::unlit] =
+      shader("unlit", vert_src, unlit_frag_src, binaries);
+  shaders[shader_id::debug_color] = shader("debug_color", no_skinning_vert_src,
+                                           draw_debug_color_src, binaries);
+  shaders[shader_id::debug_uv] =
+      shader("debug_uv", skinned ? skinning_vert_src : no_skinning_vert_src,
+             uv_frag_src, binaries);
+  shaders[shader_id::debug_normals] =
+      shader("debug_normals", vert_src, normals_frag_src, binaries);
+  shaders[shader_id::debug_normal_map] =
+      shader("debug_normal_map", vert_src, normal_map_frag_src, binaries);
+  shaders[shader_id::debug_metallic_roughness_map] =
       shader("debug_metallic_roughness_map", vert_src,
-             metallic_roughness_map_frag_src);
-  shaders["debug_occlusion_map"] =
-      shader("debug_occlusion_map", vert_src, occlusion_map_frag_src);
-  shaders["debug_emissive_map"] =
-      shader("debug_emissive_map", vert_src, emissive_map_frag_src);
-  shaders["debug_base_color_map"] =
-      shader("debug_base_color_map", vert_src, base_color_map_frag_src);
-  shaders["debug_applied_normal_mapping"] = shader(
-      "debug_applied_normal_mapping", vert_src, perturbed_normal_frag_src);
-  shaders["debug_vertex_color"] =
-      shader("debug_vertex_color", vert_src, vertex_color_frag_src);
-  shaders["debug_frag_pos"] =
-      shader("debug_frag_pos", vert_src, world_frag_src);
-  shaders["pbr_metal_rough"] =
-      shader("pbr_metal_rough", vert_src, pbr_metallic_roughness_frag_src);
-  shaders["weights"] = shader("weights", vert_src, weights_frag_src);
+             metallic_roughness_map_frag_src, binaries);
+  shaders[shader_id::debug_occlusion_map] = shader(
+      "debug_occlusion_map", vert_src, occlusion_map_frag_src, binaries);
+  shaders[shader_id::debug_emissive_map] =
+      shader("debug_emissive_map", vert_src, emissive_map_frag_src, binaries);
+  shaders[shader_id::debug_base_color_map] = shader(
+      "debug_base_color_map", vert_src, base_color_map_frag_src, binaries);
+  shaders[shader_id::debug_applied_normal_mapping] =
+      shader("debug_applied_normal_mapping", vert_src,
+             perturbed_normal_frag_src, binaries);
+  shaders[shader_id::debug_vertex_color] =
+      shader("debug_vertex_color", vert_src, vertex_color_frag_src, binaries);
+  shaders[shader_id::debug_frag_pos] =
+      shader("debug_frag_pos", vert_src, world_frag_src, binaries);
+  shaders[shader_id::pbr_metal_rough] = shader(
+      "pbr_metal_rough", vert_src, pbr_metallic_roughness_frag_src, binaries);
+  shaders[shader_id::weights] =
+      shader("weights", vert_src, weights_frag_src, binaries);
+
+  // Samplers always read the same texture units, see
+  // material::fill_material_texture_slots
+  for (size_t i = 0; i < size_t(shader_id::count); ++i) {
+    const auto& program = shaders[shader_id(i)];
+    program.use();
+    program.set_uniform("normal_texture", 0);
+    program.set_uniform("occlusion_texture", 1);
+    program.set_uniform("emissive_texture", 2);
+    program.set_uniform("base_color_texture", 3);
+    program.set_uniform("metallic_roughness_texture", 4);
+    program.set_uniform("brdf_lut", 5);
+    program.set_uniform("joint_palette", joint_palette::texture_unit);
+  }
+  glUseProgram(0);
 }
 
-void update_uniforms(std::map<std::string, shader>& shaders, bool use_ibl,
-                     const glm::vec3& camera_position,
-                     const glm::vec3& light_color,
-                     const glm::vec3& light_direction, const int active_joint,
-                     const std::string& shader_to_use, const glm::mat4& model,
+void update_uniforms(const shader_registry& shaders, const int active_joint,
+                     shader_id shader_to_use, const glm::mat4& model,
                      const glm::mat4& mvp, const glm::mat3& normal,
-                     const std::vector<glm::mat4>& joint_matrices,
+                     GLint joint_palette_offset,
                      const glm::vec3& active_vertex) {
-  shaders[shader_to_use].use();
-  shaders[shader_to_use].set_uniform("active_vertex", active_vertex);
-  shaders[shader_to_use].set_uniform("camera_position", camera_position);
-  shaders[shader_to_use].set_uniform("light_direction", light_direction);
-  shaders[shader_to_use].set_uniform("light_color", light_color);
-  shaders[shader_to_use].set_uniform("active_joint", active_joint);
-  shaders[shader_to_use].set_uniform("joint_matrix", joint_matrices);
-  shaders[shader_to_use].set_uniform("mvp", mvp);
-  shaders[shader_to_use].set_uniform("model", model);
-  shaders[shader_to_use].set_uniform("normal", normal);
-  shaders[shader_to_use].set_uniform("debug_color",
-                                     glm::vec4(0.5f, 0.5f, 0.f, 1.f));
-  shaders[shader_to_use].set_uniform("use_ibl",
-                                     int(use_ibl ? GL_TRUE : GL_FALSE));
+  const auto& program = shaders[shader_to_use];
+  program.use();
+  program.set_uniform(uniform_id::active_vertex, active_vertex);
+  program.set_uniform(uniform_id::active_joint, active_joint);
+  program.set_uniform(uniform_id::joint_palette_offset, joint_palette_offset);
+  program.set_uniform(uniform_id::mvp, mvp);
+  program.set_uniform(uniform_id::model, model);
+  program.set_uniform(uniform_id::normal, normal);
+  program.set_uniform(uniform_id::debug_color,
+                      glm::vec4(0.5f, 0.5f, 0.f, 1.f));
+}
+
+void joint_palette::initialize() {
+  glGenTextures(1, &texture_);
+  // Until the first upload, the palette holds an identity matrix
+  rows_ = {glm::vec4(1.f, 0.f, 0.f, 0.f), glm::vec4(0.f, 1.f, 0.f, 0.f),
+           glm::vec4(0.f, 0.f, 1.f, 0.f)};
+
+#ifndef __EMSCRIPTEN__
+  glGenBuffers(1, &buffer_);
+  glBindBuffer(GL_TEXTURE_BUFFER, buffer_);
+  glBufferData(GL_TEXTURE_BUFFER, GLsizeiptr(rows_.size() * sizeof rows_[0]),
+               rows_.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_BUFFER, texture_);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer_);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+#else
+  // Float textures can't be filtered
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+#endif
+
+  upload();
+  clear();
+}
+
+void joint_palette::release() {
+  if (texture_) glDeleteTextures(1, &texture_);
+  if (buffer_) glDeleteBuffers(1, &buffer_);
+  texture_ = buffer_ = 0;
+  rows_.clear();
+}
+
+GLint joint_palette::append(const std::vector<glm::mat4>& matrices) {
+  const auto first = GLint(rows_.size());
+  for (const auto& matrix : matrices)
+    for (glm::length_t row = 0; row < 3; ++row)
+      rows_.emplace_back(matrix[0][row], matrix[1][row], matrix[2][row],
+                         matrix[3][row]);
+  return first;
+}
+
+GLint joint_palette::append_dual_quaternions(
+    const std::vector<glm::mat4>& matrices) {
+  const auto first = GLint(rows_.size());
+  for (const auto& matrix : matrices) {
+    const auto joint = to_dual_quaternion(matrix);
+    rows_.emplace_back(joint.real.x, joint.real.y, joint.real.z, joint.real.w);
+    rows_.emplace_back(joint.dual.x, joint.dual.y, joint.dual.z, joint.dual.w);
+  }
+  return first;
+}
+
+void joint_palette::upload() {
+  if (rows_.empty()) return;
+
+  glActiveTexture(GLenum(GL_TEXTURE0 + texture_unit));
+#ifndef __EMSCRIPTEN__
+  // Orphan the storage of the previous frame instead of waiting for the
+  // draws that still read it
+  glBindBuffer(GL_TEXTURE_BUFFER, buffer_);
+  glBufferData(GL_TEXTURE_BUFFER, GLsizeiptr(rows_.size() * sizeof rows_[0]),
+               rows_.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_BUFFER, texture_);
+#else
+  const size_t height = (rows_.size() + texture_width - 1) / texture_width;
+  rows_.resize(height * texture_width);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, GLsizei(texture_width),
+               GLsizei(height), 0, GL_RGBA, GL_FLOAT, rows_.data());
+#endif
+  glActiveTexture(GL_TEXTURE0);
+}
+
+uniform_benchmark benchmark_uniform_updates(const shader_registry& shaders,
+                                            size_t nb_joints,
+                                            size_t iterations) {
+  using clock = std::chrono::steady_clock;
+  uniform_benchmark result;
+  if (iterations == 0) return result;
+
+  // The joint matrices were a uniform array, as large as the vertex uniform
+  // storage could hold next to the other matrices
+  GLint max_components = 0;
+  glGetIntegerv(GL_MAX_VERTEX_UNIFORM_COMPONENTS, &max_components);
+  const auto max_joints = size_t(std::max(max_components / 16 - 4, 1));
+  result.nb_joints = std::min(nb_joints, max_joints);
+
+  // The program declares the per draw uniforms of the shaders before they
+  // moved to uniform blocks and the joint palette
+#include "legacy_uniforms.frag_inc.hh"
+#include "legacy_uniforms.vert_inc.hh"
+  std::string vertex_source(reinterpret_cast<char*>(legacy_uniforms_vert),
+                            legacy_uniforms_vert_len);
+  const auto index = vertex_source.find("$nb_joints");
+  vertex_source.replace(index, strlen("$nb_joints"),
+                        std::to_string(result.nb_joints));
+  const shader legacy(
+      "legacy_uniforms", vertex_source,
+      std::string(reinterpret_cast<char*>(legacy_uniforms_frag),
+                  legacy_uniforms_frag_len));
+
+  const glm::vec3 vector(0.f, 1.f, 0.f);
+  const glm::mat4 matrix(1.f);
+  const glm::mat3 normal(1.f);
+  const std::vector<glm::mat4> joint_matrices(result.nb_joints, matrix);
+
+  // The program used to be found in a map of names at every uniform update
+  std::map<std::string, const shader*> by_name;
+  for (size_t i = 0; i < size_t(shader_id::count); ++i)
+    by_name[shader_name(shader_id(i))] = &shaders[shader_id(i)];
+  const std::string shader_to_use = shader_name(shader_id::pbr_metal_rough);
+  by_name[shader_to_use] = &legacy;
+
+  glFinish();
+  auto start = clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    by_name[shader_to_use]->use();
+    by_name[shader_to_use]->set_uniform("active_vertex", vector);
+    by_name[shader_to_use]->set_uniform("camera_position", vector);
+    by_name[shader_to_use]->set_uniform("light_direction", vector);
+    by_name[shader_to_use]->set_uniform("light_color", vector);
+    by_name[shader_to_use]->set_uniform("active_joint", 0);
+    by_name[shader_to_use]->set_uniform("joint_matrix", joint_matrices);
+    by_name[shader_to_use]->set_uniform("mvp", matrix);
+    by_name[shader_to_use]->set_uniform("model", matrix);
+    by_name[shader_to_use]->set_uniform("normal", normal);
+    by_name[shader_to_use]->set_uniform("debug_color",
+                                        glm::vec4(0.5f, 0.5f, 0.f, 1.f));
+    by_name[shader_to_use]->set_uniform("use_ibl", int(GL_FALSE));
+    by_name[shader_to_use]->set_uniform("normal_texture", 0);
+    by_name[shader_to_use]->set_uniform("occlusion_texture", 1);
+    by_name[shader_to_use]->set_uniform("emissive_texture", 2);
+    by_name[shader_to_use]->set_uniform("emissive_factor", vector);
+    by_name[shader_to_use]->set_uniform("alpha_mode", 0);
+    by_name[shader_to_use]->set_uniform("alpha_cutoff", 0.5f);
+    by_name[shader_to_use]->set_uniform("base_color_texture", 3);
+    by_name[shader_to_use]->set_uniform("metallic_roughness_texture", 4);
+    by_name[shader_to_use]->set_uniform("base_color_factor", glm::vec4(1.f));
+    by_name[shader_to_use]->set_uniform("metallic_factor", 1.f);
+    by_name[shader_to_use]->set_uniform("roughness_factor", 1.f);
+  }
+  glFinish();
+  result.by_name_ns =
+      std::chrono::duration<double, std::nano>(clock::now() - start).count() /
+      double(iterations);
+
+  start = clock::now();
+  for (size_t i = 0; i < iterations; ++i)
+    update_uniforms(shaders, 0, shader_id::pbr_metal_rough, matrix, matrix,
+                    normal, 0, vector);
+  glFinish();
+  result.by_id_ns =
+      std::chrono::duration<double, std::nano>(clock::now() - start).count() /
+      double(iterations);
+
+  glUseProgram(0);
+  return result;
+}
+
+vertex_format vertex_format::floats(GLint components) {
+  vertex_format format;
+  format.components = components;
+  return format;
+}
+
+size_t vertex_format::element_size() const {
+  size_t component_size = 4;
+  if (component_type == GL_BYTE || component_type == GL_UNSIGNED_BYTE)
+    component_size = 1;
+  else if (component_type == GL_SHORT || component_type == GL_UNSIGNED_SHORT)
+    component_size = 2;
+  return component_size * size_t(components);
+}
+
+size_t vertex_format::byte_stride() const {
+  return stride > 0 ? size_t(stride) : element_size();
+}
+
+void set_vertex_attribute(GLuint location, const vertex_format& format,
+                          size_t offset) {
+  glVertexAttribPointer(location, format.components, format.component_type,
+                        format.normalized, GLsizei(format.byte_stride()),
+                        reinterpret_cast<const void*>(offset));
+  glEnableVertexAttribArray(location);
+}
+
+void set_instance_attributes(GLuint instance_buffer) {
+  glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+  const auto stride = GLsizei(sizeof(instance_transform));
+  for (GLuint column = 0; column < 4; ++column) {
+    const auto location = GLuint(instance_layout_model) + column;
+    glVertexAttribPointer(
+        location, 4, GL_FLOAT, GL_FALSE, stride,
+        reinterpret_cast<const void*>(offsetof(instance_transform, model) +
+                                      column * sizeof(glm::vec4)));
+    glEnableVertexAttribArray(location);
+    glVertexAttribDivisor(location, 1);
+  }
+  for (GLuint column = 0; column < 3; ++column) {
+    const auto location = GLuint(instance_layout_normal) + column;
+    glVertexAttribPointer(
+        location, 3, GL_FLOAT, GL_FALSE, stride,
+        reinterpret_cast<const void*>(offsetof(instance_transform, normal) +
+                                      column * sizeof(glm::vec3)));
+    glEnableVertexAttribArray(location);
+    glVertexAttribDivisor(location, 1);
+  }
 }
 
 void perform_draw_call(
     const draw_call_submesh_descriptor& draw_call_to_perform) {
   glBindVertexArray(draw_call_to_perform.VAO);
   glDrawElements(draw_call_to_perform.draw_mode,
-                 GLsizei(draw_call_to_perform.count), GL_UNSIGNED_INT, nullptr);
+                 GLsizei(draw_call_to_perform.count),
+                 draw_call_to_perform.index_type, nullptr);
+}
+
+void perform_instanced_draw_call(
+    const draw_call_submesh_descriptor& draw_call_to_perform,
+    GLsizei nb_instances) {
+  glBindVertexArray(draw_call_to_perform.VAO);
+  glDrawElementsInstanced(draw_call_to_perform.draw_mode,
+                          GLsizei(draw_call_to_perform.count),
+                          draw_call_to_perform.index_type, nullptr,
+                          nb_instances);
 }
@@ -24,6 +24,7 @@ SOFTWARE.
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <map>
 #include <string>
 
@@ -33,11 +34,12 @@ SOFTWARE.
 #include "GLFW/glfw3.h"
 #endif
 
+#include "dual_quaternion.hh"
 #include "material.hh"
 #include "shader.hh"
 
 // These values are used to define shader varying inputs:
-static constexpr auto VBO_count = 7;
+static constexpr auto VBO_count = 8;
 static constexpr auto VBO_layout_EBO = VBO_count - 1;
 
 static constexpr auto VBO_layout_position = 0;
@@ -46,6 +48,25 @@ static constexpr auto VBO_layout_uv = 2;
 static constexpr auto VBO_layout_color = 3;
 static constexpr auto VBO_layout_joints = 4;
 static constexpr auto VBO_layout_weights = 5;
+static constexpr auto VBO_layout_tangent = 6;
+
+/// How the vertex attributes of a submesh are spread over its buffer objects
+enum class vertex_layout {
+  /// One buffer per attribute, in the VBO_layout_* slots
+  separate,
+  /// Two interleaved buffers: positions, normals and tangents, that the CPU
+  /// rewrites when morphing or skinning, in the VBO_stream_dynamic slot, and
+  /// the other attributes in the VBO_stream_static slot
+  interleaved
+};
+
+static constexpr auto VBO_stream_dynamic = VBO_layout_position;
+static constexpr auto VBO_stream_static = VBO_layout_uv;
+
+// Per instance inputs of instanced draws. Matrices take one location per
+// column
+static constexpr auto instance_layout_model = 7;
+static constexpr auto instance_layout_normal = 11;
 
 struct utility_buffers {
   static GLuint point_vbo, line_vbo, point_vao, line_vao, point_ebo, line_ebo;
@@ -76,27 +97,166 @@ void draw_space_base(GLuint shader, const float line_width,
 void draw_line(GLuint shader, const glm::vec3 origin, const glm::vec3 end,
                const glm::vec4 draw_color, const float line_width);
 
-/// Load all the shaders. Skinning shader needs t
-void load_shaders(const size_t nb_joints,
-                  std::map<std::string, shader>& shaders);
+/// The programs built by `load_shaders`
+enum class shader_id : unsigned {
+  unlit,
+  debug_color,
+  debug_uv,
+  debug_normals,
+  debug_normal_map,
+  debug_metallic_roughness_map,
+  debug_occlusion_map,
+  debug_emissive_map,
+  debug_base_color_map,
+  debug_applied_normal_mapping,
+  debug_vertex_color,
+  debug_frag_pos,
+  pbr_metal_rough,
+  weights,
+  count
+};
+
+/// Display name of `id`
+const char* shader_name(shader_id id);
+
+/// One program of each `shader_id`, built for a given number of joints
+class shader_registry {
+  std::array<shader, size_t(shader_id::count)> shaders_;
+
+ public:
+  shader& operator[](shader_id id) { return shaders_[size_t(id)]; }
+  const shader& operator[](shader_id id) const { return shaders_[size_t(id)]; }
+};
+
+/// Load all the shaders, with the skinning vertex shader if `skinned`.
+/// Linked programs are reused from, and saved to, `binaries` when given
+void load_shaders(
+    bool skinned, shader_registry& shaders,
+    const gltf_insight::program_binary_cache* binaries = nullptr);
 
-/// Update all shader's uniforms
-void update_uniforms(std::map<std::string, shader>& shaders, bool use_ibl,
-                     const glm::vec3& camera_position,
-                     const glm::vec3& light_color,
-                     const glm::vec3& light_direction, const int active_joint,
-                     const std::string& shader_to_use, const glm::mat4& model,
+/// Update the per draw uniforms of a shader. Camera, lights and materials
+/// are in uniform blocks, see `frame_uniforms` and `material_uniforms`
+void update_uniforms(const shader_registry& shaders, const int active_joint,
+                     shader_id shader_to_use, const glm::mat4& model,
                      const glm::mat4& mvp, const glm::mat3& normal,
-                     const std::vector<glm::mat4>& joint_matrices,
+                     GLint joint_palette_offset,
                      const glm::vec3& active_vertex);
 
+/// std140 layout of `frame_block`, uploaded once per frame
+struct frame_uniforms {
+  glm::vec4 highlight_color;
+  glm::vec3 camera_position;
+  GLint use_ibl;
+  glm::vec3 light_direction;
+  GLint dual_quaternion_skinning;
+  glm::vec3 light_color;
+  float padding_1;
+};
+static_assert(sizeof(frame_uniforms) == 64,
+              "frame_uniforms must match the std140 layout of frame_block");
+
+/// Joint transforms of the skinned meshes drawn in a frame, read by
+/// skinning_template.vert with texelFetch. A matrix takes its 3 first rows,
+/// the last one is always (0, 0, 0, 1), a dual quaternion takes 2 rows (real
+/// then dual part). The palette is a buffer texture, or a 2D texture
+/// `texture_width` texels wide with WebGL that has no buffer textures
+class joint_palette {
+  GLuint texture_ = 0;
+  GLuint buffer_ = 0;
+  std::vector<glm::vec4> rows_;
+
+ public:
+  /// Texture unit of the palette, after the ones used by the materials
+  static constexpr GLint texture_unit = GLint(gltf_insight::max_texture_slots);
+  /// Must match the width used by the skinning shader
+  static constexpr size_t texture_width = 1024;
+
+  void initialize();
+  void release();
+
+  /// Forget the matrices of the previous frame
+  void clear() { rows_.clear(); }
+
+  /// Add `matrices` to the palette. Returns the row of the first one, that
+  /// the skinning shader takes as `joint_palette_offset`
+  GLint append(const std::vector<glm::mat4>& matrices);
+
+  /// Add `matrices` to the palette as dual quaternions, for dual quaternion
+  /// skinning. Returns the row of the first one
+  GLint append_dual_quaternions(const std::vector<glm::mat4>& matrices);
+
+  /// Upload the palette and bind it to `texture_unit`
+  void upload();
+};
+
+/// Time spent setting the per draw uniforms, in nanoseconds per draw
+struct uniform_benchmark {
+  /// Program found in a map by its name, every uniform located by name
+  double by_name_ns = 0;
+  /// `update_uniforms`, through `shader_id` and the locations resolved at link
+  /// time, the rest being in uniform blocks
+  double by_id_ns = 0;
+  /// Joint matrices uploaded by the updates by name
+  size_t nb_joints = 0;
+};
+
+/// Run `update_uniforms` `iterations` times on the pbr_metal_rough program of
+/// `shaders`, and the updates that used to be done for each draw, by name.
+/// Those run on a program that still declares every uniform they set, with
+/// the array of `nb_joints` joint matrices the skinning shader used to have,
+/// clamped to what the vertex uniform storage holds.
+uniform_benchmark benchmark_uniform_updates(const shader_registry& shaders,
+                                            size_t nb_joints,
+                                            size_t iterations);
+
 /// Info needed to actually submit drawcall for a submesh
 struct draw_call_submesh_descriptor {
   GLenum draw_mode;
   size_t count;
   GLuint VAO;
+  /// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, set when the EBO is uploaded
+  GLenum index_type = GL_UNSIGNED_INT;
+  /// Bytes per vertex of the interleaved streams, 0 with the separate layout
+  GLsizei dynamic_stride = 0, static_stride = 0;
+};
+
+/// Layout of the elements of a vertex attribute in a buffer, as given to
+/// glVertexAttribPointer. Integer types are used for quantized attributes
+/// (KHR_mesh_quantization), and are converted to float by the GPU
+struct vertex_format {
+  GLenum component_type = GL_FLOAT;
+  GLint components = 0;
+  GLboolean normalized = GL_FALSE;
+  /// Bytes from one element to the next, 0 means tightly packed
+  GLsizei stride = 0;
+
+  static vertex_format floats(GLint components);
+
+  size_t element_size() const;
+  size_t byte_stride() const;
+};
+
+/// Point the attribute `location` of the bound VAO to `offset` bytes into the
+/// bound GL_ARRAY_BUFFER, and enable it
+void set_vertex_attribute(GLuint location, const vertex_format& format,
+                          size_t offset = 0);
+
+/// Transforms of one instance of an instanced draw call
+struct instance_transform {
+  glm::mat4 model;
+  glm::mat3 normal;
 };
 
+/// Point the per instance inputs of the bound VAO to `instance_buffer`, an
+/// array of `instance_transform`, and enable them
+void set_instance_attributes(GLuint instance_buffer);
+
 /// Perform the specified drawcall
 void perform_draw_call(
     const draw_call_submesh_descriptor& draw_call_to_perform);
+
+/// Perform the specified drawcall once per instance of the buffer given to
+/// `set_instance_attributes`
+void perform_instanced_draw_call(
+    const draw_call_submesh_descriptor& draw_call_to_perform,
+    GLsizei nb_instances);
@@ -38,13 +38,24 @@ SOFTWARE.
 #undef TINYGLTF_IMPLEMENTATION
 #undef STB_IMAGE_IMPLEMENTATION
 #undef STB_IMAGE_WRITE_IMPLEMENTATION
+#include "accessor_view.hh"
 #include "animation.hh"
+#include "draco_decoder.hh"
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "gltf-loader.hh"
 #include "tiny_gltf_util.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <numeric>
+
+using gltf_insight::accessor_view;
+
 void load_animations(const tinygltf::Model& model,
+                     const gltf_insight::buffer_data::overrides& buffers,
                      std::vector<animation>& animations) {
   const auto nb_animations = animations.size();
   for (int i = 0; i < nb_animations; ++i) {
@@ -81,14 +92,13 @@ void load_animations(const tinygltf::Model& model,
           gltf_animation.samplers[sampler_index], model);
       animations[i].samplers[sampler_index].keyframes.resize(nb_frames);
 
-      float value = 0;
+      std::vector<float> times;
+      accessor_view(model, buffers,
+                    gltf_animation.samplers[sampler_index].input)
+          .copy_to(times, 1);
       for (int keyframe = 0; keyframe < nb_frames; ++keyframe) {
-        tinygltf::util::DecodeScalarAnimationValue(
-            size_t(keyframe),
-            model.accessors[gltf_animation.samplers[sampler_index].input],
-            model, &value);
         animations[i].samplers[sampler_index].keyframes[keyframe] =
-            std::make_pair(keyframe, value);
+            std::make_pair(keyframe, times[size_t(keyframe)]);
       }
     }
 
@@ -109,17 +119,22 @@ void load_animations(const tinygltf::Model& model,
       const auto nb_frames =
           tinygltf::util::GetAnimationSamplerOutputCount(sampler, model);
       animations[i].channels[channel_index].keyframes.resize(nb_frames);
-      const auto& accessor = model.accessors[sampler.output];
+      // Integer keyframe values are always normalized, as only rotations and
+      // morph weights can use them
+      const auto& target_path =
+          gltf_animation.channels[channel_index].target_path;
+      accessor_view output(model, buffers, sampler.output);
+      if (target_path == "rotation" || target_path == "weights")
+        output.assume_normalized();
+      std::vector<float> values;
+      output.copy_to(values);
 
       if (gltf_animation.channels[channel_index].target_path == "weights") {
         animations[i].channels[channel_index].mode =
             animation::channel::path::weight;
 
-        float value;
-
         for (int frame = 0; frame < nb_frames; ++frame) {
-          tinygltf::util::DecodeScalarAnimationValue(size_t(frame), accessor,
-                                                     model, &value);
+          const float value = values[size_t(frame)];
           animations[i].channels[channel_index].keyframes[frame].first = frame;
           animations[i]
               .channels[channel_index]
@@ -132,11 +147,8 @@ void load_animations(const tinygltf::Model& model,
         animations[i].channels[channel_index].mode =
             animation::channel::path::translation;
 
-        float xyz[3];
-
         for (int frame = 0; frame < nb_frames; ++frame) {
-          tinygltf::util::DecodeTranslationAnimationValue(size_t(frame),
-                                                          accessor, model, xyz);
+          const float* xyz = &values[3 * size_t(frame)];
           animations[i].channels[channel_index].keyframes[frame].first = frame;
           animations[i]
               .channels[channel_index]
@@ -149,11 +161,8 @@ void load_animations(const tinygltf::Model& model,
         animations[i].channels[channel_index].mode =
             animation::channel::path::rotation;
 
-        float xyzw[4];
-
         for (int frame = 0; frame < nb_frames; ++frame) {
-          tinygltf::util::DecodeRotationAnimationValue(size_t(frame), accessor,
-                                                       model, xyzw);
+          const float* xyzw = &values[4 * size_t(frame)];
           glm::quat q;
           q.w = xyzw[3];
           q.x = xyzw[0];
@@ -172,11 +181,8 @@ void load_animations(const tinygltf::Model& model,
       if (gltf_animation.channels[channel_index].target_path == "scale") {
         animations[i].channels[channel_index].mode =
             animation::channel::path::scale;
-        float xyz[3];
-
         for (int frame = 0; frame < nb_frames; ++frame) {
-          tinygltf::util::DecodeScaleAnimationValue(size_t(frame), accessor,
-                                                    model, xyz);
+          const float* xyz = &values[3 * size_t(frame)];
           animations[i].channels[channel_index].keyframes[frame].first = frame;
           animations[i]
               .channels[channel_index]
@@ -190,409 +196,419 @@ void load_animations(const tinygltf::Model& model,
   }
 }
 
-glm::vec3 generate_flat_normal_for_triangle(std::vector<float>& position,
-                                            const unsigned i0,
-                                            const unsigned i1,
-                                            const unsigned i2) {
-  const glm::vec3 v0(position[i0 + 0], position[i0 + 1], position[i0 + 2]);
-  const glm::vec3 v1(position[i1 + 0], position[i1 + 1], position[i1 + 2]);
-  const glm::vec3 v2(position[i2 + 0], position[i2 + 1], position[i2 + 2]);
+namespace {
+// Component types glVertexAttribPointer reads the same way as glTF
+bool is_vertex_component_type(int component_type) {
+  return component_type == TINYGLTF_COMPONENT_TYPE_FLOAT ||
+         component_type == TINYGLTF_COMPONENT_TYPE_BYTE ||
+         component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE ||
+         component_type == TINYGLTF_COMPONENT_TYPE_SHORT ||
+         component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+}
+
+// Tangents are only used to apply normal maps
+bool has_normal_texture(const tinygltf::Model& model,
+                        const tinygltf::Primitive& primitive) {
+  if (primitive.material < 0 ||
+      size_t(primitive.material) >= model.materials.size())
+    return false;
+  const auto& values =
+      model.materials[size_t(primitive.material)].additionalValues;
+  return values.find("normalTexture") != values.end();
+}
 
-  return glm::normalize(glm::cross(v0 - v1, v1 - v2));
+// Turn a triangle strip or fan into a list. Picking, normal and tangent
+// generation and the OBJ export only deal with lists. Degenerate triangles,
+// that strips use to jump from one run to the next, are dropped
+void make_triangle_list(int mode, std::vector<unsigned>& indices) {
+  std::vector<unsigned> list;
+  if (indices.size() >= 3) list.reserve(3 * (indices.size() - 2));
+
+  for (size_t i = 2; i < indices.size(); ++i) {
+    unsigned corners[3];
+    if (mode == TINYGLTF_MODE_TRIANGLE_FAN) {
+      corners[0] = indices[0];
+      corners[1] = indices[i - 1];
+      corners[2] = indices[i];
+    } else {
+      // Every other triangle of a strip is flipped to keep the winding
+      corners[0] = indices[i - 2 + (i % 2)];
+      corners[1] = indices[i - 1 - (i % 2)];
+      corners[2] = indices[i];
+    }
+    if (corners[0] == corners[1] || corners[1] == corners[2] ||
+        corners[0] == corners[2])
+      continue;
+    list.insert(list.end(), std::begin(corners), std::end(corners));
+  }
+
+  indices.swap(list);
+}
+}  // namespace
+
+size_t borrowed_attribute::byte_size() const {
+  if (count == 0) return 0;
+  return format.byte_stride() * (count - 1) + format.element_size();
+}
+
+void borrowed_attribute::copy_to(std::vector<float>& output) const {
+  const size_t components = size_t(format.components);
+  output.resize(count * components);
+  if (empty()) return;
+
+  const auto* source = static_cast<const unsigned char*>(data);
+  if (format.normalized)
+    gltf_insight::accessor_detail::convert_from<float, true>(
+        int(format.component_type), source, format.byte_stride(), count,
+        components, output.data(), components);
+  else
+    gltf_insight::accessor_detail::convert_from<float, false>(
+        int(format.component_type), source, format.byte_stride(), count,
+        components, output.data(), components);
 }
 
 void load_geometry(
-    const tinygltf::Model& model, std::vector<GLuint>& textures,
+    const tinygltf::Model& model,
+    const gltf_insight::buffer_data::overrides& buffers,
     const std::vector<tinygltf::Primitive>& primitives,
     std::vector<draw_call_submesh_descriptor>& draw_call_descriptor,
-    std::vector<GLuint>& VAOs, std::vector<std::array<GLuint, VBO_count>>& VBOs,
     std::vector<std::vector<unsigned>>& indices,
     std::vector<std::vector<float>>& vertex_coord,
     std::vector<std::vector<float>>& texture_coord,
     std::vector<std::vector<float>>& colors,
     std::vector<std::vector<float>>& normals,
+    std::vector<std::vector<float>>& tangents,
     std::vector<std::vector<float>>& weights,
-    std::vector<std::vector<unsigned short>>& joints) {
+    std::vector<std::vector<unsigned short>>& joints,
+    std::vector<borrowed_geometry>* borrowed) {
   std::cout << "loading mesh geometry...\n";
 
+  // Keep a pointer to the glTF buffer instead of a copy when the caller allows
+  // it and the GPU can read the data as stored. Quantized attributes then stay
+  // quantized, the node transform takes care of the dequantization
+  const auto borrow_or_copy = [](const accessor_view& view, size_t components,
+                                 borrowed_attribute* borrow,
+                                 std::vector<float>& copy) {
+    if (borrow && view.data() && !view.is_sparse() && view.count() > 0 &&
+        view.components() == components &&
+        is_vertex_component_type(view.component_type())) {
+      borrow->data = view.data();
+      borrow->count = view.count();
+      borrow->format.component_type = GLenum(view.component_type());
+      borrow->format.components = GLint(components);
+      borrow->format.normalized = view.normalized() ? GL_TRUE : GL_FALSE;
+      borrow->format.stride = GLsizei(view.byte_stride());
+    } else {
+      view.copy_to(copy, components);
+    }
+  };
+
+  // Generating normals or tangents needs the borrowed values on the CPU, they
+  // are decoded to a temporary copy
+  const auto cpu_values = [](const borrowed_attribute* borrow,
+                             const std::vector<float>& values,
+                             std::vector<float>& copy)
+      -> const std::vector<float>& {
+    if (!borrow || borrow->empty()) return values;
+    borrow->copy_to(copy);
+    return copy;
+  };
+
   const auto nb_submeshes = primitives.size();
 
   for (size_t submesh = 0; submesh < nb_submeshes; ++submesh) {
     const auto& primitive = primitives[submesh];
 
-    // We have one VAO per "submesh" (= gltf primitive)
-    draw_call_descriptor[submesh].VAO = VAOs[submesh];
     // Primitive uses their own draw mode (eg: lines (for hairs?),
     // triangle fan/strip/list?)
     draw_call_descriptor[submesh].draw_mode = primitive.mode;
 
-    // TODO refcator the accessor -> array loading
+    const bool has_normals =
+        primitive.attributes.find("NORMAL") != primitive.attributes.end();
 
     // VERTEX POSITIONS
+    size_t vertex_count = 0;
     {
-      const auto position = primitive.attributes.at("POSITION");
-      const auto& position_accessor = model.accessors[position];
-      const auto& position_buffer_view =
-          model.bufferViews[position_accessor.bufferView];
-      const auto& position_buffer = model.buffers[position_buffer_view.buffer];
-      const auto position_stride =
-          position_accessor.ByteStride(position_buffer_view);
-      const auto position_start_pointer = position_buffer.data.data() +
-                                          position_buffer_view.byteOffset +
-                                          position_accessor.byteOffset;
-      const size_t byte_size_of_component =
-          tinygltf::GetComponentSizeInBytes(position_accessor.componentType);
-      assert(position_accessor.type == TINYGLTF_TYPE_VEC3);
-      assert(sizeof(double) >= byte_size_of_component);
-
-      vertex_coord[submesh].resize(position_accessor.count * 3);
-      for (size_t i = 0; i < position_accessor.count; ++i) {
-        if (byte_size_of_component == sizeof(double)) {
-          double temp[3];
-          memcpy(&temp, position_start_pointer + i * position_stride,
-                 byte_size_of_component * 3);
-          for (size_t j = 0; j < 3; ++j) {
-            vertex_coord[submesh][i * 3 + j] = float(temp[j]);
-          }
-        } else if (byte_size_of_component == sizeof(float)) {
-          memcpy(&vertex_coord[submesh][i * 3],
-                 position_start_pointer + i * position_stride,
-                 byte_size_of_component * 3);
-        }
-      }
+      const accessor_view position(model, buffers,
+                                   primitive.attributes.at("POSITION"));
+      assert(position.components() == 3);
+      vertex_count = position.count();
+
+      // Missing normals are computed from the positions on the CPU
+      borrow_or_copy(
+          position, 3,
+          borrowed && has_normals ? &(*borrowed)[submesh].position : nullptr,
+          vertex_coord[submesh]);
     }
 
     // INDEX BUFFER
     if (primitive.indices != -1) {
-      const auto& indices_accessor = model.accessors[primitive.indices];
-      const auto& indices_buffer_view =
-          model.bufferViews[indices_accessor.bufferView];
-      const auto& indices_buffer = model.buffers[indices_buffer_view.buffer];
-      const auto indices_start_pointer = indices_buffer.data.data() +
-                                         indices_buffer_view.byteOffset +
-                                         indices_accessor.byteOffset;
-      const auto indices_stride =
-          indices_accessor.ByteStride(indices_buffer_view);
-      indices[submesh].resize(indices_accessor.count);
-      const size_t byte_size_of_component =
-          tinygltf::GetComponentSizeInBytes(indices_accessor.componentType);
-      assert(indices_accessor.type == TINYGLTF_TYPE_SCALAR);
-      assert(sizeof(unsigned int) >= byte_size_of_component);
-
-      for (size_t i = 0; i < indices_accessor.count; ++i) {
-        unsigned int temp = 0;
-        memcpy(&temp, indices_start_pointer + i * indices_stride,
-               byte_size_of_component);
-        indices[submesh][i] = unsigned(temp);
-      }
-      // number of elements to pass to glDrawElements(...)
-      draw_call_descriptor[submesh].count = indices_accessor.count;
+      const accessor_view index(model, buffers, primitive.indices);
+      assert(index.components() == 1);
+      index.copy_to(indices[submesh]);
     } else {
-      unsigned value = 0;  // temporary variable used by std::generate
-      // generate index buffer here
-
-      // TODO this utility could be added to tinygltf
-      const auto get_vertex_per_primitive = [](GLuint mode) -> size_t {
-        switch (mode) {
-          case TINYGLTF_MODE_TRIANGLES:
-          case TINYGLTF_MODE_TRIANGLE_FAN:
-          case TINYGLTF_MODE_TRIANGLE_STRIP:
-            return 3;
-
-          case TINYGLTF_MODE_LINE:
-          case TINYGLTF_MODE_LINE_LOOP:
-          case TINYGLTF_MODE_LINE_STRIP:
-            return 2;
-
-          case TINYGLTF_MODE_POINTS:
-            return 1;
-
-          default:
-            std::cerr << "Warn: cannot compute the number of vertex used in "
-                         "primitive mode "
-                      << mode << "\n";
-            return 0;
-        }
-      };
-
-      const auto vertex_per_primitive =
-          get_vertex_per_primitive(primitive.mode);
-      switch (primitive.mode) {
-        // These only use a sequence of contiguous numbers
-        case TINYGLTF_MODE_TRIANGLES:
-        case TINYGLTF_MODE_LINE:
-        case TINYGLTF_MODE_POINTS:
-          indices[submesh].resize(vertex_coord[submesh].size() /
-                                  vertex_per_primitive);
-          std::generate(indices[submesh].begin(), indices[submesh].end(),
-                        [&] { return value++; });
-          draw_call_descriptor[submesh].count = indices[submesh].size();
-          break;
-
-        default:
-          std::cerr << "TODO implement index buffer generation for triangle "
-                       "strip / triangle fan and line strip/loop";
-          break;
-      }
+      // Non indexed primitives use their vertices in order, whatever the mode
+      indices[submesh].resize(vertex_count);
+      std::iota(indices[submesh].begin(), indices[submesh].end(), 0u);
     }
 
+    // Strips and fans are converted once here, instead of by every user
+    if (primitive.mode == TINYGLTF_MODE_TRIANGLE_STRIP ||
+        primitive.mode == TINYGLTF_MODE_TRIANGLE_FAN) {
+      make_triangle_list(primitive.mode, indices[submesh]);
+      draw_call_descriptor[submesh].draw_mode = GL_TRIANGLES;
+    }
+
+    // number of elements to pass to glDrawElements(...)
+    draw_call_descriptor[submesh].count = indices[submesh].size();
+
     // VERTEX NORMAL
     bool generate_normals = false;
-    if (primitive.attributes.find("NORMAL") != primitive.attributes.end()) {
-      const auto normal = primitive.attributes.at("NORMAL");
-      const auto& normal_accessor = model.accessors[normal];
-      const auto& normal_buffer_view =
-          model.bufferViews[normal_accessor.bufferView];
-      const auto& normal_buffer = model.buffers[normal_buffer_view.buffer];
-      const auto normal_stride = normal_accessor.ByteStride(normal_buffer_view);
-      const auto normal_start_pointer = normal_buffer.data.data() +
-                                        normal_buffer_view.byteOffset +
-                                        normal_accessor.byteOffset;
-      const size_t byte_size_of_component =
-          tinygltf::GetComponentSizeInBytes(normal_accessor.componentType);
-      assert(normal_accessor.type == TINYGLTF_TYPE_VEC3);
-      assert(sizeof(double) >= byte_size_of_component);
-
-      normals[submesh].resize(normal_accessor.count * 3);
-      for (size_t i = 0; i < normal_accessor.count; ++i) {
-        if (byte_size_of_component == sizeof(double)) {
-          double temp[3];
-          memcpy(&temp, normal_start_pointer + i * normal_stride,
-                 byte_size_of_component * 3);
-          for (size_t j = 0; j < 3; ++j) {
-            normals[submesh][i * 3 + j] = float(temp[j]);  // downcast to
-            // float
-          }
-        } else if (byte_size_of_component == sizeof(float)) {
-          memcpy(&normals[submesh][i * 3],
-                 normal_start_pointer + i * normal_stride,
-                 byte_size_of_component * 3);
-        }
-      }
+    if (has_normals) {
+      const accessor_view normal(model, buffers,
+                                 primitive.attributes.at("NORMAL"));
+      assert(normal.components() == 3);
+      borrow_or_copy(normal, 3,
+                     borrowed ? &(*borrowed)[submesh].normal : nullptr,
+                     normals[submesh]);
     } else {
       generate_normals = true;
     }
 
     // VERTEX UV
-    if (textures.size() > 0) {
-      const auto texture = primitive.attributes.at("TEXCOORD_0");
-      const auto& texture_accessor = model.accessors[texture];
-      const auto& texture_buffer_view =
-          model.bufferViews[texture_accessor.bufferView];
-      const auto& texture_buffer = model.buffers[texture_buffer_view.buffer];
-      const auto texture_stride =
-          texture_accessor.ByteStride(texture_buffer_view);
-      const auto texture_start_pointer = texture_buffer.data.data() +
-                                         texture_buffer_view.byteOffset +
-                                         texture_accessor.byteOffset;
-      const size_t byte_size_of_component =
-          tinygltf::GetComponentSizeInBytes(texture_accessor.componentType);
-      assert(texture_accessor.type == TINYGLTF_TYPE_VEC2);
-      assert(sizeof(double) >= byte_size_of_component);
-
-      texture_coord[submesh].resize(texture_accessor.count * 2);
-      for (size_t i = 0; i < texture_accessor.count; ++i) {
-        if (byte_size_of_component == sizeof(double)) {
-          double temp[2];
-          memcpy(&temp, texture_start_pointer + i * texture_stride,
-                 byte_size_of_component * 2);
-          for (size_t j = 0; j < 2; ++j) {
-            texture_coord[submesh][i * 2 + j] = float(temp[j]);  // downcast
-            // to float
-          }
-        } else if (byte_size_of_component == sizeof(float)) {
-          memcpy(&texture_coord[submesh][i * 2],
-                 texture_start_pointer + i * texture_stride,
-                 byte_size_of_component * 2);
-        }
-      }
+    if (primitive.attributes.find("TEXCOORD_0") !=
+        std::end(primitive.attributes)) {
+      // KHR_mesh_quantization allows non normalized integer UVs, the
+      // accessor's flag is followed
+      const accessor_view texture(model, buffers,
+                                  primitive.attributes.at("TEXCOORD_0"));
+      assert(texture.components() == 2);
+      borrow_or_copy(texture, 2, borrowed ? &(*borrowed)[submesh].uv : nullptr,
+                     texture_coord[submesh]);
+    }
+
+    // VERTEX TANGENT
+    const auto tangent_it = primitive.attributes.find("TANGENT");
+    const bool generate_tangents =
+        tangent_it == primitive.attributes.end() &&
+        primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end() &&
+        has_normal_texture(model, primitive);
+    if (tangent_it != primitive.attributes.end()) {
+      const accessor_view tangent(model, buffers, tangent_it->second);
+      assert(tangent.components() == 4);
+      borrow_or_copy(tangent, 4,
+                     borrowed ? &(*borrowed)[submesh].tangent : nullptr,
+                     tangents[submesh]);
     }
 
-    bool has_joints = false;
     // VERTEX JOINTS ASSIGNMENT
     if (primitive.attributes.find("JOINTS_0") !=
         std::end(primitive.attributes)) {
-      has_joints = true;
-      const auto joint = primitive.attributes.at("JOINTS_0");
-      const auto& joints_accessor = model.accessors[joint];
-      const auto& joints_buffer_view =
-          model.bufferViews[joints_accessor.bufferView];
-      const auto& joints_buffer = model.buffers[joints_buffer_view.buffer];
-      const auto joints_stride = joints_accessor.ByteStride(joints_buffer_view);
-      const auto joints_start_pointer = joints_buffer.data.data() +
-                                        joints_buffer_view.byteOffset +
-                                        joints_accessor.byteOffset;
-      const size_t byte_size_of_component =
-          tinygltf::GetComponentSizeInBytes(joints_accessor.componentType);
-      assert(joints_accessor.type == TINYGLTF_TYPE_VEC4);
-      assert(sizeof(unsigned short) >= byte_size_of_component);
-
-      joints[submesh].resize(4 * joints_accessor.count);
-
-      for (size_t i = 0; i < joints_accessor.count; ++i) {
-        memcpy(&joints[submesh][i * 4],
-               joints_start_pointer + i * joints_stride,
-               byte_size_of_component * 4);
-      }
+      const accessor_view joint(model, buffers,
+                                primitive.attributes.at("JOINTS_0"));
+      assert(joint.components() == 4);
+      joint.copy_to(joints[submesh], 4);
     }
 
     // VERTEX BONE WEIGHTS
-    bool has_weights = false;
     if (primitive.attributes.find("WEIGHTS_0") !=
         std::end(primitive.attributes)) {
-      has_weights = true;
-      const auto weight = primitive.attributes.at("WEIGHTS_0");
-      const auto& weights_accessor = model.accessors[weight];
-      const auto& weights_buffer_view =
-          model.bufferViews[weights_accessor.bufferView];
-      const auto& weights_buffer = model.buffers[weights_buffer_view.buffer];
-      const auto weights_stride =
-          weights_accessor.ByteStride(weights_buffer_view);
-      const auto weights_start_pointer = weights_buffer.data.data() +
-                                         weights_buffer_view.byteOffset +
-                                         weights_accessor.byteOffset;
-      const size_t byte_size_of_component =
-          tinygltf::GetComponentSizeInBytes(weights_accessor.componentType);
-      assert(weights_accessor.type == TINYGLTF_TYPE_VEC4);
-      assert(sizeof(float) >= byte_size_of_component);
-
-      weights[submesh].resize(4 * weights_accessor.count);
-
-      for (size_t i = 0; i < weights_accessor.count; ++i) {
-        if (weights_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-          memcpy(&weights[submesh][i * 4],
-                 weights_start_pointer + i * weights_stride,
-                 byte_size_of_component * 4);
-        } else {
-          // Must convert normalized unsigned value to floating point
-          unsigned short temp = 0;
-          for (int j = 0; j < 4; j++) {
-            memcpy(&temp,
-                   weights_start_pointer + i * weights_stride +
-                       j * byte_size_of_component,
-                   byte_size_of_component);
-            weights[submesh][i * 4 + j] =
-                float(temp) /
-                (byte_size_of_component == 2 ? float(0xFFFF) : float(0xFF));
-          }
-        }
-      }
+      accessor_view weight(model, buffers,
+                           primitive.attributes.at("WEIGHTS_0"));
+      assert(weight.components() == 4);
+      weight.assume_normalized().copy_to(weights[submesh], 4);
     }
 
     // VERTEX COLORS
     if (primitive.attributes.find("COLOR_0") !=
         std::end(primitive.attributes)) {
-      const auto color = primitive.attributes.at("COLOR_0");
-      const auto& colors_accessor = model.accessors[color];
-      const auto& colors_buffer_view =
-          model.bufferViews[colors_accessor.bufferView];
-      const auto& colors_buffer = model.buffers[colors_buffer_view.buffer];
-      const auto colors_stride = colors_accessor.ByteStride(colors_buffer_view);
-      const auto colors_start_pointer = colors_buffer.data.data() +
-                                        colors_buffer_view.byteOffset +
-                                        colors_accessor.byteOffset;
-      const size_t byte_size_of_component =
-          tinygltf::GetComponentSizeInBytes(colors_accessor.componentType);
-
-      // Detect if we have an RGB or RGBA color. In case of RGB, we will convert
-      // to RGBA by inserting A=1.f to the array
-      bool insert_alpha = false;
-      if (colors_accessor.type == TINYGLTF_TYPE_VEC3) insert_alpha = true;
-
-      assert(sizeof(float) >= byte_size_of_component);
-
-      colors[submesh].resize(4 * colors_accessor.count);
-
-      for (size_t i = 0; i < colors_accessor.count; ++i) {
-        if (colors_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-          memcpy(&colors[submesh][i * 4],
-                 colors_start_pointer + i * colors_stride,
-                 byte_size_of_component * (!insert_alpha ? 4 : 3));
-        } else {
-          // Must convert normalized unsigned value to floating point
-          unsigned short temp = 0;
-          for (int j = 0; j < 4; j++) {
-            memcpy(&temp,
-                   colors_start_pointer + i * colors_stride +
-                       j * byte_size_of_component,
-                   byte_size_of_component);
-            colors[submesh][i * 4 + j] =
-                float(temp) /
-                (byte_size_of_component == 2 ? float(0xFFFF) : float(0xFF));
-          }
-        }
-
-        if (insert_alpha) {
-          colors[submesh][4 * i + 3] = 1.f;
-        }
-      }
+      // RGB colors are converted to RGBA by inserting A=1.f in the array
+      accessor_view color(model, buffers,
+                          primitive.attributes.at("COLOR_0"));
+      assert(color.components() == 3 || color.components() == 4);
+      color.assume_normalized().copy_to(colors[submesh], 4, 1.f);
     } else {
-      colors[submesh].resize((vertex_coord[submesh].size() / 3) * 4);
+      colors[submesh].resize(vertex_count * 4);
       std::generate(colors[submesh].begin(), colors[submesh].end(),
                     [] { return 1.f; });
     }
 
-    if (generate_normals) {
-      std::cerr << "Warn: Needed to generate flat normals for this model\n";
-      // size of array should match
-      normals[submesh].resize(vertex_coord[submesh].size());
-
-      // TODO this assume primitve is TINYGLTF_MODE_TRIANGLES
-      // for each triangle
-      if (primitive.mode == TINYGLTF_MODE_TRIANGLES) {
-        for (size_t tri = 0; tri < indices[submesh].size() / 3; ++tri) {
-          const auto i0 = indices[submesh][3 * tri + 0];
-          const auto i1 = indices[submesh][3 * tri + 1];
-          const auto i2 = indices[submesh][3 * tri + 2];
-
-          const glm::vec3 n = generate_flat_normal_for_triangle(
-              vertex_coord[submesh], i0, i1, i2);
-
-          normals[submesh][i0 + 0] = normals[submesh][i1 + 0] =
-              normals[submesh][i2 + 0] = n.x;
-          normals[submesh][i0 + 1] = normals[submesh][i1 + 1] =
-              normals[submesh][i2 + 1] = n.y;
-          normals[submesh][i0 + 2] = normals[submesh][i1 + 2] =
-              normals[submesh][i2 + 2] = n.z;
-        }
-      } else {
+    if (!generate_normals && !generate_tangents) continue;
+    if (generate_normals) normals[submesh].resize(vertex_coord[submesh].size());
+    if (draw_call_descriptor[submesh].draw_mode != GL_TRIANGLES) {
+      if (generate_normals)
         std::cerr << "Warn: a primitive of a mesh does not define "
-                     "normals, and is not TRIANGLE primitive. The unlikely "
+                     "normals, and is not made of triangles. The unlikely "
                      "scenario you were to lazy to implement happened.\n";
-      }
+      continue;
     }
 
-    {
-      // GPU upload and shader layout association
-      glBindVertexArray(VAOs[submesh]);
+    // Smooth normals and MikkTSpace tangents, see tangent_space.hh
+    if (generate_normals)
+      std::cerr << "Warn: Needed to generate smooth normals for this model\n";
+    const auto* borrowed_submesh = borrowed ? &(*borrowed)[submesh] : nullptr;
+    std::vector<float> position_copy, normal_copy, uv_copy;
+    const auto& position =
+        cpu_values(borrowed_submesh ? &borrowed_submesh->position : nullptr,
+                   vertex_coord[submesh], position_copy);
+    const auto& uv =
+        cpu_values(borrowed_submesh ? &borrowed_submesh->uv : nullptr,
+                   texture_coord[submesh], uv_copy);
+    const gltf_insight::tangent_space_generator generator(indices[submesh],
+                                                          position, uv);
+
+    if (generate_normals)
+      generator.generate_normals(position, normals[submesh]);
+    if (generate_tangents)
+      generator.generate_tangents(
+          position,
+          cpu_values(borrowed_submesh ? &borrowed_submesh->normal : nullptr,
+                     normals[submesh], normal_copy),
+          tangents[submesh]);
+  }
+}
+
+namespace {
+// An attribute placed in an interleaved vertex stream
+struct stream_attribute {
+  GLuint location;
+  borrowed_attribute source;
+};
+
+// Interleave the non empty `attributes` of `nb_vertices` vertices into the
+// bound GL_ARRAY_BUFFER, each one aligned on 4 bytes and in its stored format,
+// and point the bound VAO to them. Returns the stride of the stream
+GLsizei upload_interleaved(const std::vector<stream_attribute>& attributes,
+                           size_t nb_vertices, GLenum usage) {
+  std::vector<size_t> offsets;
+  size_t stride = 0;
+  for (const auto& attribute : attributes) {
+    offsets.push_back(stride);
+    if (attribute.source.count > 0)
+      stride += (attribute.source.format.element_size() + 3) & ~size_t(3);
+  }
+
+  std::vector<unsigned char> stream(stride * nb_vertices);
+  for (size_t i = 0; i < attributes.size(); ++i) {
+    const auto& source = attributes[i].source;
+    if (source.count == 0) continue;
+
+    const auto* data = static_cast<const unsigned char*>(source.data);
+    const size_t element_size = source.format.element_size();
+    const size_t source_stride = source.format.byte_stride();
+    for (size_t v = 0; v < std::min(nb_vertices, source.count); ++v)
+      memcpy(&stream[v * stride + offsets[i]], data + v * source_stride,
+             element_size);
+  }
+  glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(stream.size()), stream.data(),
+               usage);
+
+  for (size_t i = 0; i < attributes.size(); ++i) {
+    if (attributes[i].source.count == 0) continue;
+    auto format = attributes[i].source.format;
+    format.stride = GLsizei(stride);
+    set_vertex_attribute(attributes[i].location, format, offsets[i]);
+  }
+  return GLsizei(stride);
+}
+
+// View a CPU array as an attribute
+template <typename T>
+borrowed_attribute cpu_attribute(const std::vector<T>& values, GLenum type,
+                                 GLint components) {
+  borrowed_attribute attribute;
+  attribute.data = values.data();
+  attribute.format.component_type = type;
+  attribute.format.components = components;
+  attribute.count = values.size() / size_t(components);
+  return attribute;
+}
+}  // namespace
+
+void upload_geometry(
+    std::vector<draw_call_submesh_descriptor>& draw_call_descriptor,
+    const std::vector<GLuint>& VAOs,
+    const std::vector<std::array<GLuint, VBO_count>>& VBOs,
+    const std::vector<std::vector<unsigned>>& indices,
+    const std::vector<std::vector<float>>& vertex_coord,
+    const std::vector<std::vector<float>>& texture_coord,
+    const std::vector<std::vector<float>>& colors,
+    const std::vector<std::vector<float>>& normals,
+    const std::vector<std::vector<float>>& tangents,
+    const std::vector<std::vector<float>>& weights,
+    const std::vector<std::vector<unsigned short>>& joints,
+    const std::vector<borrowed_geometry>& borrowed, vertex_layout layout) {
+  // Borrowed attributes take precedence over the (then empty) CPU arrays
+  const auto source = [&](size_t submesh,
+                          borrowed_attribute borrowed_geometry::*attribute,
+                          const std::vector<float>& copy)
+      -> borrowed_attribute {
+    if (submesh < borrowed.size() && !(borrowed[submesh].*attribute).empty())
+      return borrowed[submesh].*attribute;
+    borrowed_attribute cpu_data;
+    cpu_data.data = copy.data();
+    cpu_data.format = vertex_format::floats(
+        attribute == &borrowed_geometry::uv
+            ? 2
+            : attribute == &borrowed_geometry::tangent ? 4 : 3);
+    cpu_data.count = copy.size() / size_t(cpu_data.format.components);
+    return cpu_data;
+  };
+
+  for (size_t submesh = 0; submesh < draw_call_descriptor.size(); ++submesh) {
+    const auto position =
+        source(submesh, &borrowed_geometry::position, vertex_coord[submesh]);
+    const auto normal =
+        source(submesh, &borrowed_geometry::normal, normals[submesh]);
+    const auto uv =
+        source(submesh, &borrowed_geometry::uv, texture_coord[submesh]);
+    const auto tangent =
+        source(submesh, &borrowed_geometry::tangent, tangents[submesh]);
+
+    // We have one VAO per "submesh" (= gltf primitive)
+    draw_call_descriptor[submesh].VAO = VAOs[submesh];
 
+    // GPU upload and shader layout association
+    glBindVertexArray(VAOs[submesh]);
+
+    if (layout == vertex_layout::interleaved) {
+      glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh][VBO_stream_dynamic]);
+      draw_call_descriptor[submesh].dynamic_stride = upload_interleaved(
+          {{VBO_layout_position, position},
+           {VBO_layout_normal, normal},
+           {VBO_layout_tangent, tangent}},
+          position.count, GL_DYNAMIC_DRAW);
+
+      // Joints and weights lead the static stream, so that editing the skin
+      // of a vertex rewrites a single range of it
+      glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh][VBO_stream_static]);
+      draw_call_descriptor[submesh].static_stride = upload_interleaved(
+          {{VBO_layout_joints,
+            cpu_attribute(joints[submesh], GL_UNSIGNED_SHORT, 4)},
+           {VBO_layout_weights, cpu_attribute(weights[submesh], GL_FLOAT, 4)},
+           {VBO_layout_uv, uv},
+           {VBO_layout_color, cpu_attribute(colors[submesh], GL_FLOAT, 4)}},
+          position.count, GL_STATIC_DRAW);
+    } else {
       // Layout "0" = vertex coordinates
       glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh][VBO_layout_position]);
-      glBufferData(GL_ARRAY_BUFFER,
-                   vertex_coord[submesh].size() * sizeof(float),
-                   vertex_coord[submesh].data(), GL_DYNAMIC_DRAW);
-      glVertexAttribPointer(VBO_layout_position, 3, GL_FLOAT, GL_FALSE,
-                            3 * sizeof(float), nullptr);
-      glEnableVertexAttribArray(VBO_layout_position);
+      glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(position.byte_size()),
+                   position.data, GL_DYNAMIC_DRAW);
+      set_vertex_attribute(VBO_layout_position, position.format);
 
       // Layout "1" = vertex normal
       glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh][VBO_layout_normal]);
-      glBufferData(GL_ARRAY_BUFFER, normals[submesh].size() * sizeof(float),
-                   normals[submesh].data(), GL_DYNAMIC_DRAW);
-      glVertexAttribPointer(VBO_layout_normal, 3, GL_FLOAT, GL_FALSE,
-                            3 * sizeof(float), nullptr);
-      glEnableVertexAttribArray(VBO_layout_normal);
-
-      // We we haven't loaded any texture, don't even bother with UVs
-      if (textures.size() > 0) {
+      glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(normal.byte_size()), normal.data,
+                   GL_DYNAMIC_DRAW);
+      set_vertex_attribute(VBO_layout_normal, normal.format);
+
+      // If the primitive doesn't have UVs, don't even bother
+      if (uv.count > 0) {
         // Layout "2" = vertex UV
         glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh][VBO_layout_uv]);
-        glBufferData(GL_ARRAY_BUFFER,
-                     texture_coord[submesh].size() * sizeof(float),
-                     texture_coord[submesh].data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(VBO_layout_uv, 2, GL_FLOAT, GL_FALSE,
-                              2 * sizeof(float), nullptr);
-        glEnableVertexAttribArray(VBO_layout_uv);
+        glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(uv.byte_size()), uv.data,
+                     GL_STATIC_DRAW);
+        set_vertex_attribute(VBO_layout_uv, uv.format);
       }
 
       // colors is layout 3
@@ -604,18 +620,17 @@ void load_geometry(
       glEnableVertexAttribArray(VBO_layout_color);
 
       // Layout "4" joints assignment vector
-      if (has_joints) {
+      if (!joints[submesh].empty()) {
         glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh][VBO_layout_joints]);
         glBufferData(GL_ARRAY_BUFFER,
                      joints[submesh].size() * sizeof(unsigned short),
                      joints[submesh].data(), GL_STATIC_DRAW);
         glVertexAttribPointer(VBO_layout_joints, 4, GL_UNSIGNED_SHORT, GL_FALSE,
-                              VBO_layout_joints * sizeof(unsigned short),
-                              nullptr);
-        glEnableVertexAttribArray(4);
+                              4 * sizeof(unsigned short), nullptr);
+        glEnableVertexAttribArray(VBO_layout_joints);
       }
 
-      if (has_weights) {
+      if (!weights[submesh].empty()) {
         // Layout "5" joints weights
         glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh][VBO_layout_weights]);
         glBufferData(GL_ARRAY_BUFFER, weights[submesh].size() * sizeof(float),
@@ -625,17 +640,112 @@ void load_geometry(
         glEnableVertexAttribArray(VBO_layout_weights);
       }
 
-      // EBO
-      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, VBOs[submesh][VBO_layout_EBO]);
+      // Layout "6" = vertex tangent, only normal mapped primitives have one
+      if (tangent.count > 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh][VBO_layout_tangent]);
+        glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(tangent.byte_size()),
+                     tangent.data, GL_DYNAMIC_DRAW);
+        set_vertex_attribute(VBO_layout_tangent, tangent.format);
+      }
+    }
+
+    // EBO, in 16 bits when the indices fit. 0xFFFF is left out as WebGL
+    // always treats it as a primitive restart
+    const auto& submesh_indices = indices[submesh];
+    const bool short_indices =
+        submesh_indices.empty() ||
+        *std::max_element(submesh_indices.begin(), submesh_indices.end()) <
+            0xFFFF;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, VBOs[submesh][VBO_layout_EBO]);
+    if (short_indices) {
+      const std::vector<GLushort> narrow(submesh_indices.begin(),
+                                         submesh_indices.end());
+      glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                   GLsizeiptr(narrow.size() * sizeof(GLushort)), narrow.data(),
+                   GL_STATIC_DRAW);
+      draw_call_descriptor[submesh].index_type = GL_UNSIGNED_SHORT;
+    } else {
       glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                   indices[submesh].size() * sizeof(unsigned),
-                   indices[submesh].data(), GL_STATIC_DRAW);
-      glBindVertexArray(0);
+                   GLsizeiptr(submesh_indices.size() * sizeof(unsigned)),
+                   submesh_indices.data(), GL_STATIC_DRAW);
+      draw_call_descriptor[submesh].index_type = GL_UNSIGNED_INT;
     }
+    glBindVertexArray(0);
   }
 }
 
+namespace {
+// Load a target that only has sparse data as the list of vertices it moves.
+// Returns false, leaving `loaded` untouched, if the target has dense data or
+// if the dense form would be smaller
+bool load_sparse_morph_target(
+    const tinygltf::Model& model,
+    const gltf_insight::buffer_data::overrides& buffers,
+    const std::map<std::string, int>& target, morph_target& loaded) {
+  const auto position_it = target.find("POSITION");
+  if (position_it == target.end()) return false;
+
+  const accessor_view position(model, buffers, position_it->second);
+  if (!position.is_sparse_only()) return false;
+
+  // Normal and tangent deltas are optional, but need to be sparse too
+  static const char* const names[] = {"POSITION", "NORMAL", "TANGENT"};
+  std::vector<float> morph_target::*const deltas[] = {
+      &morph_target::position, &morph_target::normal, &morph_target::tangent};
+  std::vector<uint32_t> indices[3];
+  std::vector<float> values[3];
+  bool present[3] = {true, false, false};
+  position.copy_sparse_to(indices[0], values[0], 3);
+  for (size_t a = 1; a < 3; ++a) {
+    const auto it = target.find(names[a]);
+    if (it == target.end()) continue;
+    const accessor_view attribute(model, buffers, it->second);
+    if (!attribute.is_sparse_only() || attribute.count() != position.count())
+      return false;
+    attribute.copy_sparse_to(indices[a], values[a], 3);
+    present[a] = true;
+  }
+
+  // The attributes may not move the same vertices
+  std::vector<unsigned> vertices;
+  for (const auto& attribute_indices : indices)
+    vertices.insert(vertices.end(), attribute_indices.begin(),
+                    attribute_indices.end());
+  std::sort(vertices.begin(), vertices.end());
+  vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+  const size_t nb_attributes =
+      size_t(std::count(std::begin(present), std::end(present), true));
+  const size_t sparse_size =
+      vertices.size() * (sizeof(unsigned) + nb_attributes * 3 * sizeof(float));
+  const size_t dense_size =
+      position.count() * nb_attributes * 3 * sizeof(float);
+  if (sparse_size >= dense_size) return false;
+
+  const auto gather = [&](const std::vector<uint32_t>& attribute_indices,
+                          const std::vector<float>& attribute_values,
+                          std::vector<float>& output) {
+    output.assign(vertices.size() * 3, 0.f);
+    for (size_t i = 0; i < attribute_indices.size(); ++i) {
+      const auto slot = size_t(std::lower_bound(vertices.begin(),
+                                                vertices.end(),
+                                                attribute_indices[i]) -
+                               vertices.begin());
+      std::copy(attribute_values.begin() + std::ptrdiff_t(3 * i),
+                attribute_values.begin() + std::ptrdiff_t(3 * i + 3),
+                output.begin() + std::ptrdiff_t(3 * slot));
+    }
+  };
+
+  for (size_t a = 0; a < 3; ++a)
+    if (present[a]) gather(indices[a], values[a], loaded.*deltas[a]);
+  loaded.vertices = std::move(vertices);
+  return true;
+}
+}  // namespace
+
 void load_morph_targets(const tinygltf::Model& model,
+                        const gltf_insight::buffer_data::overrides& buffers,
                         const tinygltf::Primitive& primitive,
                         std::vector<morph_target>& morph_targets,
                         bool& has_normal, bool& has_tangent) {
@@ -646,129 +756,123 @@ void load_morph_targets(const tinygltf::Model& model,
     const auto normal_it = target.find("NORMAL");
     const auto tangent_it = target.find("TANGENT");
 
-    if (position_it != target.end()) {
-      const auto& position_accessor = model.accessors[position_it->second];
-      const auto& position_buffer_view =
-          model.bufferViews[position_accessor.bufferView];
-      const auto& position_buffer = model.buffers[position_buffer_view.buffer];
-      const auto position_data_start = position_buffer.data.data() +
-                                       position_buffer_view.byteOffset +
-                                       position_accessor.byteOffset;
-      const auto stride = position_accessor.ByteStride(position_buffer_view);
-
-      assert(position_accessor.type == TINYGLTF_TYPE_VEC3);
-      assert(position_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-
-      morph_targets[i].position.resize(3 * position_accessor.count);
-      for (size_t vertex = 0; vertex < position_accessor.count; ++vertex) {
-        memcpy(&morph_targets[i].position[3 * vertex],
-               position_data_start + vertex * stride, sizeof(float) * 3);
-      }
+    if (normal_it != target.end()) has_normal = true;
+    if (tangent_it != target.end()) has_tangent = true;
 
-      if (position_accessor.sparse.isSparse) {
-        const auto sparse_indices = position_accessor.sparse.indices;
-        const auto indices_component_size = tinygltf::GetComponentSizeInBytes(
-            position_accessor.sparse.indices.componentType);
-        const auto& indices_buffer_view =
-            model.bufferViews[sparse_indices.bufferView];
-        const auto& indices_buffer = model.buffers[indices_buffer_view.buffer];
-        const auto indices_data = indices_buffer.data.data() +
-                                  indices_buffer_view.byteOffset +
-                                  sparse_indices.byteOffset;
-
-        assert(sizeof(unsigned int) >= indices_component_size);
-
-        const auto sparse_values = position_accessor.sparse.values;
-        const auto& values_buffer_view =
-            model.bufferViews[sparse_values.bufferView];
-        const auto& values_buffer = model.buffers[values_buffer_view.buffer];
-        const float* values_data = reinterpret_cast<const float*>(
-            values_buffer.data.data() + values_buffer_view.byteOffset +
-            sparse_values.byteOffset);
-
-        std::vector<unsigned int> indices(position_accessor.sparse.count);
-        std::vector<float> values(3 * size_t(position_accessor.sparse.count));
-
-        for (size_t sparse_index = 0; sparse_index < indices.size();
-             ++sparse_index) {
-          memcpy(&indices[sparse_index],
-                 indices_data + sparse_index * indices_component_size,
-                 indices_component_size);
-          memcpy(&values[3 * sparse_index], &values_data[3 * sparse_index],
-                 3 * sizeof(float));
-        }
+    // Facial rigs often have many targets that each move a few vertices
+    if (load_sparse_morph_target(model, buffers, target, morph_targets[i]))
+      continue;
 
-        // Patch the loaded sparse data into the morph target vertex attribute
-        for (size_t sparse_index = 0; sparse_index < indices.size();
-             ++sparse_index) {
-          memcpy(&morph_targets[i].position[indices[sparse_index]],
-                 &values[sparse_index * 3], 3 * sizeof(float));
-        }
-      }
+    // Morph target deltas may be quantized (KHR_mesh_quantization) and are
+    // often sparse, the accessor view takes care of both
+    if (position_it != target.end()) {
+      const accessor_view position(model, buffers, position_it->second);
+      assert(position.components() == 3);
+      position.copy_to(morph_targets[i].position, 3);
     }
 
     if (normal_it != target.end()) {
-      has_normal = true;
-      const auto& normal_accessor = model.accessors[normal_it->second];
-      const auto& normal_buffer_view =
-          model.bufferViews[normal_accessor.bufferView];
-      const auto& normal_buffer = model.buffers[normal_buffer_view.buffer];
-      const auto normal_data_start = normal_buffer.data.data() +
-                                     normal_buffer_view.byteOffset +
-                                     normal_accessor.byteOffset;
-      const auto stride = normal_accessor.ByteStride(normal_buffer_view);
-
-      assert(normal_accessor.type == TINYGLTF_TYPE_VEC3);
-      assert(normal_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-
-      morph_targets[i].normal.resize(3 * normal_accessor.count);
-      for (size_t vertex = 0; vertex < normal_accessor.count; ++vertex) {
-        memcpy(&morph_targets[i].normal[3 * vertex],
-               normal_data_start + vertex * stride, sizeof(float) * 3);
-      }
+      const accessor_view normal(model, buffers, normal_it->second);
+      assert(normal.components() == 3);
+      normal.copy_to(morph_targets[i].normal, 3);
+    }
 
-      if (normal_accessor.sparse.isSparse) {
-        const auto sparse_indices = normal_accessor.sparse.indices;
-        const auto indices_component_size = tinygltf::GetComponentSizeInBytes(
-            normal_accessor.sparse.indices.componentType);
-        const auto& indices_buffer_view =
-            model.bufferViews[sparse_indices.bufferView];
-        const auto& indices_buffer = model.buffers[indices_buffer_view.buffer];
-        const auto indices_data = indices_buffer.data.data() +
-                                  indices_buffer_view.byteOffset +
-                                  sparse_indices.byteOffset;
-
-        assert(sizeof(unsigned int) >= indices_component_size);
-
-        const auto sparse_values = normal_accessor.sparse.values;
-        const auto& values_buffer_view =
-            model.bufferViews[sparse_values.bufferView];
-        const auto& values_buffer = model.buffers[values_buffer_view.buffer];
-        const float* values_data = reinterpret_cast<const float*>(
-            values_buffer.data.data() + values_buffer_view.byteOffset +
-            sparse_values.byteOffset);
-
-        std::vector<unsigned int> indices(normal_accessor.sparse.count);
-        std::vector<float> values(3 * size_t(normal_accessor.sparse.count));
-
-        for (size_t sparse_index = 0; sparse_index < indices.size();
-             ++sparse_index) {
-          memcpy(&indices[sparse_index],
-                 indices_data + sparse_index * indices_component_size,
-                 indices_component_size);
-          memcpy(&values[3 * sparse_index], &values_data[3 * sparse_index],
-                 3 * sizeof(float));
-        }
+    if (tangent_it != target.end()) {
+      const accessor_view tangent(model, buffers, tangent_it->second);
+      assert(tangent.components() == 3);
+      tangent.copy_to(morph_targets[i].tangent, 3);
+    }
+  }
+}
 
-        // Patch the loaded sparse data into the morph target vertex attribute
-        for (size_t sparse_index = 0; sparse_index < indices.size();
-             ++sparse_index) {
-          memcpy(&morph_targets[i].normal[indices[sparse_index]],
-                 &values[sparse_index * 3], 3 * sizeof(float));
-        }
-      }
+void generate_morph_target_frames(
+    const gltf_insight::tangent_space_generator& generator,
+    const std::vector<float>& positions, const std::vector<float>& normals,
+    bool generate_normals, bool generate_tangents, morph_target& target) {
+  const size_t nb_vertices = generator.vertex_count();
+  if (normals.size() != 3 * nb_vertices) return;
+  if (!target.is_sparse()) target.position.resize(3 * nb_vertices, 0.f);
+
+  // Where the delta of each vertex is stored. A dense target has all of them
+  const size_t untouched = std::numeric_limits<size_t>::max();
+  std::vector<size_t> slot(nb_vertices, untouched);
+  if (target.is_sparse()) {
+    for (size_t i = 0; i < target.vertices.size(); ++i)
+      if (target.vertices[i] < nb_vertices) slot[target.vertices[i]] = i;
+  } else {
+    std::iota(slot.begin(), slot.end(), size_t(0));
+  }
+
+  // Move the mesh to the full extent of the target, and find the vertices
+  // whose frame changes
+  std::vector<float> morphed = positions;
+  std::vector<bool> dependents(nb_vertices, false);
+  for (size_t vertex = 0; vertex < nb_vertices; ++vertex) {
+    if (slot[vertex] == untouched) continue;
+    const float* delta = &target.position[3 * slot[vertex]];
+    if (delta[0] == 0.f && delta[1] == 0.f && delta[2] == 0.f) continue;
+    for (size_t c = 0; c < 3; ++c) morphed[3 * vertex + c] += delta[c];
+    generator.mark_dependents(vertex, dependents);
+  }
+
+  // A sparse target gains the vertices that don't move but change frame
+  if (target.is_sparse()) {
+    for (size_t vertex = 0; vertex < nb_vertices; ++vertex) {
+      if (!dependents[vertex] || slot[vertex] != untouched) continue;
+      slot[vertex] = target.vertices.size();
+      target.vertices.push_back(unsigned(vertex));
+      target.position.insert(target.position.end(), 3, 0.f);
+      if (!target.normal.empty())
+        target.normal.insert(target.normal.end(), 3, 0.f);
+      if (!target.tangent.empty())
+        target.tangent.insert(target.tangent.end(), 3, 0.f);
     }
   }
+
+  const size_t nb_slots = target.position.size() / 3;
+  if (generate_normals) target.normal.assign(3 * nb_slots, 0.f);
+  if (generate_tangents) target.tangent.assign(3 * nb_slots, 0.f);
+  const bool has_normals = target.normal.size() == 3 * nb_slots;
+
+  for (size_t vertex = 0; vertex < nb_vertices; ++vertex) {
+    if (!dependents[vertex]) continue;
+    const size_t s = slot[vertex];
+
+    const glm::vec3 base_normal = glm::make_vec3(&normals[3 * vertex]);
+    if (generate_normals) {
+      const glm::vec3 delta = generator.normal(vertex, morphed.data()) -
+                              generator.normal(vertex, positions.data());
+      std::copy(glm::value_ptr(delta), glm::value_ptr(delta) + 3,
+                &target.normal[3 * s]);
+    }
+    if (!generate_tangents) continue;
+
+    // The morphed tangent is orthogonal to the morphed normal
+    glm::vec3 morphed_normal = base_normal;
+    if (has_normals) morphed_normal += glm::make_vec3(&target.normal[3 * s]);
+    if (!(glm::length(morphed_normal) > 0.f)) morphed_normal = base_normal;
+    const glm::vec3 delta =
+        glm::vec3(generator.tangent(vertex, morphed.data(),
+                                    glm::normalize(morphed_normal))) -
+        glm::vec3(generator.tangent(vertex, positions.data(), base_normal));
+    std::copy(glm::value_ptr(delta), glm::value_ptr(delta) + 3,
+              &target.tangent[3 * s]);
+  }
+}
+
+void check_required_extensions(const tinygltf::Model& model) {
+  static const char* const supported[] = {"KHR_mesh_quantization",
+                                          "KHR_materials_unlit",
+                                          "EXT_meshopt_compression"};
+
+  for (const auto& extension : model.extensionsRequired) {
+    if (extension == "KHR_draco_mesh_compression" && draco_available())
+      continue;
+    if (std::find(std::begin(supported), std::end(supported), extension) ==
+        std::end(supported))
+      std::cerr << "Warn: the scene requires the unsupported extension "
+                << extension << ", it may not display correctly\n";
+  }
 }
 
 void load_morph_target_names(const tinygltf::Mesh& mesh,
@@ -786,57 +890,32 @@ void load_morph_target_names(const tinygltf::Mesh& mesh,
 }
 
 void load_inverse_bind_matrix_array(
-    tinygltf::Model model, const tinygltf::Skin& skin, size_t nb_joints,
+    const tinygltf::Model& model,
+    const gltf_insight::buffer_data::overrides& buffers,
+    const tinygltf::Skin& skin, size_t nb_joints,
     std::vector<glm::mat4>& inverse_bind_matrices) {
   // Two :  we need to get the inverse bind matrix array, as it is
   // necessary for skinning
-  const auto& inverse_bind_matrices_accessor =
-      model.accessors[skin.inverseBindMatrices];
-  assert(inverse_bind_matrices_accessor.type == TINYGLTF_TYPE_MAT4);
-  assert(inverse_bind_matrices_accessor.count == nb_joints);
-
-  const auto& inverse_bind_matrices_bufferview =
-      model.bufferViews[inverse_bind_matrices_accessor.bufferView];
-  const auto& inverse_bind_matrices_buffer =
-      model.buffers[inverse_bind_matrices_bufferview.buffer];
-  const size_t inverse_bind_matrices_stride =
-      inverse_bind_matrices_accessor.ByteStride(
-          inverse_bind_matrices_bufferview);
-  const auto inverse_bind_matrices_data_start =
-      inverse_bind_matrices_buffer.data.data() +
-      inverse_bind_matrices_accessor.byteOffset +
-      inverse_bind_matrices_bufferview.byteOffset;
-  const size_t inverse_bind_matrices_component_size =
-      tinygltf::GetComponentSizeInBytes(
-          inverse_bind_matrices_accessor.componentType);
-  assert(sizeof(double) >= inverse_bind_matrices_component_size);
-
   inverse_bind_matrices.resize(nb_joints);
 
-  for (size_t i = 0; i < nb_joints; ++i) {
-    if (inverse_bind_matrices_component_size == sizeof(float)) {
-      float temp[16];
-      memcpy(
-          temp,
-          inverse_bind_matrices_data_start + i * inverse_bind_matrices_stride,
-          inverse_bind_matrices_component_size * 16);
-      inverse_bind_matrices[i] = glm::make_mat4(temp);
-    }
-    // TODO actually, in the glTF spec there's no mention of  supports for
-    // doubles. We are doing this here because in the tiny_gltf API, it's
-    // implied we could have stored doubles. This is unrelated with the fact
-    // that numbers in the JSON are read as doubles. Here we are talking about
-    // the format where the data is stored inside the binary buffers that
-    // comes with the glTF JSON part. Maybe remove the "double" types from
-    // tiny_gltf?
-    if (inverse_bind_matrices_component_size == sizeof(double)) {
-      double temp[16], tempf[16];
-      memcpy(
-          temp,
-          inverse_bind_matrices_data_start + i * inverse_bind_matrices_stride,
-          inverse_bind_matrices_component_size * 16);
-      for (int j = 0; j < 16; ++j) tempf[j] = float(temp[j]);
-      inverse_bind_matrices[i] = glm::make_mat4(tempf);
-    }
+  // When this is undefined, each matrix is a 4x4 identity matrix
+  if (skin.inverseBindMatrices < 0) {
+    std::fill(inverse_bind_matrices.begin(), inverse_bind_matrices.end(),
+              glm::mat4(1.f));
+    return;
   }
+
+  const accessor_view inverse_bind_matrices_accessor(
+      model, buffers, skin.inverseBindMatrices);
+  assert(inverse_bind_matrices_accessor.components() == 16);
+  assert(inverse_bind_matrices_accessor.count() == nb_joints);
+
+  // glm matrices are 16 column-major floats, like glTF ones
+  static_assert(sizeof(glm::mat4) == 16 * sizeof(float),
+                "glm::mat4 is expected to be tightly packed");
+  std::vector<float> matrices;
+  inverse_bind_matrices_accessor.copy_to(matrices, 16);
+  for (size_t i = 0;
+       i < std::min(nb_joints, inverse_bind_matrices_accessor.count()); ++i)
+    inverse_bind_matrices[i] = glm::make_mat4(&matrices[16 * i]);
 }
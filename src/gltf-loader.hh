@@ -26,8 +26,10 @@ SOFTWARE.
 
 #include <vector>
 
+#include "buffer_data.hh"
 #include "gl_util.hh"
 #include "gltf-graph.hh"
+#include "tangent_space.hh"
 
 struct morph_target {
   // std::string name;
@@ -35,33 +37,110 @@ struct morph_target {
   // doesn't define this.
   // See: https://github.com/KhronosGroup/glTF/issues/1036
 
-  std::vector<float> position, normal;
+  /// Vertices moved by a sparse target. Empty for a dense target
+  std::vector<unsigned> vertices;
+
+  /// Deltas, 3 floats per vertex of the submesh, or per entry of `vertices`
+  /// for a sparse target. Tangent deltas don't change the handedness
+  std::vector<float> position, normal, tangent;
+
+  bool is_sparse() const { return !vertices.empty(); }
+};
+
+/// Vertex attribute data that is used in place, straight from a glTF buffer
+/// and in the format it is stored in
+struct borrowed_attribute {
+  const void* data = nullptr;
+  /// number of elements
+  size_t count = 0;
+  vertex_format format;
+
+  bool empty() const { return data == nullptr; }
+
+  /// Number of bytes from the first element to the end of the last one
+  size_t byte_size() const;
+
+  /// Decode to tightly packed floats, normalized integers are mapped to
+  /// [0, 1] / [-1, 1]
+  void copy_to(std::vector<float>& output) const;
+};
+
+/// Attributes of a submesh that are uploaded to the GPU without a CPU copy
+struct borrowed_geometry {
+  borrowed_attribute position, normal, uv, tangent;
 };
 
 void load_animations(const tinygltf::Model& model,
+                     const gltf_insight::buffer_data::overrides& buffers,
                      std::vector<animation>& animations);
 
+/// Decode the geometry of every primitive into CPU side arrays. This function
+/// does not touch OpenGL, see `upload_geometry` for that part.
+/// Missing normals are generated smooth, and missing tangents are generated
+/// for the normal mapped primitives that have UVs.
+/// If `borrowed` is given (sized like `primitives`), positions, normals, UVs
+/// and tangents the GPU can read as stored, quantized or not, are referenced
+/// from `model` instead of being copied, and the matching arrays are left
+/// empty. Buffer content is read through `buffers`, see `accessor_view`.
 void load_geometry(
-    const tinygltf::Model& model, std::vector<GLuint>& textures,
+    const tinygltf::Model& model,
+    const gltf_insight::buffer_data::overrides& buffers,
     const std::vector<tinygltf::Primitive>& primitives,
     std::vector<draw_call_submesh_descriptor>& draw_call_descriptor,
-    std::vector<GLuint>& VAOs, std::vector<std::array<GLuint, VBO_count>>& VBOs,
     std::vector<std::vector<unsigned>>& indices,
     std::vector<std::vector<float>>& vertex_coord,
     std::vector<std::vector<float>>& texture_coord,
     std::vector<std::vector<float>>& colors,
     std::vector<std::vector<float>>& normals,
+    std::vector<std::vector<float>>& tangents,
     std::vector<std::vector<float>>& weights,
-    std::vector<std::vector<unsigned short>>& joints);
+    std::vector<std::vector<unsigned short>>& joints,
+    std::vector<borrowed_geometry>* borrowed = nullptr);
+
+/// Create the OpenGL buffers of every submesh from the arrays produced by
+/// `load_geometry`, or from the borrowed glTF buffers. VAOs and VBOs are
+/// expected to be already generated; the interleaved `layout` only uses the
+/// VBO_stream_dynamic, VBO_stream_static and VBO_layout_EBO slots.
+void upload_geometry(
+    std::vector<draw_call_submesh_descriptor>& draw_call_descriptor,
+    const std::vector<GLuint>& VAOs,
+    const std::vector<std::array<GLuint, VBO_count>>& VBOs,
+    const std::vector<std::vector<unsigned>>& indices,
+    const std::vector<std::vector<float>>& vertex_coord,
+    const std::vector<std::vector<float>>& texture_coord,
+    const std::vector<std::vector<float>>& colors,
+    const std::vector<std::vector<float>>& normals,
+    const std::vector<std::vector<float>>& tangents,
+    const std::vector<std::vector<float>>& weights,
+    const std::vector<std::vector<unsigned short>>& joints,
+    const std::vector<borrowed_geometry>& borrowed,
+    vertex_layout layout = vertex_layout::separate);
 
+/// Load the targets of `primitive`. Targets that only have sparse data are
+/// kept sparse when that takes less memory than the dense form.
 void load_morph_targets(const tinygltf::Model& model,
+                        const gltf_insight::buffer_data::overrides& buffers,
                         const tinygltf::Primitive& primitive,
                         std::vector<morph_target>& morph_targets,
                         bool& has_normals, bool& has_tangents);
 
+/// Fill the normal and/or tangent deltas of a target that has none, as the
+/// difference between the frames `generator` gives at the morphed and at the
+/// base `positions`. `normals` are the base normals the deltas are added to.
+/// A sparse target gains the vertices whose frame changes without moving.
+void generate_morph_target_frames(
+    const gltf_insight::tangent_space_generator& generator,
+    const std::vector<float>& positions, const std::vector<float>& normals,
+    bool generate_normals, bool generate_tangents, morph_target& target);
+
+/// Warn about the extensions `model` requires that we don't support
+void check_required_extensions(const tinygltf::Model& model);
+
 void load_morph_target_names(const tinygltf::Mesh& mesh,
                              std::vector<std::string>& names);
 
 void load_inverse_bind_matrix_array(
-    tinygltf::Model model, const tinygltf::Skin& skin, size_t nb_joints,
+    const tinygltf::Model& model,
+    const gltf_insight::buffer_data::overrides& buffers,
+    const tinygltf::Skin& skin, size_t nb_joints,
     std::vector<glm::mat4>& inverse_bind_matrices);
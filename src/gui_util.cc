@@ -712,18 +712,16 @@ void timeline_window(gltf_insight::AnimSequence loaded_sequence,
 }
 
 void shader_selector_window(const std::vector<std::string>& shader_names,
-                            int& selected_shader, std::string& shader_to_use,
-                            int& display_mode, bool* open) {
+                            int& selected_shader, int& display_mode,
+                            bool* open) {
   if (open && !*open) return;
   if (ImGui::Begin("Shader mode", open)) {
     ImGui::Text("Display_mode:");
     if (ImGui::RadioButton("Normal", display_mode == 0)) display_mode = 0;
     if (ImGui::RadioButton("Debug", display_mode == 42)) display_mode = 42;
 
-    if (display_mode == 0x2A) {
+    if (display_mode == 0x2A)
       ImGuiCombo("Choose shader", &selected_shader, shader_names);
-      shader_to_use = shader_names[size_t(selected_shader)];
-    }
   }
   ImGui::End();
 }
@@ -1064,11 +1062,12 @@ void about_window(GLuint logo, bool* open) {
   ImGui::End();
 }
 
-void material_info_window(gltf_insight::material& dummy,
+bool material_info_window(gltf_insight::material& dummy,
                           std::vector<gltf_insight::material>& loaded_materials,
                           bool* open) {
   static constexpr int tsize = 128;
-  if (open && !*open) return;
+  bool edited = false;
+  if (open && !*open) return edited;
   if (ImGui::Begin("Materials", open)) {
     static int index = -1;
     ImGui::Text("The currently asset contains %d materials",
@@ -1085,9 +1084,10 @@ void material_info_window(gltf_insight::material& dummy,
     ImGui::Text("Type: %s",
                 gltf_insight::to_string(selected.intended_shader).c_str());
 
-    ImGui::ColorEdit3(
-        "Emissive factor", glm::value_ptr(selected.emissive_factor),
-        ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoPicker);
+    if (ImGui::ColorEdit3(
+            "Emissive factor", glm::value_ptr(selected.emissive_factor),
+            ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoPicker))
+      edited = true;
     ImGui::Text("Alpha Mode [%s]", to_string(selected.alpha_mode).c_str());
     ImGui::Text("Alpha cutoff [%.3f]", double(selected.alpha_cutoff));
     auto read_only_bool = selected.double_sided;
@@ -1120,10 +1120,11 @@ void material_info_window(gltf_insight::material& dummy,
       case gltf_insight::shading_type::pbr_metal_rough: {
         auto& pbr_metal_rough = selected.shader_inputs.pbr_metal_roughness;
         ImGui::Columns(2);
-        ImGui::ColorEdit4(
-            "Base Color Factor",
-            glm::value_ptr(pbr_metal_rough.base_color_factor),
-            ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoPicker);
+        if (ImGui::ColorEdit4(
+                "Base Color Factor",
+                glm::value_ptr(pbr_metal_rough.base_color_factor),
+                ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoPicker))
+          edited = true;
         ImGui::NextColumn();
         ImGui::Text("Roughness [%.3f]\nMetallic_factor [%.3f]",
                     double(pbr_metal_rough.roughness_factor),
@@ -1149,9 +1150,10 @@ void material_info_window(gltf_insight::material& dummy,
 
       case gltf_insight::shading_type::unlit: {
         auto& unlit = selected.shader_inputs.unlit;
-        ImGui::ColorEdit4(
-            "Base Color Factor", glm::value_ptr(unlit.base_color_factor),
-            ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoPicker);
+        if (ImGui::ColorEdit4(
+                "Base Color Factor", glm::value_ptr(unlit.base_color_factor),
+                ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoPicker))
+          edited = true;
         ImGui::Image(ImTextureID(size_t(unlit.base_color_texture)),
                      ImVec2(2 * tsize, 2 * tsize));
 
@@ -1159,6 +1161,7 @@ void material_info_window(gltf_insight::material& dummy,
     }
   }
   ImGui::End();
+  return edited;
 }
 
 static void scene_outline_window_recur(gltf_node& node) {
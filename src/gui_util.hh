@@ -151,8 +151,8 @@ void timeline_window(gltf_insight::AnimSequence loaded_sequence,
                      float docked_size_max_pixel = 300.f);
 
 void shader_selector_window(const std::vector<std::string>& shader_names,
-                            int& selected_shader, std::string& shader_to_use,
-                            int& display_mode, bool* open = nullptr);
+                            int& selected_shader, int& display_mode,
+                            bool* open = nullptr);
 
 void utilities_window(bool& show_imgui_demo);
 
@@ -164,8 +164,8 @@ GLuint load_gltf_insight_icon();
 void about_window(GLuint logo, bool* open = nullptr);
 
 // NOTE(LTE): material may have a chance to be modified, so no `const`
-// qualifiers.
-void material_info_window(gltf_insight::material& dummy,
+// qualifiers. Returns true when a material was edited.
+bool material_info_window(gltf_insight::material& dummy,
                           std::vector<gltf_insight::material>& loaded_materials,
                           bool* open = nullptr);
 
@@ -0,0 +1,188 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_decoder.hh"
+
+#include <chrono>
+#include <stdexcept>
+
+#include "parallel_for.hh"
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#endif
+
+#include "stb_image.h"
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+using namespace gltf_insight;
+
+void gltf_insight::decode_image(const encoded_image& encoded,
+                                decoded_image& decoded) {
+  // Always decode to 8 bits RGBA, the format textures are uploaded with
+  int width = 0, height = 0, components = 0;
+  stbi_uc* pixels = stbi_load_from_memory(
+      encoded.bytes.data(), int(encoded.bytes.size()), &width, &height,
+      &components, STBI_rgb_alpha);
+  if (!pixels)
+    throw std::runtime_error("Cannot decode image " +
+                             std::to_string(encoded.index) + ": " +
+                             stbi_failure_reason());
+
+  if ((encoded.required_width > 0 && encoded.required_width != width) ||
+      (encoded.required_height > 0 && encoded.required_height != height)) {
+    stbi_image_free(pixels);
+    throw std::runtime_error("Image " + std::to_string(encoded.index) +
+                             " doesn't have the required size");
+  }
+
+  decoded.width = width;
+  decoded.height = height;
+  const size_t nb_bytes =
+      size_t(width) * size_t(height) * size_t(STBI_rgb_alpha);
+  decoded.pixels.assign(pixels, pixels + nb_bytes);
+  stbi_image_free(pixels);
+}
+
+void deferred_image_decoder::install(tinygltf::TinyGLTF& gltf_ctx) {
+  gltf_ctx.SetImageLoader(&deferred_image_decoder::record_image, this);
+}
+
+bool deferred_image_decoder::record_image(
+    tinygltf::Image* image, const int image_index, std::string* err,
+    std::string* warn, int required_width, int required_height,
+    const unsigned char* bytes, int size, void* user_data) {
+  (void)warn;
+
+  if (!bytes || size <= 0) {
+    if (err) *err += "Image " + std::to_string(image_index) + " is empty\n";
+    return false;
+  }
+
+  // Reading the header is cheap, and gives the image its real size before it
+  // is decoded
+  int width = 0, height = 0, components = 0;
+  if (stbi_info_from_memory(bytes, size, &width, &height, &components)) {
+    image->width = width;
+    image->height = height;
+    image->component = STBI_rgb_alpha;
+    image->bits = 8;
+    image->pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+  }
+
+  // tinygltf only keeps the bytes alive for the duration of this call
+  auto* decoder = static_cast<deferred_image_decoder*>(user_data);
+  encoded_image encoded;
+  encoded.index = image_index;
+  encoded.required_width = required_width;
+  encoded.required_height = required_height;
+  encoded.bytes.assign(bytes, bytes + size);
+  decoder->pending_.push_back(std::move(encoded));
+  return true;
+}
+
+image_decode_report deferred_image_decoder::decode_all(tinygltf::Model& model,
+                                                       size_t nb_threads) {
+  using clock = std::chrono::steady_clock;
+
+  std::vector<encoded_image> to_decode = take_encoded_images();
+
+  image_decode_report report;
+  report.nb_images = to_decode.size();
+  report.nb_threads = parallel_for_thread_count(to_decode.size(), nb_threads);
+  report.images.resize(to_decode.size());
+
+  const auto decode_start = clock::now();
+  parallel_for(to_decode.size(), nb_threads, [&](size_t i) {
+    const auto image_start = clock::now();
+    auto& encoded = to_decode[i];
+    if (encoded.index < 0 || size_t(encoded.index) >= model.images.size())
+      throw std::runtime_error("Image index " + std::to_string(encoded.index) +
+                               " is out of range");
+    auto& image = model.images[size_t(encoded.index)];
+
+    decoded_image decoded;
+    decode_image(encoded, decoded);
+    image.width = decoded.width;
+    image.height = decoded.height;
+    image.component = STBI_rgb_alpha;
+    image.bits = 8;
+    image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+    image.image.swap(decoded.pixels);
+
+    // Encoded bytes are not needed anymore
+    std::vector<unsigned char>().swap(encoded.bytes);
+
+    report.images[i].image = encoded.index;
+    report.images[i].name = image.name.empty() ? image.uri : image.name;
+    report.images[i].ms =
+        std::chrono::duration<double, std::milli>(clock::now() - image_start)
+            .count();
+  });
+
+  report.decode_wall_ms =
+      std::chrono::duration<double, std::milli>(clock::now() - decode_start)
+          .count();
+  for (const auto& timing : report.images) report.decode_cpu_ms += timing.ms;
+
+  return report;
+}
+
+image_decode_report deferred_image_decoder::check_all() {
+  using clock = std::chrono::steady_clock;
+
+  const auto check_start = clock::now();
+  const std::vector<encoded_image> to_check = take_encoded_images();
+  for (const auto& encoded : to_check) {
+    int width = 0, height = 0, components = 0;
+    if (!stbi_info_from_memory(encoded.bytes.data(), int(encoded.bytes.size()),
+                               &width, &height, &components))
+      throw std::runtime_error("Cannot read the header of image " +
+                               std::to_string(encoded.index) + ": " +
+                               stbi_failure_reason());
+
+    if ((encoded.required_width > 0 && encoded.required_width != width) ||
+        (encoded.required_height > 0 && encoded.required_height != height))
+      throw std::runtime_error("Image " + std::to_string(encoded.index) +
+                               " doesn't have the required size");
+  }
+
+  image_decode_report report;
+  report.nb_images = to_check.size();
+  report.headers_only = true;
+  report.decode_wall_ms =
+      std::chrono::duration<double, std::milli>(clock::now() - check_start)
+          .count();
+  report.decode_cpu_ms = report.decode_wall_ms;
+  return report;
+}
+
+std::vector<encoded_image> deferred_image_decoder::take_encoded_images() {
+  std::vector<encoded_image> images;
+  images.swap(pending_);
+  return images;
+}
@@ -0,0 +1,108 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "parallel_for.hh"
+#include "tiny_gltf.h"
+
+namespace gltf_insight {
+
+/// Image file content (PNG, JPEG...) as found in the glTF asset
+struct encoded_image {
+  int index = -1;
+  int required_width = 0;
+  int required_height = 0;
+  std::vector<unsigned char> bytes;
+};
+
+/// 8 bits RGBA pixels
+struct decoded_image {
+  int width = 0;
+  int height = 0;
+  std::vector<unsigned char> pixels;
+};
+
+/// Decode `encoded` into `decoded`. Throws std::runtime_error on failure
+void decode_image(const encoded_image& encoded, decoded_image& decoded);
+
+/// Timings of a `deferred_image_decoder::decode_all` call
+struct image_decode_report {
+  struct image_timing {
+    int image = -1;
+    std::string name;
+    double ms = 0.0;
+  };
+
+  size_t nb_images = 0;
+  size_t nb_threads = 1;
+  // Only the headers were read, by `deferred_image_decoder::check_all`
+  bool headers_only = false;
+  double decode_wall_ms = 0.0;
+  double decode_cpu_ms = 0.0;
+  std::vector<image_timing> images;
+
+  /// See `gltf_insight::work_overlap`
+  double work_overlap() const {
+    return gltf_insight::work_overlap(decode_cpu_ms, decode_wall_ms);
+  }
+};
+
+/// Image backend for tinygltf. While the glTF file is parsed, the encoded
+/// bytes of each image are only recorded, along with its size. They are then
+/// either decoded all at once on several threads by `decode_all`, or handed
+/// over with `take_encoded_images` to be decoded later.
+class deferred_image_decoder {
+ public:
+  /// Make `gltf_ctx` use this decoder. It has to outlive the parsing.
+  void install(tinygltf::TinyGLTF& gltf_ctx);
+
+  /// Decode every image recorded since the last call into `model.images`,
+  /// using up to `nb_threads` threads (0 means one per core). Throws
+  /// std::runtime_error if an image cannot be decoded.
+  image_decode_report decode_all(tinygltf::Model& model, size_t nb_threads);
+
+  /// Check that every image recorded since the last call has a header
+  /// stb_image can read, and the required size, without decoding it. The
+  /// images are then dropped. Throws std::runtime_error on the first bad one.
+  image_decode_report check_all();
+
+  /// Give away the images recorded since the last call, without decoding
+  /// them
+  std::vector<encoded_image> take_encoded_images();
+
+ private:
+  std::vector<encoded_image> pending_;
+
+  static bool record_image(tinygltf::Image* image, const int image_index,
+                           std::string* err, std::string* warn,
+                           int required_width, int required_height,
+                           const unsigned char* bytes, int size,
+                           void* user_data);
+};
+
+}  // namespace gltf_insight
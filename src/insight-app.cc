@@ -22,6 +22,9 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #include "insight-app.hh"
+#include "buffer_data.hh"
+#include "fnv1a.hh"
+#include "parallel_for.hh"
 
 #ifdef __clang__
 #pragma clang diagnostic push
@@ -45,6 +48,15 @@ SOFTWARE.
 #pragma clang diagnostic pop
 #endif
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <numeric>
 #include <tuple>
 using namespace gltf_insight;
 
@@ -63,11 +75,18 @@ void app::unload() {
   asset_loaded = false;
 
   // loaded opengl objects
-  glDeleteTextures(GLsizei(textures.size()), textures.data());
+  texture_uploads.clear();
+  texture_stream.clear();
+  // Images with the same content share their texture
+  std::sort(textures.begin(), textures.end());
+  textures.erase(std::unique(textures.begin(), textures.end()),
+                 textures.end());
+  if (!textures.empty())
+    glDeleteTextures(GLsizei(textures.size()), textures.data());
 
   textures.clear();
   shader_names.clear();
-  shader_to_use.clear();
+  shader_to_use = shader_id::unlit;
   found_textured_shader = false;
 
   // loaded CPU side objects
@@ -89,9 +108,11 @@ void app::unload() {
   empty_gltf_graph(gltf_scene_tree);
   loaded_meshes.clear();
   loaded_material.clear();
+  cached_geometry.reset();
 
   // library resources
   model = tinygltf::Model();
+  model_buffers = gltf_insight::buffer_data::overrides();
 
   looping = true;
   selectedEntry = -1;
@@ -155,13 +176,270 @@ void app::load_as_metal_roughness(size_t i, material& currently_loading,
 }
 
 void app::load() {
-  load_glTF_asset();
+  staged_asset asset;
+  asset.filename = input_filename;
+  load_cpu_side(asset, nullptr);
+  install_asset(asset);
+}
+
+bool app::load_cpu_side(staged_asset& asset, background_load* job) {
+  const auto step = [&](const char* name, float completion) {
+    return !job || job->report(name, completion);
+  };
+
+  if (!step("Parsing glTF file", 0.f)) return false;
+  load_glTF_asset(asset.filename, asset.model, asset.buffers,
+                  asset.image_report,
+                  headless ? nullptr : &asset.encoded_images);
+
+  if (!step("Decompressing buffers", 0.25f)) return false;
+  asset.meshopt_report =
+      decode_meshopt_buffer_views(asset.model, asset.buffers, load_threads);
+  const auto& decompression = asset.meshopt_report;
+  if (decompression.nb_buffer_views > 0)
+    std::cerr << "Decoded " << decompression.nb_buffer_views
+              << " meshopt compressed bufferViews ("
+              << decompression.encoded_bytes << " -> "
+              << decompression.decoded_bytes << " bytes) in "
+              << decompression.decode_wall_ms << "ms on "
+              << decompression.nb_threads << " threads, "
+              << decompression.throughput() << " GB/s\n";
+
+  asset.draco_report =
+      decode_draco_primitives(asset.model, asset.buffers, load_threads);
+  const auto& draco_timings = asset.draco_report;
+  for (const auto& timing : draco_timings.primitives)
+    std::cerr << "Draco primitive " << timing.primitive << " of mesh "
+              << timing.mesh << " decoded in " << timing.ms << "ms\n";
+  if (draco_timings.nb_primitives > 0)
+    std::cerr << "Decoded " << draco_timings.nb_primitives
+              << " Draco primitives in " << draco_timings.decode_wall_ms
+              << "ms on " << draco_timings.nb_threads << " threads ("
+              << draco_timings.decode_cpu_ms << "ms of work, overlap x"
+              << draco_timings.work_overlap() << ")\n";
+
+  if (!step("Building scene graph", 0.3f)) return false;
+  const auto scene_index = find_main_scene(asset.model);
+  const auto& scene = asset.model.scenes[size_t(scene_index)];
+
+  asset.scene_tree.gltf_node_index = -1;
+
+  if (scene.nodes.size() > 1)
+    std::cerr << "Warn: The currently loading scene has multiple root node. We "
+                 "create a virtual root node that parent all of them\n";
+
+  // dummy "all parent" node
+  for (size_t i = 0; i < scene.nodes.size(); ++i) {
+    const auto root_index = scene.nodes[i];
+    asset.scene_tree.add_child();
+    auto& root = *asset.scene_tree.children.back();
+    populate_gltf_graph(asset.model, root, root_index);
+  }
+
+  set_mesh_attachment(asset.model, asset.scene_tree);
+  auto meshes_indices = get_list_of_mesh_instances(asset.scene_tree);
+
+  if (!step("Decoding meshes", 0.35f)) return false;
+  load_meshes(asset, meshes_indices, job);
+
+  if (!step("Decoding animations", 0.9f)) return false;
+  asset.animations.resize(asset.model.animations.size());
+  load_animations(asset.model, asset.buffers, asset.animations);
+
+  return step("Uploading to the GPU", 1.f);
+}
+
+void app::install_asset(staged_asset& asset) {
+  input_filename = asset.filename;
+
+  // Static meshes point into the glTF buffers. Swapping the buffer array keeps
+  // every buffer where it is, whatever the Model assignment does.
+  std::vector<tinygltf::Buffer> buffers;
+  buffers.swap(asset.model.buffers);
+  model = std::move(asset.model);
+  model.buffers.swap(buffers);
+  model_buffers = std::move(asset.buffers);
+
+  // Nodes are shared, only the virtual root has to be re-parented
+  gltf_scene_tree.gltf_node_index = -1;
+  gltf_scene_tree.children = std::move(asset.scene_tree.children);
+  for (auto& root : gltf_scene_tree.children) root->parent = &gltf_scene_tree;
+  gltf_scene_tree.pose.target_names =
+      std::move(asset.scene_tree.pose.target_names);
+
+  loaded_meshes = std::move(asset.meshes);
+  cached_geometry = std::move(asset.cached_geometry);
+  animations = std::move(asset.animations);
+  load_report = asset.load_report;
+  sharing = asset.sharing;
+  image_report = asset.image_report;
+  meshopt_report = asset.meshopt_report;
+  draco_report = asset.draco_report;
+
+  // Without an OpenGL context we only keep the decoded images in `model`
+  if (!headless) {
+    const auto nb_textures = model.images.size();
+    textures.resize(nb_textures);
+    load_all_textures(nb_textures, std::move(asset.encoded_images));
+  }
+
+  load_materials();
+
+  if (!headless) {
+    material_blocks.upload(loaded_material);
+    upload_meshes();
+  }
+
+  if (sharing.nb_shared_meshes > 0 || sharing.nb_shared_images > 0)
+    std::cerr << "Shared the geometry of " << sharing.nb_shared_meshes
+              << " mesh instances (" << sharing.shared_decoded_bytes
+              << " decoded bytes not copied, " << sharing.shared_buffer_bytes
+              << " bytes not uploaded for " << sharing.nb_shared_submeshes
+              << " submeshes) and " << sharing.nb_shared_images
+              << " duplicated images (" << sharing.shared_image_bytes
+              << " encoded bytes)\n";
+
+  const auto nb_animations = animations.size();
+  fill_sequencer();
+
+  for (auto& animation : animations) {
+    animation.set_gltf_graph_targets(&gltf_scene_tree);
+  }
+
+  // TODO this is ... mh... per node?
+  int nb_morph_targets = 0;
+  for (const auto& loaded_mesh : loaded_meshes) {
+    nb_morph_targets = std::max(nb_morph_targets, loaded_mesh.nb_morph_targets);
+  }
+
+  gltf_scene_tree.pose.blend_weights.resize(size_t(nb_morph_targets));
+  std::generate(gltf_scene_tree.pose.blend_weights.begin(),
+                gltf_scene_tree.pose.blend_weights.end(), [] { return 0.f; });
+
+  animation_names.resize(nb_animations);
+  for (size_t i = 0; i < animations.size(); ++i)
+    animation_names[i] = animations[i].name;
 
-  const auto nb_textures = model.images.size();
-  textures.resize(nb_textures);
-  load_all_textures(nb_textures);
+  asset_loaded = true;
+
+  if (!headless && !loaded_meshes.empty()) {
+    for (size_t i = 0; i < size_t(shader_id::count); ++i)
+      shader_names.push_back(shader_name(shader_id(i)));
+    selected_shader = int(shader_id::unlit);
+
+    if (uniform_benchmark_iterations > 0) {
+      // The joint matrices of the largest skin used to be sent at every draw
+      int nb_joints = 0;
+      for (const auto& a_mesh : loaded_meshes)
+        nb_joints = std::max(nb_joints, a_mesh.nb_joints);
+      const auto timings = benchmark_uniform_updates(
+          *loaded_meshes[0].shader_list, size_t(nb_joints),
+          uniform_benchmark_iterations);
+      std::cout << "Uniform updates per draw: " << timings.by_name_ns
+                << "ns by name with " << timings.nb_joints << " joints, "
+                << timings.by_id_ns << "ns by id ("
+                << uniform_benchmark_iterations << " draws)\n";
+    }
+  }
+}
+
+void app::start_loading(const std::string& filename) {
+  cancel_background_load();
+
+  pending_load = std::unique_ptr<background_load>(new background_load);
+  pending_load->filename = filename;
+  std::cout << "Loading " << filename << " in the background\n";
 
-  // TODO extract "load_materials" function
+  background_load* job = pending_load.get();
+  const auto work = [this, job] {
+    std::unique_ptr<staged_asset> asset(new staged_asset);
+    asset->filename = job->filename;
+    try {
+      if (load_cpu_side(*asset, job)) job->result = std::move(asset);
+    } catch (const std::exception& e) {
+      job->error = e.what();
+    }
+
+    // A cancelled load frees what it decoded right away, not when the main
+    // thread gets to it
+    asset.reset();
+    job->done = true;
+  };
+
+#ifdef __EMSCRIPTEN__
+  // No pthread in our emscripten build
+  work();
+#else
+  job->thread = std::thread(work);
+#endif
+}
+
+void app::poll_background_load() {
+  for (auto& job : cancelled_loads)
+    if (job->done && job->thread.joinable()) job->thread.join();
+  cancelled_loads.erase(
+      std::remove_if(cancelled_loads.begin(), cancelled_loads.end(),
+                     [](const std::unique_ptr<background_load>& job) {
+                       return job->done && !job->thread.joinable();
+                     }),
+      cancelled_loads.end());
+
+  if (!pending_load || !pending_load->done) return;
+
+  if (pending_load->thread.joinable()) pending_load->thread.join();
+  std::unique_ptr<background_load> job = std::move(pending_load);
+
+  if (job->result && !job->cancel) {
+    unload();
+    try {
+      install_asset(*job->result);
+    } catch (const std::exception& e) {
+      std::cerr << "error occured during loading of " << job->filename << ": "
+                << e.what() << '\n';
+      unload();
+    }
+  } else if (!job->cancel) {
+    std::cerr << "error occured during loading of " << job->filename << ": "
+              << job->error << '\n';
+  } else {
+    std::cout << "Loading of " << job->filename << " cancelled\n";
+  }
+}
+
+void app::background_load_ui() {
+  if (!pending_load) return;
+
+  ImGui::OpenPopup("background_load");
+  if (ImGui::BeginPopup("background_load")) {
+    ImGui::Text("Loading %s", pending_load->filename.c_str());
+    if (pending_load->cancel) {
+      ImGui::Text("Cancelling...");
+    } else {
+      ImGui::Text("%s", pending_load->stage.load());
+      ImGui::ProgressBar(pending_load->progress);
+      if (ImGui::Button("Cancel")) pending_load->cancel = true;
+    }
+    ImGui::EndPopup();
+  }
+}
+
+void app::cancel_background_load() {
+  if (!pending_load) return;
+
+  // The file being parsed can be large, the UI shouldn't wait for it
+  pending_load->cancel = true;
+  std::cout << "Loading of " << pending_load->filename << " cancelled\n";
+  cancelled_loads.push_back(std::move(pending_load));
+}
+
+void app::stop_background_load() {
+  cancel_background_load();
+  for (auto& job : cancelled_loads)
+    if (job->thread.joinable()) job->thread.join();
+  cancelled_loads.clear();
+}
+
+void app::load_materials() {
   loaded_material.resize(model.materials.size());
   for (size_t i = 0; i < model.materials.size(); ++i) {
     auto& currently_loading = loaded_material[i];
@@ -294,52 +572,384 @@ void app::load() {
 
     currently_loading.fill_material_texture_slots();
   }
+}
 
-  const auto scene_index = find_main_scene(model);
-  const auto& scene = model.scenes[size_t(scene_index)];
+// Normal and tangent deltas left to generate for the targets of a submesh.
+// They are generated once every mesh is decoded, so the targets of a single
+// large mesh are spread over the threads too
+struct morph_frames_job {
+  std::unique_ptr<const tangent_space_generator> generator;
+  size_t submesh;
+  bool normals, tangents;
+};
+
+// Decode the geometry, inverse bind matrices and morph targets of a mesh from
+// the glTF accessors
+static void decode_mesh(const tinygltf::Model& model,
+                        const gltf_insight::buffer_data::overrides& buffers,
+                        mesh& current_mesh,
+                        std::vector<morph_frames_job>& morph_frames) {
+  const auto& gltf_mesh = model.meshes[size_t(current_mesh.instance.mesh)];
+  const auto& gltf_mesh_primitives = gltf_mesh.primitives;
+  const auto nb_submeshes = gltf_mesh_primitives.size();
+
+  if (current_mesh.skinned) {
+    const auto& gltf_skin = model.skins[size_t(
+        model.nodes[size_t(current_mesh.instance.node)].skin)];
+    load_inverse_bind_matrix_array(model, buffers, gltf_skin,
+                                   size_t(current_mesh.nb_joints),
+                                   current_mesh.inverse_bind_matrices);
+  }
 
-  gltf_scene_tree.gltf_node_index = -1;
+  // For each submesh of the mesh, load the data
+  load_geometry(model, buffers, gltf_mesh_primitives,
+                current_mesh.draw_call_descriptors, current_mesh.indices,
+                current_mesh.positions, current_mesh.uvs, current_mesh.colors,
+                current_mesh.normals, current_mesh.tangents,
+                current_mesh.weights, current_mesh.joints,
+                current_mesh.borrowed.empty() ? nullptr
+                                              : &current_mesh.borrowed);
+
+  current_mesh.morph_targets.resize(nb_submeshes);
+  for (size_t s = 0; s < nb_submeshes; ++s) {
+    current_mesh.morph_targets[s].resize(
+        gltf_mesh.primitives[s].targets.size());
+
+    bool has_normals = false;
+    bool has_tangents = false;
+
+    load_morph_targets(model, buffers, gltf_mesh.primitives[s],
+                       current_mesh.morph_targets[s], has_normals,
+                       has_tangents);
+
+    // Tangent deltas are only needed if the submesh has tangents
+    const bool generate_tangents =
+        !has_tangents && !current_mesh.tangents[s].empty();
+    if (current_mesh.morph_targets[s].empty() ||
+        (has_normals && !generate_tangents) ||
+        current_mesh.draw_call_descriptors[s].draw_mode != GL_TRIANGLES)
+      continue;
+
+    morph_frames_job frames;
+    frames.generator.reset(new tangent_space_generator(
+        current_mesh.indices[s], current_mesh.positions[s],
+        current_mesh.uvs[s]));
+    frames.submesh = s;
+    frames.normals = !has_normals;
+    frames.tangents = generate_tangents;
+    morph_frames.push_back(std::move(frames));
+  }
+}
 
-  if (scene.nodes.size() > 1)
-    std::cerr << "Warn: The currently loading scene has multiple root node. We "
-                 "create a virtual root node that parent all of them\n";
+// Instances with the same key decode to the same geometry: their primitives
+// read the same accessors, and neither the materials, that decide which
+// tangents are generated, nor the skinning, that decides what is borrowed,
+// differ
+static std::string geometry_key(const tinygltf::Mesh& gltf_mesh,
+                                bool skinned) {
+  std::string key = skinned ? "skinned" : "rigid";
+  for (const auto& primitive : gltf_mesh.primitives) {
+    key += "|" + std::to_string(primitive.mode) + " " +
+           std::to_string(primitive.indices) + " " +
+           std::to_string(primitive.material);
+    for (const auto& attribute : primitive.attributes)
+      key += " " + attribute.first + "=" + std::to_string(attribute.second);
+    for (const auto& target : primitive.targets) {
+      key += " (";
+      for (const auto& attribute : target)
+        key += " " + attribute.first + "=" + std::to_string(attribute.second);
+      key += ")";
+    }
+  }
+  return key;
+}
 
-  // dummy "all parent" node
-  for (size_t i = 0; i < scene.nodes.size(); ++i) {
-    const auto root_index = scene.nodes[i];
-    gltf_scene_tree.add_child();
-    auto& root = *gltf_scene_tree.children.back();
-    populate_gltf_graph(model, root, root_index);
+// Bytes of the indices, vertex attributes and morph targets of `a_mesh`,
+// borrowed attributes included
+static size_t geometry_bytes(const mesh& a_mesh) {
+  size_t bytes = 0;
+  for (const auto* arrays :
+       {&a_mesh.positions, &a_mesh.uvs, &a_mesh.colors, &a_mesh.normals,
+        &a_mesh.tangents, &a_mesh.weights})
+    for (const auto& array : *arrays) bytes += array.size() * sizeof(float);
+  for (const auto& array : a_mesh.joints)
+    bytes += array.size() * sizeof(unsigned short);
+  for (const auto& submesh : a_mesh.borrowed)
+    bytes += submesh.position.byte_size() + submesh.normal.byte_size() +
+             submesh.uv.byte_size() + submesh.tangent.byte_size();
+  for (size_t s = 0; s < a_mesh.indices.size(); ++s)
+    bytes += a_mesh.indices[s].size() *
+             (a_mesh.draw_call_descriptors[s].index_type == GL_UNSIGNED_SHORT
+                  ? sizeof(GLushort)
+                  : sizeof(unsigned));
+  for (const auto& targets : a_mesh.morph_targets)
+    for (const auto& target : targets)
+      bytes += target.vertices.size() * sizeof(unsigned) +
+               (target.position.size() + target.normal.size() +
+                target.tangent.size()) *
+                   sizeof(float);
+  return bytes;
+}
+
+// Give `copy` the decoded geometry of `source`, that has the same
+// `geometry_key`. Only the skin, that belongs to the node, is loaded again
+static void share_decoded_geometry(
+    const tinygltf::Model& model,
+    const gltf_insight::buffer_data::overrides& buffers, const mesh& source,
+    mesh& copy) {
+  copy.draw_call_descriptors = source.draw_call_descriptors;
+
+  // Static instances keep their per submesh arrays empty
+  if (copy.shares_cpu_geometry) {
+    copy.morph_targets.resize(source.morph_targets.size());
+    return;
+  }
+
+  copy.indices = source.indices;
+  copy.positions = source.positions;
+  copy.uvs = source.uvs;
+  copy.normals = source.normals;
+  copy.tangents = source.tangents;
+  copy.weights = source.weights;
+  copy.joints = source.joints;
+  copy.colors = source.colors;
+  copy.morph_targets = source.morph_targets;
+
+  copy.display_position = copy.positions;
+  copy.display_normals = copy.normals;
+  copy.display_tangents = copy.tangents;
+  copy.soft_skinned_position = copy.positions;
+  copy.soft_skinned_normals = copy.normals;
+  copy.soft_skinned_tangents = copy.tangents;
+
+  if (copy.skinned) {
+    const auto& gltf_skin =
+        model.skins[size_t(model.nodes[size_t(copy.instance.node)].skin)];
+    load_inverse_bind_matrix_array(model, buffers, gltf_skin,
+                                   size_t(copy.nb_joints),
+                                   copy.inverse_bind_matrices);
+  }
+}
+
+// Arrays stored per submesh in the processed scene cache, after its
+// {draw mode, index count, morph target count} header: indices, positions,
+// uvs, colors, normals, tangents, weights and joints, then the moved vertices,
+// position, normal and tangent deltas of each morph target. Positions, uvs,
+// normals and tangents are kept in their vertex format, as a {component type,
+// components, normalized, stride, count} array followed by the raw bytes
+static constexpr size_t cached_submesh_arrays = 12;
+static constexpr size_t cached_position_array = 2;
+static constexpr size_t cached_uv_array = 4;
+static constexpr size_t cached_normal_array = 7;
+static constexpr size_t cached_tangent_array = 9;
+static constexpr size_t cached_target_arrays = 4;
+
+// Read the vertex attribute stored at `array` and `array + 1` of a processed
+// scene cache entry, false if the format and the data disagree
+static bool read_cached_attribute(const scene_cache_entry& cached,
+                                  size_t array, borrowed_attribute& attribute) {
+  if (cached.count<uint64_t>(array) != 5) return false;
+  const uint64_t* format = cached.view<uint64_t>(array);
+  attribute.format.component_type = GLenum(format[0]);
+  attribute.format.components = GLint(format[1]);
+  attribute.format.normalized = format[2] ? GL_TRUE : GL_FALSE;
+  attribute.format.stride = GLsizei(format[3]);
+  attribute.count = size_t(format[4]);
+  attribute.data = cached.view<unsigned char>(array + 1);
+
+  return format[1] >= 1 && format[1] <= 4 &&
+         attribute.byte_size() == cached.count<unsigned char>(array + 1);
+}
+
+// Fill `target` with mesh `index` of a processed scene cache entry. Returns
+// false, without touching `target`, if the entry doesn't match the mesh
+static bool restore_cached_mesh(const tinygltf::Model& model,
+                                const scene_cache_entry& cached, size_t index,
+                                mesh& target) {
+  if (index >= cached.count<uint64_t>(0)) return false;
+  const auto& primitives =
+      model.meshes[size_t(target.instance.mesh)].primitives;
+
+  // Check the layout first
+  size_t array = size_t(cached.view<uint64_t>(0)[index]);
+  if (cached.count<uint64_t>(array) != 1 ||
+      cached.view<uint64_t>(array)[0] != primitives.size() ||
+      (target.skinned && cached.count<glm::mat4>(array + 1) !=
+                             size_t(target.nb_joints)))
+    return false;
+  size_t next = array + 2;
+  for (const auto& primitive : primitives) {
+    borrowed_attribute attribute;
+    if (cached.count<uint64_t>(next) != 3 ||
+        cached.view<uint64_t>(next)[2] != primitive.targets.size() ||
+        !read_cached_attribute(cached, next + cached_position_array,
+                               attribute) ||
+        !read_cached_attribute(cached, next + cached_uv_array, attribute) ||
+        !read_cached_attribute(cached, next + cached_normal_array, attribute) ||
+        !read_cached_attribute(cached, next + cached_tangent_array, attribute))
+      return false;
+    next += 1 + cached_submesh_arrays +
+            cached_target_arrays * primitive.targets.size();
+  }
+  if (next > cached.arrays.size()) return false;
+
+  array += 1;
+  cached.get(array++, target.inverse_bind_matrices);
+
+  // Static meshes point into the cache file, the others get a float copy
+  const auto restore_attribute = [&](std::vector<float>& values,
+                                     borrowed_attribute* borrowed) {
+    borrowed_attribute attribute;
+    read_cached_attribute(cached, array, attribute);
+    if (borrowed && attribute.count > 0) {
+      *borrowed = attribute;
+      values.clear();
+    } else {
+      attribute.copy_to(values);
+    }
+    array += 2;
+  };
+
+  target.morph_targets.resize(primitives.size());
+  for (size_t s = 0; s < primitives.size(); ++s) {
+    const uint64_t* header = cached.view<uint64_t>(array++);
+    auto& descriptor = target.draw_call_descriptors[s];
+    descriptor.draw_mode = GLenum(header[0]);
+    descriptor.count = size_t(header[1]);
+    descriptor.VAO = 0;
+
+    auto* borrowed = target.borrowed.empty() ? nullptr : &target.borrowed[s];
+    cached.get(array++, target.indices[s]);
+    restore_attribute(target.positions[s],
+                      borrowed ? &borrowed->position : nullptr);
+    restore_attribute(target.uvs[s], borrowed ? &borrowed->uv : nullptr);
+    cached.get(array++, target.colors[s]);
+    restore_attribute(target.normals[s],
+                      borrowed ? &borrowed->normal : nullptr);
+    restore_attribute(target.tangents[s],
+                      borrowed ? &borrowed->tangent : nullptr);
+    cached.get(array++, target.weights[s]);
+    cached.get(array++, target.joints[s]);
+
+    target.morph_targets[s].resize(size_t(header[2]));
+    for (auto& morph_target : target.morph_targets[s]) {
+      cached.get(array++, morph_target.vertices);
+      cached.get(array++, morph_target.position);
+      cached.get(array++, morph_target.normal);
+      cached.get(array++, morph_target.tangent);
+    }
+  }
+
+  return true;
+}
+
+// Write the decoded `meshes` to the processed scene cache
+static bool store_scene_cache(const scene_cache& cache, uint64_t hash,
+                              const std::vector<mesh>& meshes) {
+  scene_cache_entry entry;
+
+  // The entry only references its arrays, headers need a stable address
+  std::vector<uint64_t> first_arrays(meshes.size());
+  std::deque<std::array<uint64_t, 3>> headers;
+  std::deque<std::array<uint64_t, 5>> formats;
+  entry.add(first_arrays);
+
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    const auto& cached_mesh = meshes[i];
+    first_arrays[i] = entry.arrays.size();
+
+    // Instances that share the geometry of another mesh are never restored,
+    // they copy it again from their source
+    const auto nb_submeshes = cached_mesh.geometry_source >= 0
+                                  ? size_t(0)
+                                  : cached_mesh.draw_call_descriptors.size();
+    headers.push_back({{nb_submeshes, 0, 0}});
+    entry.add(headers.back().data(), 1);
+    entry.add(cached_mesh.inverse_bind_matrices);
+
+    for (size_t s = 0; s < nb_submeshes; ++s) {
+      const auto& descriptor = cached_mesh.draw_call_descriptors[s];
+      headers.push_back({{descriptor.draw_mode, descriptor.count,
+                          cached_mesh.morph_targets[s].size()}});
+      entry.add(headers.back().data(), 3);
+
+      const auto* borrowed = cached_mesh.borrowed.empty()
+                                 ? nullptr
+                                 : &cached_mesh.borrowed[s];
+      const auto add_attribute = [&](const std::vector<float>& values,
+                                     GLint components,
+                                     const borrowed_attribute* source) {
+        borrowed_attribute attribute;
+        if (source && !source->empty()) {
+          attribute = *source;
+        } else {
+          attribute.data = values.data();
+          attribute.format = vertex_format::floats(components);
+          attribute.count = values.size() / size_t(components);
+        }
+        const auto& format = attribute.format;
+        formats.push_back({{format.component_type, uint64_t(format.components),
+                            format.normalized, uint64_t(format.stride),
+                            attribute.count}});
+        entry.add(formats.back().data(), 5);
+        entry.add(static_cast<const unsigned char*>(attribute.data),
+                  attribute.byte_size());
+      };
+
+      entry.add(cached_mesh.indices[s]);
+      add_attribute(cached_mesh.positions[s], 3,
+                    borrowed ? &borrowed->position : nullptr);
+      add_attribute(cached_mesh.uvs[s], 2, borrowed ? &borrowed->uv : nullptr);
+      entry.add(cached_mesh.colors[s]);
+      add_attribute(cached_mesh.normals[s], 3,
+                    borrowed ? &borrowed->normal : nullptr);
+      add_attribute(cached_mesh.tangents[s], 4,
+                    borrowed ? &borrowed->tangent : nullptr);
+      entry.add(cached_mesh.weights[s]);
+      entry.add(cached_mesh.joints[s]);
+
+      for (const auto& morph_target : cached_mesh.morph_targets[s]) {
+        entry.add(morph_target.vertices);
+        entry.add(morph_target.position);
+        entry.add(morph_target.normal);
+        entry.add(morph_target.tangent);
+      }
+    }
   }
 
-  set_mesh_attachment(model, gltf_scene_tree);
-  auto meshes_indices = get_list_of_mesh_instances(gltf_scene_tree);
+  return cache.store(hash, entry);
+}
 
-  loaded_meshes.resize(meshes_indices.size());
+void app::load_meshes(staged_asset& asset,
+                      const std::vector<gltf_mesh_instance>& meshes_indices,
+                      background_load* job) {
+  using clock = std::chrono::steady_clock;
+  const auto load_start = clock::now();
+
+  // Skins point into the scene graph, and selection ids are handed out in
+  // order, so this first pass stays on the calling thread
+  asset.meshes.resize(meshes_indices.size());
   std::cerr << "Loading " << meshes_indices.size() << " meshes from glTF\n";
   for (size_t i = 0; i < meshes_indices.size(); ++i) {
     std::cerr << "mesh " << i << "\n";
 
-    loaded_meshes[i].instance = meshes_indices[i];
-    auto& current_mesh = loaded_meshes[i];
+    asset.meshes[i].instance = meshes_indices[i];
+    auto& current_mesh = asset.meshes[i];
 
     const auto skin_index =
-        model.nodes[size_t(current_mesh.instance.node)].skin;
+        asset.model.nodes[size_t(current_mesh.instance.node)].skin;
     if (skin_index >= 0) {
       current_mesh.skinned = true;
-      const auto& gltf_skin = model.skins[size_t(skin_index)];
+      const auto& gltf_skin = asset.model.skins[size_t(skin_index)];
       current_mesh.nb_joints = int(gltf_skin.joints.size());
       create_flat_bone_list(gltf_skin, size_t(current_mesh.nb_joints),
-                            gltf_scene_tree, current_mesh.flat_joint_list);
+                            asset.scene_tree, current_mesh.flat_joint_list);
 
       for (auto joint : current_mesh.flat_joint_list)
         joint->skin_mesh_node =
-            gltf_scene_tree.get_node_with_index(current_mesh.instance.node);
+            asset.scene_tree.get_node_with_index(current_mesh.instance.node);
 
       current_mesh.joint_matrices.resize(size_t(current_mesh.nb_joints));
-      load_inverse_bind_matrix_array(model, gltf_skin,
-                                     size_t(current_mesh.nb_joints),
-                                     current_mesh.inverse_bind_matrices);
       generate_joint_inverse_bind_matrix_map(
           gltf_skin, size_t(current_mesh.nb_joints),
           current_mesh.joint_inverse_bind_matrix_map);
@@ -349,7 +959,8 @@ void app::load() {
       current_mesh.skinned = false;
     }
 
-    const auto& gltf_mesh = model.meshes[size_t(current_mesh.instance.mesh)];
+    const auto& gltf_mesh =
+        asset.model.meshes[size_t(current_mesh.instance.mesh)];
 
     if (!gltf_mesh.name.empty())
       current_mesh.name = gltf_mesh.name;
@@ -370,182 +981,285 @@ void app::load() {
     current_mesh.uvs.resize(nb_submeshes);
     current_mesh.colors.resize(nb_submeshes);
     current_mesh.normals.resize(nb_submeshes);
+    current_mesh.tangents.resize(nb_submeshes);
     current_mesh.weights.resize(nb_submeshes);
     current_mesh.joints.resize(nb_submeshes);
-    current_mesh.VAOs.resize(nb_submeshes);
-    current_mesh.VBOs.resize(nb_submeshes);
     current_mesh.submesh_selection_ids.resize(nb_submeshes);
     std::generate(current_mesh.submesh_selection_ids.begin(),
                   current_mesh.submesh_selection_ids.end(), [] {
                     mesh::selection_id_counter.next();
                     return mesh::selection_id_counter;
                   });
+  }
 
-    // Create OpenGL objects for submehes
-    glGenVertexArrays(GLsizei(nb_submeshes), current_mesh.VAOs.data());
-    for (auto& VBO : current_mesh.VBOs) {
-      glGenBuffers(VBO_count, VBO.data());
+  // Instances whose primitives read the same accessors share the decoding of
+  // the first one
+  asset.sharing = sharing_report();
+  std::map<std::string, size_t> first_with_key;
+  for (size_t i = 0; i < asset.meshes.size(); ++i) {
+    auto& current_mesh = asset.meshes[i];
+    const auto first = first_with_key.emplace(
+        geometry_key(asset.model.meshes[size_t(current_mesh.instance.mesh)],
+                     current_mesh.skinned),
+        i);
+    if (!first.second) {
+      current_mesh.geometry_source = int(first.first->second);
+      ++asset.sharing.nb_shared_meshes;
     }
+  }
+
+  // A warm load restores the decoded meshes from the processed scene cache
+  uint64_t content_hash = 0;
+  scene_cache_entry cached;
+  if (processed_scene_cache.enabled()) {
+    content_hash = scene_content_hash(asset.filename, asset.model);
+    if (content_hash != 0) processed_scene_cache.load(content_hash, cached);
+  }
+
+  // The decoding itself only reads `asset.model`, each mesh can be done on its
+  // own thread. Results only depend on the mesh, not on the thread count.
+  std::vector<std::vector<std::string>> target_names(asset.meshes.size());
+  std::vector<double> decode_ms(asset.meshes.size(), 0.0);
+  std::vector<std::vector<morph_frames_job>> morph_frames(asset.meshes.size());
+  std::atomic<size_t> nb_decoded{0};
+  std::atomic<size_t> nb_restored{0};
+  const auto decode_start = clock::now();
+  parallel_for(asset.meshes.size(), load_threads, [&](size_t i) {
+    // Once cancelled, the remaining meshes are skipped
+    if (job && job->cancel) return;
+
+    const auto mesh_start = clock::now();
+    auto& current_mesh = asset.meshes[i];
+    const auto& gltf_mesh =
+        asset.model.meshes[size_t(current_mesh.instance.mesh)];
+    const auto& gltf_mesh_primitives = gltf_mesh.primitives;
+    const auto nb_submeshes = gltf_mesh_primitives.size();
 
-    // For each submesh of the mesh, load the data
-    load_geometry(model, textures, gltf_mesh_primitives,
-                  current_mesh.draw_call_descriptors, current_mesh.VAOs,
-                  current_mesh.VBOs, current_mesh.indices,
-                  current_mesh.positions, current_mesh.uvs, current_mesh.colors,
-                  current_mesh.normals, current_mesh.weights,
-                  current_mesh.joints);
+    // Meshes that are never deformed don't need their vertices on the CPU,
+    // unless the user picks them or exports them. They are uploaded straight
+    // from the glTF buffers.
+    const bool is_static =
+        !current_mesh.skinned &&
+        std::all_of(gltf_mesh_primitives.begin(), gltf_mesh_primitives.end(),
+                    [](const tinygltf::Primitive& primitive) {
+                      return primitive.targets.empty();
+                    });
+    // The instances of a static mesh have no use for vertices of their own
+    // either, they read the ones of their source
+    if (is_static && current_mesh.geometry_source >= 0)
+      current_mesh.shares_cpu_geometry = true;
+    else if (is_static && !headless)
+      current_mesh.borrowed.resize(nb_submeshes);
+
+    if (current_mesh.geometry_source >= 0) {
+      // Copied from its source once that one is complete
+    } else if (!cached.arrays.empty() &&
+               restore_cached_mesh(asset.model, cached, i, current_mesh)) {
+      ++nb_restored;
+    } else {
+      decode_mesh(asset.model, asset.buffers, current_mesh, morph_frames[i]);
+    }
 
     current_mesh.display_position = current_mesh.positions;
     current_mesh.display_normals = current_mesh.normals;
+    current_mesh.display_tangents = current_mesh.tangents;
 
     current_mesh.soft_skinned_position = current_mesh.positions;
     current_mesh.soft_skinned_normals = current_mesh.normals;
+    current_mesh.soft_skinned_tangents = current_mesh.tangents;
 
-    // cleanup opengl state
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-    current_mesh.shader_list = std::unique_ptr<std::map<std::string, shader>>(
-        new std::map<std::string, shader>);
-
-    current_mesh.soft_skin_shader_list =
-        std::unique_ptr<std::map<std::string, shader>>(
-            new std::map<std::string, shader>);
-
-    current_mesh.morph_targets.resize(nb_submeshes);
     current_mesh.materials.resize(nb_submeshes);
-    std::cerr << "loading primitive data:\n";
-    for (size_t s = 0; s < nb_submeshes; ++s) {
-      std::cerr << "Submesh " << s << "\n";
-
+    for (size_t s = 0; s < nb_submeshes; ++s)
       current_mesh.materials[s] = gltf_mesh.primitives[s].material;
-      std::cerr << "using material index " << current_mesh.materials[s] << "\n";
-
-      current_mesh.morph_targets[s].resize(
-          gltf_mesh.primitives[s].targets.size());
-
-      bool has_normals = false;
-      bool has_tangents = false;
-
-      load_morph_targets(model, gltf_mesh.primitives[s],
-                         current_mesh.morph_targets[s], has_normals,
-                         has_tangents);
-
-      if (!has_normals) {
-        for (auto& morph_target : current_mesh.morph_targets[s]) {
-          morph_target.normal.resize(morph_target.position.size());
-          for (size_t tri = 0; tri < current_mesh.indices[s].size() / 3;
-               ++tri) {
-            const auto i0 = current_mesh.indices[s][3 * i + 0];
-            const auto i1 = current_mesh.indices[s][3 * i + 1];
-            const auto i2 = current_mesh.indices[s][3 * i + 2];
-
-            // moph the triangle to the full extent of that morph target
-            const glm::vec3 v0 = glm::vec3(current_mesh.positions[s][i0 + 0],
-                                           current_mesh.positions[s][i0 + 1],
-                                           current_mesh.positions[s][i0 + 2]) +
-                                 glm::vec3(morph_target.position[i0 + 0],
-                                           morph_target.position[i0 + 1],
-                                           morph_target.position[i0 + 2]);
-
-            const glm::vec3 v1 = glm::vec3(current_mesh.positions[s][i1 + 0],
-                                           current_mesh.positions[s][i1 + 1],
-                                           current_mesh.positions[s][i1 + 2]) +
-                                 glm::vec3(morph_target.position[i1 + 0],
-                                           morph_target.position[i1 + 1],
-                                           morph_target.position[i1 + 2]);
-
-            const glm::vec3 v2 = glm::vec3(current_mesh.positions[s][i2 + 0],
-                                           current_mesh.positions[s][i2 + 1],
-                                           current_mesh.positions[s][i2 + 2]) +
-                                 glm::vec3(morph_target.position[i2 + 0],
-                                           morph_target.position[i2 + 1],
-                                           morph_target.position[i2 + 2]);
-            // generate normal vector
-            const glm::vec3 morph_n =
-                glm::normalize(glm::cross(v0 - v1, v1 - v2));
-            const glm::vec3
-                unmorph_n =  // we assume flat normals, so we can take the one
-                             // from i0, i1 or i2, it doesn't change anything
-                glm::vec3(current_mesh.normals[s][i0 + 0],
-                          current_mesh.normals[s][i0 + 1],
-                          current_mesh.normals[s][i0 + 2]);
-
-            // calculate the delta
-            const glm::vec3 n = morph_n - unmorph_n;
-
-            morph_target.normal[i0 + 0] = n.x;
-            morph_target.normal[i0 + 1] = n.y;
-            morph_target.normal[i0 + 2] = n.z;
-            morph_target.normal[i1 + 0] = n.x;
-            morph_target.normal[i1 + 1] = n.y;
-            morph_target.normal[i1 + 2] = n.z;
-            morph_target.normal[i2 + 0] = n.x;
-            morph_target.normal[i2 + 1] = n.y;
-            morph_target.normal[i2 + 2] = n.z;
-          }
-        }
-      }
-    }
 
     current_mesh.nb_morph_targets = 0;
     for (auto& target : current_mesh.morph_targets) {
       current_mesh.nb_morph_targets =
           std::max<int>(int(target.size()), current_mesh.nb_morph_targets);
     }
-    std::vector<std::string> target_names(
-        size_t(current_mesh.nb_morph_targets));
-    load_morph_target_names(gltf_mesh, target_names);
-    gltf_scene_tree.pose.target_names = target_names;
-
-    load_shaders(size_t(current_mesh.nb_joints), *current_mesh.shader_list);
-    if (current_mesh.skinned)
-      load_shaders(0, *current_mesh.soft_skin_shader_list);
+    target_names[i].resize(size_t(current_mesh.nb_morph_targets));
+    load_morph_target_names(gltf_mesh, target_names[i]);
+
+    decode_ms[i] = std::chrono::duration<double, std::milli>(clock::now() -
+                                                             mesh_start)
+                       .count();
+
+    if (job)
+      job->progress = 0.35f + 0.55f * float(++nb_decoded) /
+                                  float(asset.meshes.size());
+  });
+
+  // Then the normal and tangent deltas of the morph targets, one target per
+  // work item
+  struct morph_frames_item {
+    size_t mesh, frames, target;
+  };
+  std::vector<morph_frames_item> frames_items;
+  for (size_t i = 0; i < morph_frames.size(); ++i) {
+    for (size_t j = 0; j < morph_frames[i].size(); ++j) {
+      const auto& targets =
+          asset.meshes[i].morph_targets[morph_frames[i][j].submesh];
+      for (size_t t = 0; t < targets.size(); ++t)
+        frames_items.push_back({i, j, t});
+    }
   }
-
-  const auto nb_animations = model.animations.size();
-  animations.resize(nb_animations);
-  load_animations(model, animations);
-  fill_sequencer();
-
-  for (auto& animation : animations) {
-    animation.set_gltf_graph_targets(&gltf_scene_tree);
+  std::vector<double> frames_ms(frames_items.size(), 0.0);
+  parallel_for(frames_items.size(), load_threads, [&](size_t f) {
+    if (job && job->cancel) return;
+
+    const auto frames_start = clock::now();
+    const auto& item = frames_items[f];
+    auto& current_mesh = asset.meshes[item.mesh];
+    const auto& frames = morph_frames[item.mesh][item.frames];
+    generate_morph_target_frames(
+        *frames.generator, current_mesh.positions[frames.submesh],
+        current_mesh.normals[frames.submesh], frames.normals, frames.tangents,
+        current_mesh.morph_targets[frames.submesh][item.target]);
+    frames_ms[f] = std::chrono::duration<double, std::milli>(clock::now() -
+                                                             frames_start)
+                       .count();
+  });
+  for (size_t f = 0; f < frames_items.size(); ++f)
+    decode_ms[frames_items[f].mesh] += frames_ms[f];
+
+  // Finally the instances that share the geometry of another one
+  parallel_for(asset.meshes.size(), load_threads, [&](size_t i) {
+    auto& current_mesh = asset.meshes[i];
+    if (current_mesh.geometry_source < 0 || (job && job->cancel)) return;
+
+    const auto share_start = clock::now();
+    share_decoded_geometry(
+        asset.model, asset.buffers,
+        asset.meshes[size_t(current_mesh.geometry_source)], current_mesh);
+    decode_ms[i] += std::chrono::duration<double, std::milli>(clock::now() -
+                                                              share_start)
+                        .count();
+  });
+  const auto decode_stop = clock::now();
+
+  // Only the arrays a shared instance does not hold itself are saved, the
+  // ones it deep-copies to deform them are still allocated
+  for (const auto& current_mesh : asset.meshes)
+    if (current_mesh.geometry_source >= 0)
+      asset.sharing.shared_decoded_bytes +=
+          geometry_bytes(asset.meshes[size_t(current_mesh.geometry_source)]) -
+          geometry_bytes(current_mesh);
+
+  if (!asset.meshes.empty() &&
+      nb_restored + asset.sharing.nb_shared_meshes == asset.meshes.size()) {
+    asset.load_report.from_scene_cache = true;
+  } else if (content_hash != 0 && !(job && job->cancel) &&
+             asset.draco_report.nb_skipped == 0) {
+    // Primitives that could not be decoded must not be cached as empty
+    if (!store_scene_cache(processed_scene_cache, content_hash,
+                           asset.meshes))
+      std::cerr << "Warn: could not write to the scene cache\n";
   }
+  // Static meshes can point into the cache file
+  if (nb_restored > 0) asset.cached_geometry = cached.mapping;
+
+  // The pose only has one list of target names, the last mesh sets it
+  if (!target_names.empty())
+    asset.scene_tree.pose.target_names = target_names.back();
+
+  asset.load_report.nb_meshes = asset.meshes.size();
+  asset.load_report.nb_threads =
+      parallel_for_thread_count(asset.meshes.size(), load_threads);
+  asset.load_report.setup_ms =
+      std::chrono::duration<double, std::milli>(decode_start - load_start)
+          .count();
+  asset.load_report.decode_wall_ms =
+      std::chrono::duration<double, std::milli>(decode_stop - decode_start)
+          .count();
+  asset.load_report.decode_cpu_ms =
+      std::accumulate(decode_ms.begin(), decode_ms.end(), 0.0);
+
+  const auto& report = asset.load_report;
+  std::cerr << "Decoded " << report.nb_meshes << " meshes in "
+            << report.decode_wall_ms << "ms on " << report.nb_threads
+            << " threads (" << report.decode_cpu_ms << "ms of work, overlap x"
+            << report.work_overlap() << ")"
+            << (report.from_scene_cache ? " from the scene cache" : "")
+            << "\n";
+}
 
-  // TODO this is ... mh... per node?
-  auto nb_morph_targets = loaded_meshes[0].nb_morph_targets;
-  for (size_t i = 1; i < loaded_meshes.size(); ++i) {
-    nb_morph_targets =
-        std::max(nb_morph_targets, loaded_meshes[i].nb_morph_targets);
-  }
+void app::upload_meshes() {
+  for (auto& current_mesh : loaded_meshes) {
+    const auto nb_submeshes = current_mesh.draw_call_descriptors.size();
+    current_mesh.VAOs.resize(nb_submeshes);
+    current_mesh.VBOs.resize(nb_submeshes);
 
-  gltf_scene_tree.pose.blend_weights.resize(size_t(nb_morph_targets));
-  std::generate(gltf_scene_tree.pose.blend_weights.begin(),
-                gltf_scene_tree.pose.blend_weights.end(), [] { return 0.f; });
+    // Instances of a static mesh draw from the buffers of the first one,
+    // that comes earlier in the list
+    if (current_mesh.geometry_source >= 0 && !current_mesh.skinned &&
+        current_mesh.nb_morph_targets == 0) {
+      const auto& source =
+          loaded_meshes[size_t(current_mesh.geometry_source)];
+      current_mesh.VAOs = source.VAOs;
+      current_mesh.VBOs = source.VBOs;
+      current_mesh.draw_call_descriptors = source.draw_call_descriptors;
+      current_mesh.shares_gpu_geometry = true;
+      sharing.nb_shared_submeshes += nb_submeshes;
+      sharing.shared_buffer_bytes += geometry_bytes(source);
+    } else {
+      // Create OpenGL objects for submehes
+      glGenVertexArrays(GLsizei(nb_submeshes), current_mesh.VAOs.data());
+      for (auto& VBO : current_mesh.VBOs) {
+        if (mesh_vertex_layout == vertex_layout::interleaved) {
+          // The unused slots stay 0, that glDeleteBuffers ignores
+          glGenBuffers(1, &VBO[VBO_stream_dynamic]);
+          glGenBuffers(1, &VBO[VBO_stream_static]);
+          glGenBuffers(1, &VBO[VBO_layout_EBO]);
+        } else {
+          glGenBuffers(VBO_count, VBO.data());
+        }
+      }
 
-  animation_names.resize(nb_animations);
-  for (size_t i = 0; i < animations.size(); ++i)
-    animation_names[i] = animations[i].name;
+      upload_geometry(current_mesh.draw_call_descriptors, current_mesh.VAOs,
+                      current_mesh.VBOs, current_mesh.indices,
+                      current_mesh.positions, current_mesh.uvs,
+                      current_mesh.colors, current_mesh.normals,
+                      current_mesh.tangents, current_mesh.weights,
+                      current_mesh.joints, current_mesh.borrowed,
+                      mesh_vertex_layout);
+
+      // Static meshes can be drawn instanced
+      if (!current_mesh.skinned && current_mesh.nb_morph_targets == 0) {
+        for (const auto VAO : current_mesh.VAOs) {
+          glBindVertexArray(VAO);
+          set_instance_attributes(instance_VBO);
+        }
+        glBindVertexArray(0);
+      }
+    }
 
-  asset_loaded = true;
+    // cleanup opengl state
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-  if (!loaded_meshes.empty()) {
-    for (auto shader_it = loaded_meshes[0].shader_list->begin();
-         shader_it != loaded_meshes[0].shader_list->end(); ++shader_it)
-      shader_names.push_back(shader_it->first);
+    current_mesh.shader_list = shader_set(current_mesh.nb_joints != 0);
+    if (current_mesh.skinned)
+      current_mesh.soft_skin_shader_list = shader_set(false);
+  }
+}
 
-    for (size_t i = 0; i < shader_names.size(); ++i) {
-      if (shader_names[i] == "unlit") {
-        selected_shader = int(i);
-        break;
-      }
-    }
+std::shared_ptr<shader_registry> app::shader_set(bool skinned) {
+  auto& set = shader_sets[skinned ? 1 : 0];
+  if (!set) {
+    set = std::make_shared<shader_registry>();
+    load_shaders(skinned, *set,
+                 program_binaries.enabled() ? &program_binaries : nullptr);
   }
+  return set;
 }
 
 mesh::~mesh() {
-  for (auto& VBO : VBOs) glDeleteBuffers(VBO_count, VBO.data());
-  glDeleteVertexArrays(GLsizei(VAOs.size()), VAOs.data());
+  // Meshes loaded without an OpenGL context never got any GPU objects
+  if (!shares_gpu_geometry) {
+    for (auto& VBO : VBOs) glDeleteBuffers(VBO_count, VBO.data());
+    if (!VAOs.empty())
+      glDeleteVertexArrays(GLsizei(VAOs.size()), VAOs.data());
+  }
 
   displayed = true;
   skinned = false;
@@ -558,14 +1272,17 @@ mesh::~mesh() {
   positions.clear();
   uvs.clear();
   normals.clear();
+  tangents.clear();
   weights.clear();
   display_position.clear();
   display_normals.clear();
+  display_tangents.clear();
   indices.clear();
   flat_joint_list.clear();
   joint_inverse_bind_matrix_map.clear();
   joint_matrices.clear();
   colors.clear();
+  borrowed.clear();
   instance.mesh = -1;
   instance.node = -1;
   draw_call_descriptors.clear();
@@ -574,44 +1291,13 @@ mesh::~mesh() {
 bool mesh::raycast_submesh_camera_mouse(glm::mat4 world_xform, size_t submesh,
                                         glm::vec3 world_camera_position,
                                         glm::mat4 vp, float x, float y) const {
+  // Strips and fans were made into lists at load time, lines and points
+  // can't be picked
+  if (draw_call_descriptors[submesh].draw_mode != GL_TRIANGLES) return false;
+
   constexpr size_t stride = 3 * sizeof(float);
   std::vector<float> world_positions(positions[submesh].size());
-  auto* index_buffer = &indices[submesh];
-  std::vector<unsigned> reserve_buffer;
-
-  if (draw_call_descriptors[submesh].draw_mode != GL_TRIANGLES) {
-    switch (draw_call_descriptors[submesh].draw_mode) {
-      default:
-        return false;
-
-      case GL_TRIANGLE_FAN: {
-        const unsigned first_index = (*index_buffer)[0];
-        unsigned last_index_used = (*index_buffer)[1];
-        const auto nb_triangles = index_buffer->size() - 2;
-        reserve_buffer.resize(3 * (nb_triangles));
-        for (size_t i = 0; i < nb_triangles; ++i) {
-          reserve_buffer[3 * i + 0] = first_index;
-          reserve_buffer[3 * i + 1] = last_index_used;
-          last_index_used = (*index_buffer)[2 + i];
-          reserve_buffer[3 * i + 2];
-        }
-        index_buffer = &reserve_buffer;
-      } break;
-      case GL_TRIANGLE_STRIP: {
-        const auto nb_triangles = index_buffer->size() - 2;
-        reserve_buffer.resize(3 * (nb_triangles));
-        for (size_t i = 0; i < nb_triangles; ++i) {
-          reserve_buffer[3 * i + 0] = (*index_buffer)[2 + i];
-          reserve_buffer[3 * i + 1] = (*index_buffer)[1 + i];
-          reserve_buffer[3 * i + 2] = (*index_buffer)[i];
-        }
-        index_buffer = &reserve_buffer;
-      } break;
-    }
-  }
-
-  const auto nb_triangles = index_buffer->size() / 3;
-  (void)nb_triangles;
+  const auto* index_buffer = &indices[submesh];
 
   for (size_t v = 0; v < world_positions.size() / 3; ++v) {
     const auto& model_vertex_buffer =
@@ -735,11 +1421,14 @@ bool mesh::raycast_submesh_camera_mouse(glm::mat4 world_xform, size_t submesh,
 }
 
 mesh& mesh::operator=(mesh&& o) {
+  name = std::move(o.name);
   nb_joints = o.nb_joints;
   nb_morph_targets = o.nb_morph_targets;
+  skinned = o.skinned;
   instance = o.instance;
   displayed = o.displayed;
   joint_matrices = std::move(o.joint_matrices);
+  joint_palette_offset = o.joint_palette_offset;
   joint_inverse_bind_matrix_map = std::move(o.joint_inverse_bind_matrix_map);
   flat_joint_list = std::move(o.flat_joint_list);
   inverse_bind_matrices = std::move(o.inverse_bind_matrices);
@@ -749,13 +1438,29 @@ mesh& mesh::operator=(mesh&& o) {
   positions = std::move(o.positions);
   uvs = std::move(o.uvs);
   normals = std::move(o.normals);
+  tangents = std::move(o.tangents);
   weights = std::move(o.weights);
   display_position = std::move(o.display_position);
   display_normals = std::move(o.display_normals);
+  display_tangents = std::move(o.display_tangents);
   soft_skinned_position = std::move(o.soft_skinned_position);
   soft_skinned_normals = std::move(o.soft_skinned_normals);
+  soft_skinned_tangents = std::move(o.soft_skinned_tangents);
   joints = std::move(o.joints);
   colors = std::move(o.colors);
+  borrowed = std::move(o.borrowed);
+  submesh_selection_ids = std::move(o.submesh_selection_ids);
+  materials = std::move(o.materials);
+
+  geometry_source = o.geometry_source;
+
+  // The GL objects now belong to this mesh only
+  VAOs = std::move(o.VAOs);
+  VBOs = std::move(o.VBOs);
+  shares_gpu_geometry = o.shares_gpu_geometry;
+  shares_cpu_geometry = o.shares_cpu_geometry;
+  o.VAOs.clear();
+  o.VBOs.clear();
 
   shader_list = std::move(o.shader_list);
   soft_skin_shader_list = std::move(o.soft_skin_shader_list);
@@ -765,6 +1470,26 @@ mesh& mesh::operator=(mesh&& o) {
 
 mesh::mesh(mesh&& other) { *this = std::move(other); }
 
+void mesh::ensure_cpu_geometry() {
+  if (borrowed.empty()) return;
+
+  for (size_t submesh = 0; submesh < borrowed.size(); ++submesh) {
+    const auto& source = borrowed[submesh];
+    if (!source.position.empty()) source.position.copy_to(positions[submesh]);
+    if (!source.normal.empty()) source.normal.copy_to(normals[submesh]);
+    if (!source.uv.empty()) source.uv.copy_to(uvs[submesh]);
+    if (!source.tangent.empty()) source.tangent.copy_to(tangents[submesh]);
+  }
+
+  display_position = positions;
+  display_normals = normals;
+  display_tangents = tangents;
+  soft_skinned_position = positions;
+  soft_skinned_normals = normals;
+  soft_skinned_tangents = tangents;
+  borrowed.clear();
+}
+
 mesh::mesh() : instance() {}
 
 glm::vec3 editor_lighting::get_directional_light_direction() const {
@@ -842,12 +1567,14 @@ void app::async_worker::work_for_one_frame() {
     for (size_t sm = 0; sm < mesh.indices.size(); ++sm) {
       the_app->perform_software_morphing(
           the_app->gltf_scene_tree, sm, mesh.morph_targets, mesh.positions,
-          mesh.normals, mesh.display_position, mesh.display_normals, mesh.VBOs,
-          false);
-      the_app->perform_software_skinning(
-          sm, mesh.joint_matrices, mesh.display_position, mesh.display_normals,
-          mesh.joints, mesh.weights, mesh.soft_skinned_position,
-          mesh.soft_skinned_normals);
+          mesh.normals, mesh.tangents, mesh.display_position,
+          mesh.display_normals, mesh.display_tangents, mesh.VBOs, false);
+      if (mesh.skinned)
+        the_app->perform_software_skinning(
+            sm, mesh.joint_matrices, mesh.display_position,
+            mesh.display_normals, mesh.display_tangents, mesh.joints,
+            mesh.weights, mesh.soft_skinned_position,
+            mesh.soft_skinned_normals, mesh.soft_skinned_tangents);
     }
   }
 
@@ -892,18 +1619,8 @@ static void drop_callabck(GLFWwindow* window, int nums, const char** paths) {
     // Use the first one.
     // TODO(LTE): Search .gltf file from paths.
 
-    app->unload();
-    app->set_input_filename(paths[0]);
-
-    std::cout << "D&D filename : " << app->get_input_filename() << "\n";
-
-    try {
-      app->load();
-    } catch (const std::exception& e) {
-      std::cerr << "error occured during loading of "
-                << app->get_input_filename() << ": " << e.what() << '\n';
-      app->unload();
-    }
+    std::cout << "D&D filename : " << paths[0] << "\n";
+    app->start_loading(paths[0]);
   }
 }
 
@@ -932,6 +1649,11 @@ void app::initialize_mouse_select_framebuffer() {
 
 app::app(int argc, char** argv) {
   parse_command_line(argc, argv);
+  if (use_scene_cache) open_scene_cache();
+
+  // Everything below needs a window and an OpenGL context. In headless mode the
+  // asset is loaded by `run_headless()` instead
+  if (headless) return;
 
   initialize_glfw_opengl_window(window);
   // glfwSetWindowUserPointer(window, &gui_parameters);
@@ -958,21 +1680,266 @@ app::app(int argc, char** argv) {
   logo = load_gltf_insight_icon();
   utility_buffers::init_static_buffers();
 
-  if (!input_filename.empty()) {
+  // Static meshes always have the instance inputs enabled, even when they are
+  // drawn alone, so the buffer always holds at least one instance
+  const instance_transform identity{glm::mat4(1.f), glm::mat3(1.f)};
+  glGenBuffers(1, &instance_VBO);
+  glBindBuffer(GL_ARRAY_BUFFER, instance_VBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof identity, &identity, GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  skinning_palette.initialize();
+
+  glGenBuffers(1, &frame_UBO);
+  glBindBuffer(GL_UNIFORM_BUFFER, frame_UBO);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_uniforms), nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  texture_uploads.initialize();
+  if (use_texture_cache) open_texture_cache();
+  if (use_shader_cache) open_shader_cache();
+  texture_stream.start(load_threads);
+
+  if (!input_filename.empty()) start_loading(input_filename);
+
+  initialize_mouse_select_framebuffer();
+}
+
+app::~app() {
+  stop_background_load();
+  unload();
+  if (!headless) {
+    texture_stream.stop();
+    texture_uploads.release();
+    for (auto& set : shader_sets) set.reset();
+    material_blocks.release();
+    skinning_palette.release();
+    glDeleteBuffers(1, &frame_UBO);
+    glDeleteBuffers(1, &instance_VBO);
+    deinitialize_gui_and_window(window);
+  }
+}
+
+static std::string json_escape(const std::string& input) {
+  std::string output;
+  output.reserve(input.size());
+  for (const char c : input) {
+    switch (c) {
+      case '"':
+        output += "\\\"";
+        break;
+      case '\\':
+        output += "\\\\";
+        break;
+      case '\n':
+        output += "\\n";
+        break;
+      case '\t':
+        output += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof escaped, "\\u%04x",
+                   static_cast<unsigned>(static_cast<unsigned char>(c)));
+          output += escaped;
+        } else {
+          output += c;
+        }
+    }
+  }
+  return output;
+}
+
+static size_t count_non_finite(const std::vector<std::vector<float>>& arrays) {
+  size_t count = 0;
+  for (const auto& array : arrays)
+    for (const auto value : array)
+      if (!std::isfinite(value)) ++count;
+  return count;
+}
+
+int app::run_headless() {
+  using clock = std::chrono::steady_clock;
+
+  // Anything the loader prints goes to stderr, stdout only gets the summary
+  auto* const stdout_buffer = std::cout.rdbuf(std::cerr.rdbuf());
+
+  bool loaded = false;
+  std::string error;
+  const auto load_start = clock::now();
+  if (input_filename.empty()) {
+    error = "no input file given";
+  } else {
     try {
       load();
+      loaded = true;
     } catch (const std::exception& e) {
-      std::cerr << e.what() << '\n';
-      unload();
+      error = e.what();
     }
   }
+  const auto load_stop = clock::now();
+
+  // Evaluate every animation on a few time points, and run the same CPU
+  // morphing/skinning code as the OBJ exporter on the posed scene
+  constexpr int nb_samples = 5;
+  std::vector<size_t> animation_non_finite(animations.size(), 0);
+  for (size_t a = 0; a < animations.size(); ++a) {
+    auto& anim = animations[a];
+    for (int sample = 0; sample < nb_samples; ++sample) {
+      const float t = float(sample) / float(nb_samples - 1);
+      anim.set_time(anim.min_time + t * (anim.max_time - anim.min_time));
+      anim.apply_pose();
+      update_mesh_skeleton_graph_transforms(gltf_scene_tree);
+
+      for (auto& a_mesh : loaded_meshes) {
+        compute_joint_matrices(root_node_model_matrix, a_mesh.joint_matrices,
+                               a_mesh.flat_joint_list,
+                               a_mesh.inverse_bind_matrices);
+        for (size_t sm = 0; sm < a_mesh.indices.size(); ++sm) {
+          perform_software_morphing(
+              gltf_scene_tree, sm, a_mesh.morph_targets, a_mesh.positions,
+              a_mesh.normals, a_mesh.tangents, a_mesh.display_position,
+              a_mesh.display_normals, a_mesh.display_tangents, a_mesh.VBOs,
+              false);
+          if (a_mesh.skinned)
+            perform_software_skinning(
+                sm, a_mesh.joint_matrices, a_mesh.display_position,
+                a_mesh.display_normals, a_mesh.display_tangents, a_mesh.joints,
+                a_mesh.weights, a_mesh.soft_skinned_position,
+                a_mesh.soft_skinned_normals, a_mesh.soft_skinned_tangents);
+        }
 
-  initialize_mouse_select_framebuffer();
-}
+        // Static instances evaluate to their source, that comes earlier
+        const auto& evaluated =
+            a_mesh.shares_cpu_geometry
+                ? loaded_meshes[size_t(a_mesh.geometry_source)]
+                : a_mesh;
+        const auto& evaluated_positions = evaluated.skinned
+                                              ? evaluated.soft_skinned_position
+                                              : evaluated.display_position;
+        const auto& evaluated_normals = evaluated.skinned
+                                            ? evaluated.soft_skinned_normals
+                                            : evaluated.display_normals;
+        animation_non_finite[a] += count_non_finite(evaluated_positions) +
+                                   count_non_finite(evaluated_normals);
+      }
+    }
+  }
+  const auto evaluation_stop = clock::now();
+
+  benchmark_skinning();
+  if (loaded) benchmark_load();
+
+  std::cout.rdbuf(stdout_buffer);
+
+  size_t nb_submeshes = 0, nb_vertices = 0, nb_indices = 0, nb_skinned = 0;
+  size_t non_finite = 0;
+  int nb_morph_targets = 0;
+  for (const auto& a_mesh : loaded_meshes) {
+    const auto& geometry =
+        a_mesh.shares_cpu_geometry
+            ? loaded_meshes[size_t(a_mesh.geometry_source)]
+            : a_mesh;
+    nb_submeshes += a_mesh.draw_call_descriptors.size();
+    for (const auto& position : geometry.positions)
+      nb_vertices += position.size() / 3;
+    for (const auto& index : geometry.indices) nb_indices += index.size();
+    if (a_mesh.skinned) ++nb_skinned;
+    nb_morph_targets = std::max(nb_morph_targets, a_mesh.nb_morph_targets);
+    non_finite += count_non_finite(geometry.positions) +
+                  count_non_finite(geometry.normals);
+  }
+  for (const auto count : animation_non_finite) non_finite += count;
+
+  const auto to_ms = [](clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+  };
+
+  std::cout << "{\n"
+            << "  \"file\": \"" << json_escape(input_filename) << "\",\n"
+            << "  \"loaded\": " << (loaded ? "true" : "false") << ",\n"
+            << "  \"error\": \"" << json_escape(error) << "\",\n"
+            << "  \"load_time_ms\": " << to_ms(load_stop - load_start) << ",\n"
+            << "  \"evaluation_time_ms\": "
+            << to_ms(evaluation_stop - load_stop) << ",\n"
+            << "  \"mesh_decode\": {\"threads\": " << load_report.nb_threads
+            << ", \"setup_ms\": " << load_report.setup_ms
+            << ", \"wall_ms\": " << load_report.decode_wall_ms
+            << ", \"work_ms\": " << load_report.decode_cpu_ms
+            << ", \"work_overlap\": " << load_report.work_overlap()
+            << ", \"scene_cache\": "
+            << (load_report.from_scene_cache ? "true" : "false") << "},\n"
+            << "  \"image_decode\": {\"images\": " << image_report.nb_images
+            << ", \"headers_only\": "
+            << (image_report.headers_only ? "true" : "false")
+            << ", \"threads\": " << image_report.nb_threads
+            << ", \"wall_ms\": " << image_report.decode_wall_ms
+            << ", \"work_ms\": " << image_report.decode_cpu_ms
+            << ", \"work_overlap\": " << image_report.work_overlap() << "},\n"
+            << "  \"meshopt_decode\": {\"buffer_views\": "
+            << meshopt_report.nb_buffer_views
+            << ", \"threads\": " << meshopt_report.nb_threads
+            << ", \"encoded_bytes\": " << meshopt_report.encoded_bytes
+            << ", \"decoded_bytes\": " << meshopt_report.decoded_bytes
+            << ", \"wall_ms\": " << meshopt_report.decode_wall_ms
+            << ", \"work_ms\": " << meshopt_report.decode_cpu_ms
+            << ", \"gb_per_s\": " << meshopt_report.throughput() << "},\n"
+            << "  \"draco_decode\": {\"primitives\": "
+            << draco_report.nb_primitives
+            << ", \"threads\": " << draco_report.nb_threads
+            << ", \"wall_ms\": " << draco_report.decode_wall_ms
+            << ", \"work_ms\": " << draco_report.decode_cpu_ms
+            << ", \"work_overlap\": " << draco_report.work_overlap()
+            << ", \"primitive_ms\": [";
+  for (size_t p = 0; p < draco_report.primitives.size(); ++p)
+    std::cout << (p == 0 ? "" : ", ") << draco_report.primitives[p].ms;
+  std::cout << "]},\n"
+            << "  \"meshes\": " << loaded_meshes.size() << ",\n"
+            << "  \"submeshes\": " << nb_submeshes << ",\n"
+            << "  \"vertices\": " << nb_vertices << ",\n"
+            << "  \"indices\": " << nb_indices << ",\n"
+            << "  \"skinned_meshes\": " << nb_skinned << ",\n"
+            << "  \"morph_targets\": " << nb_morph_targets << ",\n"
+            << "  \"materials\": " << loaded_material.size() << ",\n"
+            << "  \"images\": " << model.images.size() << ",\n"
+            << "  \"sharing\": {\"meshes\": " << sharing.nb_shared_meshes
+            << ", \"decoded_bytes\": " << sharing.shared_decoded_bytes
+            << ", \"submeshes\": " << sharing.nb_shared_submeshes
+            << ", \"buffer_bytes\": " << sharing.shared_buffer_bytes
+            << ", \"images\": " << sharing.nb_shared_images
+            << ", \"image_bytes\": " << sharing.shared_image_bytes << "},\n"
+            << "  \"skinning_benchmark\": {\"iterations\": "
+            << skinning_benchmark.nb_iterations
+            << ", \"vertices\": " << skinning_benchmark.nb_vertices
+            << ", \"linear_blend_ms\": " << skinning_benchmark.linear_blend_ms
+            << ", \"dual_quaternion_ms\": "
+            << skinning_benchmark.dual_quaternion_ms << "},\n"
+            << "  \"load_benchmark\": {\"threads\": "
+            << load_benchmark.nb_threads
+            << ", \"serial_ms\": " << load_benchmark.serial_ms
+            << ", \"parallel_ms\": " << load_benchmark.parallel_ms
+            << ", \"speedup\": " << load_benchmark.speedup()
+            << ", \"serial_mesh_decode_ms\": "
+            << load_benchmark.serial_mesh_decode_ms
+            << ", \"parallel_mesh_decode_ms\": "
+            << load_benchmark.parallel_mesh_decode_ms
+            << ", \"mesh_decode_speedup\": "
+            << load_benchmark.mesh_decode_speedup() << "},\n"
+            << "  \"non_finite_values\": " << non_finite << ",\n"
+            << "  \"animations\": [";
+  for (size_t a = 0; a < animations.size(); ++a) {
+    const auto& anim = animations[a];
+    std::cout << (a == 0 ? "\n" : ",\n") << "    {\"name\": \""
+              << json_escape(anim.name) << "\", \"channels\": "
+              << anim.channels.size() << ", \"min_time\": " << anim.min_time
+              << ", \"max_time\": " << anim.max_time
+              << ", \"non_finite_values\": " << animation_non_finite[a] << "}";
+  }
+  std::cout << (animations.empty() ? "]\n" : "\n  ]\n") << "}\n";
 
-app::~app() {
-  unload();
-  deinitialize_gui_and_window(window);
+  return loaded && non_finite == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 void app::run_file_menu() {
@@ -1065,35 +2032,39 @@ void app::write_deformed_meshes_to_obj(const std::string filename) {
 
   tinyobj::shape_t shape;
   for (size_t mesh_idx = 0; mesh_idx < loaded_meshes.size(); ++mesh_idx) {
+    const auto& exported_mesh = cpu_geometry(mesh_idx);
     shape.name = loaded_meshes[mesh_idx].name;
 
     int offset = 0;
-    for (size_t submesh_idx = 0;
-         submesh_idx < loaded_meshes[mesh_idx].indices.size(); ++submesh_idx) {
+    for (size_t submesh_idx = 0; submesh_idx < exported_mesh.indices.size();
+         ++submesh_idx) {
       writer.attrib_.vertices =
-          loaded_meshes[mesh_idx].soft_skinned_position[submesh_idx];
+          exported_mesh.skinned
+              ? exported_mesh.soft_skinned_position[submesh_idx]
+              : exported_mesh.display_position[submesh_idx];
       writer.attrib_.normals =
-          loaded_meshes[mesh_idx].soft_skinned_normals[submesh_idx];
-      writer.attrib_.texcoords = loaded_meshes[mesh_idx].uvs[submesh_idx];
+          exported_mesh.skinned
+              ? exported_mesh.soft_skinned_normals[submesh_idx]
+              : exported_mesh.display_normals[submesh_idx];
+      writer.attrib_.texcoords = exported_mesh.uvs[submesh_idx];
 
       shape.mesh.num_face_vertices.resize(
-          loaded_meshes[mesh_idx].indices[submesh_idx].size() / 3);
+          exported_mesh.indices[submesh_idx].size() / 3);
       std::generate(shape.mesh.num_face_vertices.begin(),
                     shape.mesh.num_face_vertices.end(), [] { return 3; });
 
-      for (size_t i = 0;
-           i < loaded_meshes[mesh_idx].indices[submesh_idx].size(); ++i) {
+      for (size_t i = 0; i < exported_mesh.indices[submesh_idx].size(); ++i) {
         tinyobj::index_t index;
         index.vertex_index =
-            1 + int(loaded_meshes[mesh_idx].indices[submesh_idx][i]) + offset;
+            1 + int(exported_mesh.indices[submesh_idx][i]) + offset;
         index.normal_index =
-            1 + int(loaded_meshes[mesh_idx].indices[submesh_idx][i]) + offset;
+            1 + int(exported_mesh.indices[submesh_idx][i]) + offset;
         index.texcoord_index =
-            1 + int(loaded_meshes[mesh_idx].indices[submesh_idx][i]) + offset;
+            1 + int(exported_mesh.indices[submesh_idx][i]) + offset;
         shape.mesh.indices.push_back(index);
       }
 
-      offset += int(loaded_meshes[mesh_idx].indices[submesh_idx].size());
+      offset += int(exported_mesh.indices[submesh_idx].size());
     }
     writer.shapes_.push_back(shape);
   }
@@ -1188,10 +2159,13 @@ void app::create_transparent_docking_area(const ImVec2 pos, const ImVec2 size,
 }
 
 void app::draw_mesh(const glm::vec3& world_camera_location, const mesh& mesh,
-                    glm::mat3 normal_matrix, glm::mat4 model_matrix)
+                    glm::mat3 normal_matrix, glm::mat4 model_matrix,
+                    GLsizei nb_instances)
 
 {
-  if (!mesh.displayed) return;
+  // Instanced draws only use the geometry of `mesh`, the instances themselves
+  // were checked when they were gathered
+  if (!mesh.displayed && nb_instances == 0) return;
   for (size_t submesh = 0; submesh < mesh.draw_call_descriptors.size();
        ++submesh) {
     bool double_sided = true;
@@ -1205,10 +2179,10 @@ void app::draw_mesh(const glm::vec3& world_camera_location, const mesh& mesh,
         if (current_display_mode == display_mode::normal) {
           switch (material_to_use.intended_shader) {
             case shading_type::pbr_metal_rough:
-              shader_to_use = "pbr_metal_rough";
+              shader_to_use = shader_id::pbr_metal_rough;
               break;
             case shading_type::pbr_specular_glossy:
-              shader_to_use = "pbr_metal_rough";
+              shader_to_use = shader_id::pbr_metal_rough;
               {
                 static bool first_print = true;
                 if (first_print) {
@@ -1220,28 +2194,31 @@ void app::draw_mesh(const glm::vec3& world_camera_location, const mesh& mesh,
               }
               break;
             case shading_type::unlit:
-              shader_to_use = "unlit";
+              shader_to_use = shader_id::unlit;
               break;
           }
         }
 
         material_to_use.bind_textures();
 
-        auto& active_shader_list = (mesh.skinned && do_soft_skinning)
-                                       ? *mesh.soft_skin_shader_list
-                                       : *mesh.shader_list;
+        const auto& active_shader_list = (mesh.skinned && do_soft_skinning)
+                                             ? *mesh.soft_skin_shader_list
+                                             : *mesh.shader_list;
 
         const auto& active_shader = active_shader_list[shader_to_use];
 
-        material_to_use.set_shader_uniform(active_shader);
+        material_blocks.bind(size_t(material_id));
 
-        update_uniforms(
-            active_shader_list, editor_light.use_ibl, world_camera_location,
-            editor_light.color, editor_light.get_directional_light_direction(),
-            active_joint_index_model, shader_to_use,
-            projection_matrix * view_matrix * model_matrix,
-            projection_matrix * view_matrix * model_matrix, normal_matrix,
-            mesh.joint_matrices, active_poly_indices);
+        update_uniforms(active_shader_list, active_joint_index_model,
+                        shader_to_use, model_matrix,
+                        projection_matrix * view_matrix * model_matrix,
+                        normal_matrix, mesh.joint_palette_offset,
+                        active_poly_indices);
+        active_shader.set_uniform(uniform_id::instanced,
+                                  int(nb_instances > 0));
+        if (nb_instances > 0)
+          active_shader.set_uniform(uniform_id::view_projection,
+                                    projection_matrix * view_matrix);
 
         double_sided = material_to_use.double_sided;
 
@@ -1254,7 +2231,7 @@ void app::draw_mesh(const glm::vec3& world_camera_location, const mesh& mesh,
       }
 
     } else {
-      shader_to_use = "unlit";  // TODO(LTE): Assign dummy shader
+      shader_to_use = shader_id::unlit;  // TODO(LTE): Assign dummy shader
     }
 
     const auto& draw_call = mesh.draw_call_descriptors[submesh];
@@ -1269,15 +2246,20 @@ void app::draw_mesh(const glm::vec3& world_camera_location, const mesh& mesh,
       glDisable(GL_CULL_FACE);
     }
 
-    perform_draw_call(draw_call);
+    if (nb_instances > 0)
+      perform_instanced_draw_call(draw_call, nb_instances);
+    else
+      perform_draw_call(draw_call);
   }
 }
 
 void app::draw_scene_recur(const glm::vec3& world_camera_location,
                            gltf_node& node,
-                           std::vector<defered_draw>& alpha_models) {
+                           std::vector<defered_draw>& alpha_models,
+                           instanced_draws& instanced_models) {
   for (auto child : node.children)
-    draw_scene_recur(world_camera_location, *child, alpha_models);
+    draw_scene_recur(world_camera_location, *child, alpha_models,
+                     instanced_models);
 
   if (node.type == gltf_node::node_type::mesh) {
     auto& mesh = loaded_meshes[size_t(node.gltf_mesh_id)];
@@ -1293,19 +2275,82 @@ void app::draw_scene_recur(const glm::vec3& world_camera_location,
       }
     }
 
-    if (!defer) {
+    if (defer) {
+      alpha_models.push_back(node.get_ptr());
+    } else if (!mesh.skinned && mesh.nb_morph_targets == 0) {
+      if (mesh.displayed) {
+        const auto owner = mesh.shares_gpu_geometry
+                               ? size_t(mesh.geometry_source)
+                               : size_t(node.gltf_mesh_id);
+        instanced_models[owner].push_back(node.get_ptr());
+      }
+    } else {
       const glm::mat3 normal_matrix =
           glm::transpose(glm::inverse(node.world_xform));
       draw_mesh(world_camera_location, mesh, normal_matrix, node.world_xform);
-    } else {
-      alpha_models.push_back(node.get_ptr());
     }
   }
 }
 
 void app::draw_scene(const glm::vec3& world_camera_location) {
+  // Everything that doesn't change from a draw to the next is sent once
+  frame_uniforms frame;
+  frame.highlight_color = gltf_insight::configuration::highlight_color;
+  frame.camera_position = world_camera_location;
+  frame.use_ibl = editor_light.use_ibl ? GL_TRUE : GL_FALSE;
+  frame.light_direction = editor_light.get_directional_light_direction();
+  frame.dual_quaternion_skinning =
+      skinning == skinning_method::dual_quaternion ? GL_TRUE : GL_FALSE;
+  frame.light_color = editor_light.color;
+  frame.padding_1 = 0.f;
+  glBindBuffer(GL_UNIFORM_BUFFER, frame_UBO);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof frame, &frame);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, GLuint(uniform_block::frame), frame_UBO);
+
+  skinning_palette.clear();
+  for (auto& mesh : loaded_meshes) {
+    if (!mesh.skinned || mesh.joint_matrices.empty()) continue;
+    mesh.joint_palette_offset =
+        skinning == skinning_method::dual_quaternion
+            ? skinning_palette.append_dual_quaternions(mesh.joint_matrices)
+            : skinning_palette.append(mesh.joint_matrices);
+  }
+  skinning_palette.upload();
+
   std::vector<defered_draw> alpha;
-  draw_scene_recur(world_camera_location, gltf_scene_tree, alpha);
+  instanced_draws instanced;
+  draw_scene_recur(world_camera_location, gltf_scene_tree, alpha, instanced);
+
+  // Static meshes are drawn once per submesh for all the nodes that share
+  // their geometry
+  for (const auto& draw : instanced) {
+    if (draw.second.size() == 1) {
+      const auto node = draw.second.front();
+      const glm::mat3 normal_matrix =
+          glm::transpose(glm::inverse(node->world_xform));
+      draw_mesh(world_camera_location,
+                loaded_meshes[size_t(node->gltf_mesh_id)], normal_matrix,
+                node->world_xform);
+      continue;
+    }
+
+    instance_transforms.clear();
+    for (const auto node : draw.second)
+      instance_transforms.push_back(
+          {node->world_xform,
+           glm::mat3(glm::transpose(glm::inverse(node->world_xform)))});
+    glBindBuffer(GL_ARRAY_BUFFER, instance_VBO);
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        GLsizeiptr(instance_transforms.size() * sizeof(instance_transform)),
+        instance_transforms.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    draw_mesh(world_camera_location, loaded_meshes[draw.first],
+              glm::mat3(1.f), glm::mat4(1.f),
+              GLsizei(instance_transforms.size()));
+  }
 
   if (!alpha.empty()) {
     {
@@ -1343,19 +2388,20 @@ void app::draw_color_select_map_recur(gltf_node& node) {
     for (size_t i = 0; i < mesh.draw_call_descriptors.size(); ++i) {
       const glm::vec4 id_color = mesh.submesh_selection_ids[i];
 
-      update_uniforms(*mesh.shader_list, editor_light.use_ibl,
-                      glm::vec3(0, 0, 0), editor_light.color,
-                      editor_light.get_directional_light_direction(),
-                      active_joint_index_model, "debug_color",
-                      projection_matrix * view_matrix * node.world_xform,
+      update_uniforms(*mesh.shader_list, active_joint_index_model,
+                      shader_id::debug_color, node.world_xform,
                       projection_matrix * view_matrix * node.world_xform,
                       glm::inverse(glm::transpose(node.world_xform)),
-                      mesh.joint_matrices, active_poly_indices);
+                      mesh.joint_palette_offset, active_poly_indices);
 
-      const auto& color_shader = (*mesh.shader_list)["debug_color"];
+      const auto& color_shader = (*mesh.shader_list)[shader_id::debug_color];
       color_shader.use();
+      // The shader selector can leave this program set up for instanced
+      // draws, the selection map draws each node on its own
+      color_shader.set_uniform(uniform_id::instanced, 0);
       color_shader.set_uniform(
-          "debug_color", glm::vec4(id_color.r, id_color.g, id_color.b, 1));
+          uniform_id::debug_color,
+          glm::vec4(id_color.r, id_color.g, id_color.b, 1));
 
       perform_draw_call(mesh.draw_call_descriptors[i]);
     }
@@ -1454,16 +2500,26 @@ void app::get_submesh_below_mouse_cursor(bool& clicked_on_submesh,
   }
 }
 
+const mesh& app::cpu_geometry(size_t index) {
+  const auto& a_mesh = loaded_meshes[index];
+  auto& holder = a_mesh.shares_cpu_geometry
+                     ? loaded_meshes[size_t(a_mesh.geometry_source)]
+                     : loaded_meshes[index];
+  holder.ensure_cpu_geometry();
+  return holder;
+}
+
 void app::get_vertex_below_mouse_cursor(size_t mesh_id, size_t submesh_id) {
   // std::cout << "clicked on " << mesh_id << ":" << submesh_id << "\n";
   const auto& mesh = loaded_meshes[mesh_id];
+  const auto& geometry = cpu_geometry(mesh_id);
 
   auto node = gltf_scene_tree.get_node_with_index(mesh.instance.node);
   if (node) {
     const auto world_xform = node->world_xform;
     // std::cout << mesh.name << std::endl;
 
-    if (mesh.raycast_submesh_camera_mouse(
+    if (geometry.raycast_submesh_camera_mouse(
             world_xform, submesh_id, world_camera_position,
             projection_matrix * view_matrix,
             float(gui_parameters.last_mouse_x) / float(display_w),
@@ -1475,15 +2531,15 @@ void app::get_vertex_below_mouse_cursor(size_t mesh_id, size_t submesh_id) {
 }
 
 void app::check_current_active_selection_valid(bool& current_selection_valid) {
-  if (active_mesh_index >= 0 && active_mesh_index < int(loaded_meshes.size()))
+  if (active_mesh_index >= 0 && active_mesh_index < int(loaded_meshes.size())) {
+    const auto& geometry = cpu_geometry(size_t(active_mesh_index));
     if (active_submesh_index >= 0 &&
-        active_submesh_index <
-            int(loaded_meshes[size_t(active_mesh_index)].positions.size()))
+        active_submesh_index < int(geometry.positions.size()))
       if (active_vertex_index >= 0 &&
-          active_vertex_index < int(loaded_meshes[size_t(active_mesh_index)]
-                                        .indices[size_t(active_submesh_index)]
-                                        .size()))
+          active_vertex_index <
+              int(geometry.indices[size_t(active_submesh_index)].size()))
         current_selection_valid = true;
+  }
 }
 
 void app::handle_click_on_geometry() {
@@ -1511,13 +2567,15 @@ void app::handle_click_on_geometry() {
 }
 
 void app::handle_current_selection() {
-  // Get the mesh
+  // Get the mesh, and the one holding its vertices
   auto& mesh = loaded_meshes[size_t(active_mesh_index)];
+  const auto& geometry = cpu_geometry(size_t(active_mesh_index));
 
   // Get the vertex buffer
   const auto& vertex_buffer =
-      mesh.skinned ? mesh.soft_skinned_position[size_t(active_submesh_index)]
-                   : mesh.display_position[size_t(active_submesh_index)];
+      geometry.skinned
+          ? geometry.soft_skinned_position[size_t(active_submesh_index)]
+          : geometry.display_position[size_t(active_submesh_index)];
 
   // Get the world matrix
   const auto node = gltf_scene_tree.get_node_with_index(mesh.instance.node);
@@ -1526,9 +2584,9 @@ void app::handle_current_selection() {
       projection_matrix * view_matrix * world_xform;
 
   // Configure shader
-  shader& shader = (*mesh.shader_list)["debug_color"];
+  const shader& shader = (*mesh.shader_list)[shader_id::debug_color];
   shader.use();
-  shader.set_uniform("mvp", model_view_projection);
+  shader.set_uniform(uniform_id::mvp, model_view_projection);
 
   if (ImGui::Begin("Selection Manipulation")) {
     ImGui::Text("Active face indices [%d, %d, %d]", int(active_poly_indices.x),
@@ -1542,16 +2600,16 @@ void app::handle_current_selection() {
         glm::make_vec3(&vertex_buffer[3 * size_t(active_vertex_index)]);
 
     glm::vec3 active_model_position =
-        glm::make_vec3(&mesh.positions[size_t(active_submesh_index)]
-                                      [3 * size_t(active_vertex_index)]);
+        glm::make_vec3(&geometry.positions[size_t(active_submesh_index)]
+                                          [3 * size_t(active_vertex_index)]);
     glDisable(GL_DEPTH_TEST);
     draw_point(active_vertex_position, configuration::vertex_highlight_size,
                shader.get_program(), configuration::highlight_color);
     glEnable(GL_DEPTH_TEST);
 
     glm::vec3 active_vertex_normal =
-        glm::make_vec3(&mesh.normals[size_t(active_submesh_index)]
-                                    [3 * size_t(active_vertex_index)]);
+        glm::make_vec3(&geometry.normals[size_t(active_submesh_index)]
+                                        [3 * size_t(active_vertex_index)]);
 
     ImGui::Text("Vertex Coordinates (%f, %f, %f)", active_model_position.x,
                 active_model_position.y, active_model_position.z);
@@ -1559,11 +2617,11 @@ void app::handle_current_selection() {
                 active_vertex_normal.y, active_vertex_normal.z);
 
     // Mesh uv are optional
-    if (mesh.uvs.size() > 0 &&
-        mesh.uvs[size_t(active_submesh_index)].size() > 0) {
+    if (geometry.uvs.size() > 0 &&
+        geometry.uvs[size_t(active_submesh_index)].size() > 0) {
       glm::vec2 active_vertex_uv =
-          glm::make_vec2(&mesh.uvs[size_t(active_submesh_index)]
-                                  [2 * size_t(active_vertex_index)]);
+          glm::make_vec2(&geometry.uvs[size_t(active_submesh_index)]
+                                      [2 * size_t(active_vertex_index)]);
       ImGui::Text("Vertex UV (%f, %f)", active_vertex_uv.x, active_vertex_uv.y);
     }
 
@@ -1621,8 +2679,9 @@ void app::handle_current_selection() {
       }
 
       if (changed) {
-        gpu_update_submesh_skinning_data(size_t(active_submesh_index),
-                                         mesh.weights, mesh.joints, mesh.VBOs);
+        gpu_update_submesh_skinning_data(
+            size_t(active_submesh_index), size_t(active_vertex_index),
+            mesh.weights, mesh.joints, mesh.draw_call_descriptors, mesh.VBOs);
       }
     }
   }
@@ -1705,8 +2764,9 @@ void app::perform_skinning_and_morphing(bool gpu_geometry_buffers_dirty,
     if (gltf_scene_tree.pose.blend_weights.size() > 0)
       perform_software_morphing(
           gltf_scene_tree, submesh, a_mesh.morph_targets, a_mesh.positions,
-          a_mesh.normals, a_mesh.display_position, a_mesh.display_normals,
-          a_mesh.VBOs, a_mesh.skinned ? !do_soft_skinning : true);
+          a_mesh.normals, a_mesh.tangents, a_mesh.display_position,
+          a_mesh.display_normals, a_mesh.display_tangents, a_mesh.VBOs,
+          a_mesh.skinned ? !do_soft_skinning : true);
 
     // do not upload to GPU if soft skin is on
 
@@ -1714,14 +2774,17 @@ void app::perform_skinning_and_morphing(bool gpu_geometry_buffers_dirty,
       if (do_soft_skinning) {
         perform_software_skinning(
             submesh, a_mesh.joint_matrices, a_mesh.display_position,
-            a_mesh.display_normals, a_mesh.joints, a_mesh.weights,
-            a_mesh.soft_skinned_position, a_mesh.soft_skinned_normals);
+            a_mesh.display_normals, a_mesh.display_tangents, a_mesh.joints,
+            a_mesh.weights, a_mesh.soft_skinned_position,
+            a_mesh.soft_skinned_normals, a_mesh.soft_skinned_tangents);
         // now, upload new mesh to GPU
         gpu_update_submesh_buffers(submesh, a_mesh.soft_skinned_position,
-                                   a_mesh.soft_skinned_normals, a_mesh.VBOs);
+                                   a_mesh.soft_skinned_normals,
+                                   a_mesh.soft_skinned_tangents, a_mesh.VBOs);
       } else if (gpu_geometry_buffers_dirty) {
         gpu_update_submesh_buffers(submesh, a_mesh.display_position,
-                                   a_mesh.display_normals, a_mesh.VBOs);
+                                   a_mesh.display_normals,
+                                   a_mesh.display_tangents, a_mesh.VBOs);
       }
     }
   }
@@ -1737,6 +2800,16 @@ void app::soft_skinning_controls(bool& gpu_geometry_buffers_dirty) {
       gpu_geometry_buffers_dirty = true;
     }
   }
+
+  ImGui::Text("Skinning:");
+  ImGui::SameLine();
+  if (ImGui::RadioButton("Linear blend",
+                         skinning == skinning_method::linear_blend))
+    skinning = skinning_method::linear_blend;
+  ImGui::SameLine();
+  if (ImGui::RadioButton("Dual quaternion",
+                         skinning == skinning_method::dual_quaternion))
+    skinning = skinning_method::dual_quaternion;
 }
 
 void app::mouse_ray_debug_control() {
@@ -1745,9 +2818,10 @@ void app::mouse_ray_debug_control() {
     ImGui::InputFloat3("debug_start", glm::value_ptr(debug_start));
     ImGui::InputFloat3("debug_stop", glm::value_ptr(debug_stop));
 
-    auto& program = loaded_meshes[0].shader_list->operator[]("debug_color");
+    const auto& program =
+        (*loaded_meshes[0].shader_list)[shader_id::debug_color];
     program.use();
-    program.set_uniform("mvp", projection_matrix * view_matrix);
+    program.set_uniform(uniform_id::mvp, projection_matrix * view_matrix);
     draw_line(program.get_program(), debug_start, debug_stop,
               glm::vec4(1, 0, 0, 1), 5);
   }
@@ -1806,32 +2880,14 @@ bool app::main_loop_frame() {
       std::string _filename;
       if (show_file_dialog("Open glTF...", "gltf,glb;vrm", &_filename)) {
         std::cout << "Input filename = " << _filename << "\n";
-
-        unload();
-        input_filename = _filename;
-
-        try {
-          load();
-        } catch (const std::exception& e) {
-          std::cerr << "error occured during loading of " << input_filename
-                    << ": " << e.what() << '\n';
-          unload();
-        }
+        start_loading(_filename);
       }
       open_file_dialog = false;
 #else
       if (ImGuiFileDialog::Instance()->FileDialog(
               "Open glTF...", ".gltf\0.glb\0.vrm\0.*\0\0")) {
         if (ImGuiFileDialog::Instance()->IsOk) {
-          unload();
-          input_filename = ImGuiFileDialog::Instance()->GetFilepathName();
-          try {
-            load();
-          } catch (const std::exception& e) {
-            std::cerr << "error occured during loading of " << input_filename
-                      << ": " << e.what() << '\n';
-            unload();
-          }
+          start_loading(ImGuiFileDialog::Instance()->GetFilepathName());
         } else {
         }
         open_file_dialog = false;
@@ -1880,6 +2936,10 @@ bool app::main_loop_frame() {
 #endif
     }
 
+    // Swap in a background load that finished since the last frame
+    poll_background_load();
+    background_load_ui();
+
     configuration::show_editor_configuration_window();
     camera_parameters_window(fovy, z_far, &show_camera_parameter_window);
 
@@ -1893,11 +2953,14 @@ bool app::main_loop_frame() {
       morph_target_window(gltf_scene_tree,
                           loaded_meshes.front().nb_morph_targets,
                           &show_morph_target_window);
-      shader_selector_window(shader_names, selected_shader, shader_to_use,
+      shader_selector_window(shader_names, selected_shader,
                              reinterpret_cast<int&>(current_display_mode),
                              &show_shader_selector_window);
-      material_info_window(dummy_material, loaded_material,
-                           &show_material_window);
+      if (current_display_mode != display_mode::normal)
+        shader_to_use = shader_id(selected_shader);
+      if (material_info_window(dummy_material, loaded_material,
+                               &show_material_window))
+        material_blocks.upload(loaded_material);
       bone_display_window(&show_bone_display_window);
 
       editor_light.show_control();
@@ -1925,6 +2988,13 @@ bool app::main_loop_frame() {
     // 3D rendering
     gl_new_frame(window, viewport_background_color, display_w, display_h);
 
+    // Decode what the visible materials use, then stream pending texture data
+    // within this frame's budget
+    if (asset_loaded) request_visible_textures();
+    texture_stream.update(texture_uploads);
+    texture_uploads.upload(
+        size_t(configuration::texture_upload_budget_mib) << 20);
+
     update_rendering_matrices();
     bool gpu_geometry_buffers_dirty = false;
     soft_skinning_controls(gpu_geometry_buffers_dirty);
@@ -1994,6 +3064,87 @@ void app::parse_command_line(int argc, char** argv) {
       .dest("input")
       .help("Input glTF filename")
       .metavar("FILE");
+  parser.add_option("--load-threads")
+      .dest("load_threads")
+      .type("int")
+      .set_default("0")
+      .help("Number of threads used to decode meshes and images (0 = one per "
+            "core)")
+      .metavar("N");
+  parser.add_option("--mmap")
+      .action("store_true")
+      .dest("mmap")
+      .help("Map binary glTF files (.glb, .vrm) in memory instead of copying "
+            "their content");
+  parser.add_option("--interleaved-vertices")
+      .action("store_true")
+      .dest("interleaved_vertices")
+      .help("Upload the vertices of each submesh as two interleaved buffers, "
+            "one for the attributes deformed on the CPU and one for the "
+            "others, instead of one buffer per attribute");
+  parser.add_option("--texture-cache")
+      .dest("texture_cache")
+      .help("Directory where decoded textures are cached (default: the user "
+            "cache directory)")
+      .metavar("DIR");
+  parser.add_option("--no-texture-cache")
+      .action("store_true")
+      .dest("no_texture_cache")
+      .help("Always decode the textures, without reading or writing the "
+            "cache");
+  parser.add_option("--scene-cache")
+      .dest("scene_cache")
+      .help("Directory where processed scenes are cached (default: the user "
+            "cache directory)")
+      .metavar("DIR");
+  parser.add_option("--no-scene-cache")
+      .action("store_true")
+      .dest("no_scene_cache")
+      .help("Always decode the meshes, without reading or writing the cache");
+  parser.add_option("--shader-cache")
+      .dest("shader_cache")
+      .help("Directory where linked shader programs are cached (default: the "
+            "user cache directory)")
+      .metavar("DIR");
+  parser.add_option("--no-shader-cache")
+      .action("store_true")
+      .dest("no_shader_cache")
+      .help("Always compile the shaders, without reading or writing the "
+            "cache");
+  parser.add_option("--benchmark-uniforms")
+      .dest("benchmark_uniforms")
+      .type("int")
+      .set_default("0")
+      .help("Once the file is loaded, time N per draw uniform updates looked "
+            "up by name and by id")
+      .metavar("N");
+  parser.add_option("--dual-quaternion-skinning")
+      .action("store_true")
+      .dest("dual_quaternion_skinning")
+      .help("Blend the joints as dual quaternions instead of matrices");
+  parser.add_option("--benchmark-skinning")
+      .dest("benchmark_skinning")
+      .type("int")
+      .set_default("0")
+      .help("With --headless, time N rounds of CPU skinning of the posed "
+            "scene with linear blend and dual quaternion skinning")
+      .metavar("N");
+  parser.add_option("--benchmark-load")
+      .action("store_true")
+      .dest("benchmark_load")
+      .help("With --headless, load the input file again on one thread and on "
+            "--load-threads, and report the speedup");
+  parser.add_option("--headless")
+      .action("store_true")
+      .dest("headless")
+      .help(
+          "Load and evaluate the input file without opening a window, then "
+          "print a JSON summary on stdout");
+  parser.add_option("--decode-images")
+      .action("store_true")
+      .dest("decode_images")
+      .help("With --headless, fully decode every image instead of only "
+            "checking its header");
   parser.add_option("-h", "--help")
       .action("store_true")
       .dest("help")
@@ -2011,6 +3162,73 @@ void app::parse_command_line(int argc, char** argv) {
     debug_output = true;
   }
 
+  headless = false;
+  if (options.get("headless")) {
+    headless = true;
+  }
+
+  headless_image_decoding = false;
+  if (options.get("decode_images")) {
+    headless_image_decoding = true;
+  }
+
+  use_mmap = false;
+  if (options.get("mmap")) {
+    use_mmap = true;
+  }
+
+  mesh_vertex_layout = vertex_layout::separate;
+  if (options.get("interleaved_vertices")) {
+    mesh_vertex_layout = vertex_layout::interleaved;
+  }
+
+  texture_cache_directory.clear();
+  if (options.get("no_texture_cache")) {
+    use_texture_cache = false;
+  } else {
+    use_texture_cache = true;
+    if (options.is_set("texture_cache"))
+      texture_cache_directory = options["texture_cache"];
+  }
+
+  scene_cache_directory.clear();
+  if (options.get("no_scene_cache")) {
+    use_scene_cache = false;
+  } else {
+    use_scene_cache = true;
+    if (options.is_set("scene_cache"))
+      scene_cache_directory = options["scene_cache"];
+  }
+
+  shader_cache_directory.clear();
+  if (options.get("no_shader_cache")) {
+    use_shader_cache = false;
+  } else {
+    use_shader_cache = true;
+    if (options.is_set("shader_cache"))
+      shader_cache_directory = options["shader_cache"];
+  }
+
+  const int nb_benchmark_draws = options.get("benchmark_uniforms");
+  uniform_benchmark_iterations =
+      nb_benchmark_draws > 0 ? size_t(nb_benchmark_draws) : 0;
+
+  skinning = skinning_method::linear_blend;
+  if (options.get("dual_quaternion_skinning")) {
+    skinning = skinning_method::dual_quaternion;
+  }
+
+  const int nb_skinning_rounds = options.get("benchmark_skinning");
+  skinning_benchmark_iterations =
+      nb_skinning_rounds > 0 ? size_t(nb_skinning_rounds) : 0;
+
+  if (options.get("benchmark_load")) {
+    load_benchmark_enabled = true;
+  }
+
+  const int nb_load_threads = options.get("load_threads");
+  load_threads = nb_load_threads > 0 ? size_t(nb_load_threads) : 0;
+
   if (options.is_set("input")) {
     input_filename = options["input"];
   } else if (args.size() > 0) {
@@ -2022,22 +3240,177 @@ void app::parse_command_line(int argc, char** argv) {
 #endif
 }
 
-void app::load_glTF_asset() {
+static const char* const empty_data_uri =
+    "data:application/octet-stream;base64,";
+
+static std::string base_directory(const std::string& filename) {
+  const auto separator = filename.find_last_of("/\\");
+  return separator != std::string::npos ? filename.substr(0, separator)
+                                        : std::string();
+}
+
+// EXT_meshopt_compression fallback buffers have no uri, all their bufferViews
+// are compressed and decoded at load time. tinygltf rejects buffers without a
+// uri outside of the BIN chunk, these get an empty data uri while parsing,
+// that `clear_fallback_uris` removes afterwards. Buffers before
+// `first_buffer` are left alone. Returns the indices of the buffers changed
+static std::vector<int> mark_fallback_buffers(nlohmann::json& document,
+                                              size_t first_buffer) {
+  std::vector<int> fallback_buffers;
+  auto buffers = document.find("buffers");
+  if (buffers == document.end() || !buffers->is_array()) return {};
+
+  for (size_t i = first_buffer; i < buffers->size(); ++i) {
+    auto& buffer = (*buffers)[i];
+    if (!buffer.is_object() || buffer.find("uri") != buffer.end()) continue;
+    const auto extensions = buffer.find("extensions");
+    if (extensions == buffer.end() || !extensions->is_object()) continue;
+    const auto meshopt = extensions->find("EXT_meshopt_compression");
+    if (meshopt == extensions->end() || !meshopt->is_object()) continue;
+    const auto fallback = meshopt->find("fallback");
+    if (fallback == meshopt->end() || !fallback->is_boolean() ||
+        !fallback->get<bool>())
+      continue;
+
+    buffer["uri"] = empty_data_uri;
+    buffer["byteLength"] = 0;
+    fallback_buffers.push_back(int(i));
+  }
+  return fallback_buffers;
+}
+
+static void clear_fallback_uris(tinygltf::Model& model,
+                                const std::vector<int>& fallback_buffers) {
+  for (const auto buffer : fallback_buffers)
+    model.buffers[size_t(buffer)].uri.clear();
+}
+
+// Only files that use EXT_meshopt_compression can have fallback buffers, the
+// others are parsed once
+static bool may_have_fallback_buffers(const char* json, size_t size) {
+  static const std::string name = "EXT_meshopt_compression";
+  return std::search(json, json + size, name.begin(), name.end()) !=
+         json + size;
+}
+
+static bool load_ascii_gltf(tinygltf::TinyGLTF& gltf_ctx,
+                            const std::string& filename,
+                            tinygltf::Model& asset_model, std::string& err,
+                            std::string& warn) {
+  std::vector<unsigned char> bytes;
+  if (!tinygltf::ReadWholeFile(&bytes, &err, filename, nullptr)) return false;
+  std::string json(bytes.begin(), bytes.end());
+  bytes = std::vector<unsigned char>();
+
+  std::vector<int> fallback_buffers;
+  if (may_have_fallback_buffers(json.data(), json.size())) {
+    nlohmann::json document;
+    try {
+      document = nlohmann::json::parse(json);
+    } catch (const std::exception& e) {
+      err = std::string("Cannot parse ") + filename + ": " + e.what();
+      return false;
+    }
+    fallback_buffers = mark_fallback_buffers(document, 0);
+    if (!fallback_buffers.empty()) json = document.dump();
+  }
+
+  if (!gltf_ctx.LoadASCIIFromString(&asset_model, &err, &warn, json.c_str(),
+                                    static_cast<unsigned int>(json.size()),
+                                    base_directory(filename)))
+    return false;
+  clear_fallback_uris(asset_model, fallback_buffers);
+  return true;
+}
+
+static bool load_glb(tinygltf::TinyGLTF& gltf_ctx, const std::string& filename,
+                     tinygltf::Model& asset_model, std::string& err,
+                     std::string& warn) {
+  std::vector<unsigned char> bytes;
+  if (!tinygltf::ReadWholeFile(&bytes, &err, filename, nullptr)) return false;
+
+  // The JSON chunk follows the 12 bytes of header and its own 8 bytes of
+  // chunk header. When fallback buffers have to be marked, the file is
+  // rebuilt around the new JSON chunk. Malformed files are left to tinygltf
+  const auto read_u32 = [&](size_t offset) {
+    uint32_t value = 0;
+    std::memcpy(&value, bytes.data() + offset, sizeof value);
+    return value;
+  };
+  const size_t header_size = 12, json_start = 20;
+  const size_t json_size =
+      bytes.size() >= json_start ? read_u32(header_size) : 0;
+  std::vector<int> fallback_buffers;
+  if (json_size > 0 && json_size <= bytes.size() - json_start) {
+    const auto* json = reinterpret_cast<const char*>(bytes.data()) + json_start;
+    if (may_have_fallback_buffers(json, json_size)) {
+      nlohmann::json document;
+      try {
+        document = nlohmann::json::parse(json, json + json_size);
+      } catch (const std::exception& e) {
+        err = std::string("Cannot parse the JSON chunk: ") + e.what();
+        return false;
+      }
+      // A first buffer without uri is the BIN chunk
+      fallback_buffers = mark_fallback_buffers(document, 1);
+      if (!fallback_buffers.empty()) {
+        auto new_json = document.dump();
+        // Chunks are aligned on 4 bytes, padded with spaces for JSON
+        new_json.resize((new_json.size() + 3) & ~size_t(3), ' ');
+
+        std::vector<unsigned char> rebuilt(
+            bytes.begin(), bytes.begin() + std::ptrdiff_t(json_start));
+        rebuilt.insert(rebuilt.end(), new_json.begin(), new_json.end());
+        rebuilt.insert(rebuilt.end(),
+                       bytes.begin() + std::ptrdiff_t(json_start + json_size),
+                       bytes.end());
+        const auto write_u32 = [&](size_t offset, size_t value) {
+          const auto value_u32 = uint32_t(value);
+          std::memcpy(rebuilt.data() + offset, &value_u32, sizeof value_u32);
+        };
+        write_u32(8, rebuilt.size());
+        write_u32(header_size, new_json.size());
+        bytes.swap(rebuilt);
+      }
+    }
+  }
+
+  if (!gltf_ctx.LoadBinaryFromMemory(&asset_model, &err, &warn, bytes.data(),
+                                     static_cast<unsigned int>(bytes.size()),
+                                     base_directory(filename)))
+    return false;
+  clear_fallback_uris(asset_model, fallback_buffers);
+  return true;
+}
+
+void app::load_glTF_asset(const std::string& filename,
+                          tinygltf::Model& asset_model,
+                          gltf_insight::buffer_data::overrides& buffers,
+                          image_decode_report& report,
+                          std::vector<encoded_image>* deferred_images) const {
+  // TinyGLTF keeps state while parsing, each load gets its own
+  tinygltf::TinyGLTF gltf_ctx;
+
+  // Images are only collected while parsing, and decoded afterwards
+  deferred_image_decoder image_decoder;
+  image_decoder.install(gltf_ctx);
   std::string err;
   std::string warn;
-  const std::string ext = GetFilePathExtension(input_filename);
+  const std::string ext = GetFilePathExtension(filename);
 
   bool ret = false;
   if (ext.compare("glb") == 0 || ext.compare("vrm") == 0) {
     std::cout << "Reading binary glTF" << std::endl;
     // assume binary glTF.
-    ret = gltf_ctx.LoadBinaryFromFile(&model, &err, &warn,
-                                      input_filename.c_str());
+    if (use_mmap)
+      ret = load_mapped_glb(gltf_ctx, filename, asset_model, buffers, err,
+                            warn);
+    else
+      ret = load_glb(gltf_ctx, filename, asset_model, err, warn);
   } else {
     std::cout << "Reading ASCII glTF" << std::endl;
     // assume ascii glTF.
-    ret =
-        gltf_ctx.LoadASCIIFromFile(&model, &err, &warn, input_filename.c_str());
+    ret = load_ascii_gltf(gltf_ctx, filename, asset_model, err, warn);
   }
 
   if (!ret) {
@@ -2046,26 +3419,332 @@ void app::load_glTF_asset() {
 
     throw std::runtime_error("error: " + err);
   }
+
+  check_required_extensions(asset_model);
+
+  if (deferred_images) {
+    *deferred_images = image_decoder.take_encoded_images();
+    report = image_decode_report();
+    report.nb_images = deferred_images->size();
+    return;
+  }
+
+  // Nothing is drawn headless, the pixels are only needed to check that the
+  // images decode, which can take seconds on texture heavy assets
+  if (headless && !headless_image_decoding) {
+    report = image_decoder.check_all();
+    return;
+  }
+
+  report = image_decoder.decode_all(asset_model, load_threads);
+  for (const auto& timing : report.images)
+    std::cerr << "Image " << timing.image << " (" << timing.name
+              << ") decoded in " << timing.ms << "ms\n";
+  std::cerr << "Decoded " << report.nb_images << " images in "
+            << report.decode_wall_ms << "ms on " << report.nb_threads
+            << " threads (" << report.decode_cpu_ms << "ms of work, overlap x"
+            << report.work_overlap() << ")\n";
+}
+
+// Images of a GLB stored in its BIN chunk, served to tinygltf as files named
+// `mapped_image_prefix` + image index through its file system callbacks
+struct mapped_glb_images {
+  const os_utils::mapped_file* file = nullptr;
+  std::map<std::string, std::pair<size_t, size_t>> ranges;
+};
+
+static const char* const mapped_image_prefix = "gltf-insight-mapped-image-";
+
+static const std::pair<size_t, size_t>* find_mapped_image(
+    const std::string& path, void* user_data) {
+  const auto* images = static_cast<const mapped_glb_images*>(user_data);
+  const auto separator = path.find_last_of("/\\");
+  const auto name =
+      separator != std::string::npos ? path.substr(separator + 1) : path;
+  const auto found = images->ranges.find(name);
+  return found != images->ranges.end() ? &found->second : nullptr;
+}
+
+static bool mapped_image_exists(const std::string& path, void* user_data) {
+  return find_mapped_image(path, user_data) ||
+         tinygltf::FileExists(path, nullptr);
+}
+
+static bool read_mapped_image(std::vector<unsigned char>* out,
+                              std::string* err, const std::string& path,
+                              void* user_data) {
+  const auto* range = find_mapped_image(path, user_data);
+  if (!range) return tinygltf::ReadWholeFile(out, err, path, nullptr);
+
+  const auto* images = static_cast<const mapped_glb_images*>(user_data);
+  const auto* begin = images->file->data() + range->first;
+  out->assign(begin, begin + range->second);
+  return true;
+}
+
+bool app::load_mapped_glb(tinygltf::TinyGLTF& gltf_ctx,
+                          const std::string& filename,
+                          tinygltf::Model& asset_model,
+                          gltf_insight::buffer_data::overrides& buffers,
+                          std::string& err, std::string& warn) const {
+  auto file = std::make_shared<os_utils::mapped_file>();
+  if (!file->open(filename)) {
+    err = "Cannot open " + filename;
+    return false;
+  }
+
+  const auto read_u32 = [&](size_t offset) {
+    uint32_t value = 0;
+    std::memcpy(&value, file->data() + offset, sizeof value);
+    return value;
+  };
+
+  // 12 bytes of header, then chunks made of their length, their type and
+  // their data. The JSON chunk comes first, then the optional BIN chunk
+  const size_t header_size = 12, chunk_header_size = 8;
+  const uint32_t glb_magic = 0x46546C67;  // "glTF"
+  const uint32_t json_type = 0x4E4F534A;  // "JSON"
+  const uint32_t bin_type = 0x004E4942;   // "BIN\0"
+  if (file->size() < header_size + chunk_header_size ||
+      read_u32(0) != glb_magic || read_u32(4) != 2) {
+    err = filename + " is not a glTF 2.0 binary file";
+    return false;
+  }
+
+  const size_t json_size = read_u32(header_size);
+  const size_t json_start = header_size + chunk_header_size;
+  if (read_u32(header_size + 4) != json_type ||
+      json_size > file->size() - json_start) {
+    err = filename + " has no valid JSON chunk";
+    return false;
+  }
+
+  const unsigned char* bin_chunk = nullptr;
+  size_t bin_chunk_size = 0;
+  const size_t bin_header = json_start + json_size;
+  if (bin_header + chunk_header_size <= file->size() &&
+      read_u32(bin_header + 4) == bin_type) {
+    bin_chunk = file->data() + bin_header + chunk_header_size;
+    bin_chunk_size = std::min(size_t(read_u32(bin_header)),
+                              file->size() - bin_header - chunk_header_size);
+  }
+
+  // tinygltf copies the BIN chunk of the GLB files it parses, which is most of
+  // the file. It only gets the JSON chunk instead, as a glTF file whose first
+  // buffer is empty, and the images stored in the BIN chunk are read from the
+  // mapping by the file system callbacks
+  nlohmann::json document;
+  try {
+    document = nlohmann::json::parse(file->data() + json_start,
+                                     file->data() + json_start + json_size);
+  } catch (const std::exception& e) {
+    err = std::string("Cannot parse the JSON chunk: ") + e.what();
+    return false;
+  }
+
+  size_t bin_buffer_size = 0;
+  bool uses_bin_chunk = false;
+  auto buffers = document.find("buffers");
+  if (buffers != document.end() && buffers->is_array() && !buffers->empty() &&
+      (*buffers)[0].is_object() &&
+      (*buffers)[0].find("uri") == (*buffers)[0].end()) {
+    auto& bin_buffer = (*buffers)[0];
+    const auto byte_length = bin_buffer.find("byteLength");
+    if (byte_length == bin_buffer.end() || !byte_length->is_number_unsigned()) {
+      err = "The BIN chunk buffer has no valid byteLength";
+      return false;
+    }
+    bin_buffer_size = byte_length->get<size_t>();
+    if (!bin_chunk || bin_buffer_size > bin_chunk_size) {
+      err = "The BIN chunk is smaller than its buffer";
+      return false;
+    }
+    bin_buffer["uri"] = empty_data_uri;
+    bin_buffer["byteLength"] = 0;
+    uses_bin_chunk = true;
+  }
+  const auto fallback_buffers = mark_fallback_buffers(document, 1);
+
+  mapped_glb_images images;
+  images.file = file.get();
+  std::map<size_t, int> image_buffer_views;
+  auto image_list = document.find("images");
+  const auto buffer_views = document.find("bufferViews");
+  if (uses_bin_chunk && image_list != document.end() &&
+      image_list->is_array() && buffer_views != document.end() &&
+      buffer_views->is_array()) {
+    for (size_t i = 0; i < image_list->size(); ++i) {
+      auto& image = (*image_list)[i];
+      const auto view_index = image.find("bufferView");
+      if (view_index == image.end() || !view_index->is_number_unsigned() ||
+          view_index->get<size_t>() >= buffer_views->size())
+        continue;
+
+      const auto& view = (*buffer_views)[view_index->get<size_t>()];
+      if (view.value("buffer", -1) != 0) continue;
+      const auto offset = view.value("byteOffset", size_t(0));
+      const auto length = view.value("byteLength", size_t(0));
+      if (offset > bin_buffer_size || length > bin_buffer_size - offset)
+        continue;
+
+      const auto name = mapped_image_prefix + std::to_string(i);
+      images.ranges[name] = {size_t(bin_chunk - file->data()) + offset,
+                             length};
+      image_buffer_views[i] = view_index->get<int>();
+      image.erase("bufferView");
+      image["uri"] = name;
+    }
+  }
+
+  tinygltf::FsCallbacks callbacks;
+  callbacks.FileExists = &mapped_image_exists;
+  callbacks.ExpandFilePath = &tinygltf::ExpandFilePath;
+  callbacks.ReadWholeFile = &read_mapped_image;
+  callbacks.WriteWholeFile = &tinygltf::WriteWholeFile;
+  callbacks.user_data = &images;
+  gltf_ctx.SetFsCallbacks(callbacks);
+
+  const std::string json = document.dump();
+  document = nlohmann::json();
+  if (!gltf_ctx.LoadASCIIFromString(&asset_model, &err, &warn, json.c_str(),
+                                    static_cast<unsigned int>(json.size()),
+                                    base_directory(filename)))
+    return false;
+  clear_fallback_uris(asset_model, fallback_buffers);
+
+  // Give the model back what the JSON chunk said
+  for (const auto& image : image_buffer_views) {
+    auto& loaded_image = asset_model.images[image.first];
+    loaded_image.uri.clear();
+    loaded_image.bufferView = image.second;
+  }
+
+  if (uses_bin_chunk) {
+    asset_model.buffers[0].uri.clear();
+    gltf_insight::buffer_data::external_bytes bytes;
+    bytes.data = bin_chunk;
+    bytes.size = bin_buffer_size;
+    bytes.owner = file;
+    buffers.override_buffer(0, std::move(bytes));
+  }
+
+  return true;
 }
 
-void app::load_all_textures(size_t nb_textures) {
-  glGenTextures(GLsizei(nb_textures), textures.data());
+void app::load_all_textures(size_t nb_textures,
+                            std::vector<encoded_image> images) {
+  // Images with the same file content share one texture. Kitbashed assets
+  // often embed the same file many times
+  constexpr auto no_texture = std::numeric_limits<size_t>::max();
+  std::vector<size_t> texture_of(nb_textures, no_texture);
+  std::vector<encoded_image> unique_images;
+  std::map<uint64_t, std::vector<size_t>> unique_by_hash;
+  for (auto& image : images) {
+    if (image.index < 0 || size_t(image.index) >= nb_textures) continue;
+
+    auto& candidates =
+        unique_by_hash[fnv1a_64(image.bytes.data(), image.bytes.size())];
+    const auto same = std::find_if(
+        candidates.begin(), candidates.end(), [&](size_t unique) {
+          const auto& other = unique_images[unique];
+          return other.required_width == image.required_width &&
+                 other.required_height == image.required_height &&
+                 other.bytes == image.bytes;
+        });
+    if (same != candidates.end()) {
+      texture_of[size_t(image.index)] = *same;
+      ++sharing.nb_shared_images;
+      sharing.shared_image_bytes += image.bytes.size();
+      continue;
+    }
 
-  for (size_t i = 0; i < nb_textures; ++i) {
-    glBindTexture(GL_TEXTURE_2D, textures[i]);
+    candidates.push_back(unique_images.size());
+    texture_of[size_t(image.index)] = unique_images.size();
+    image.index = int(unique_images.size());
+    unique_images.push_back(std::move(image));
+  }
 
-    // TODO handle SRGB colorspace for accurate shading.
-    glTexImage2D(GL_TEXTURE_2D, 0,
-                 model.images[i].component == 4 ? GL_RGBA : GL_RGB,
-                 model.images[i].width, model.images[i].height, 0,
-                 model.images[i].component == 4 ? GL_RGBA : GL_RGB,
-                 GL_UNSIGNED_BYTE, model.images[i].image.data());
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                    GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // Images without encoded content keep a placeholder of their own
+  size_t nb_unique = unique_images.size();
+  for (auto& texture : texture_of)
+    if (texture == no_texture) texture = nb_unique++;
+
+  std::vector<GLuint> unique_textures(nb_unique);
+  glGenTextures(GLsizei(nb_unique), unique_textures.data());
+  for (size_t i = 0; i < nb_textures; ++i)
+    textures[i] = unique_textures[texture_of[i]];
+
+  // Normal maps get a placeholder that doesn't bend the shading
+  std::vector<bool> normal_maps(nb_unique, false);
+  for (const auto& gltf_material : model.materials) {
+    const auto normal = gltf_material.additionalValues.find("normalTexture");
+    if (normal == gltf_material.additionalValues.end()) continue;
+    const auto index = normal->second.TextureIndex();
+    if (index >= 0 && size_t(index) < nb_textures)
+      normal_maps[texture_of[size_t(index)]] = true;
   }
-  glBindTexture(GL_TEXTURE_2D, 0);
+
+  // TODO handle SRGB colorspace for accurate shading.
+  texture_stream.reset(std::move(unique_images), unique_textures, normal_maps);
+}
+
+void app::request_visible_textures() {
+  for (const auto& a_mesh : loaded_meshes) {
+    if (!a_mesh.displayed) continue;
+
+    for (const int material_index : a_mesh.materials) {
+      if (material_index < 0 ||
+          size_t(material_index) >= loaded_material.size())
+        continue;
+
+      const auto& used = loaded_material[size_t(material_index)];
+      for (size_t slot = 0; slot < used.textures_used; ++slot)
+        texture_stream.request(used.texture_slots[slot]);
+    }
+  }
+}
+
+// `directory` if it is set, otherwise `name` in our part of the user cache
+// directory. Empty if there is none
+static std::string cache_location(const std::string& directory,
+                                  const char* name) {
+  if (!directory.empty()) return directory;
+
+  const auto user_cache = os_utils::cache_directory();
+  if (user_cache.empty()) return std::string();
+  os_utils::mkdir(user_cache + "/gltf-insight");
+  return user_cache + "/gltf-insight/" + name;
+}
+
+void app::open_texture_cache() {
+  const auto directory = cache_location(texture_cache_directory, "textures");
+  if (directory.empty()) return;
+
+  gltf_insight::texture_cache cache;
+  if (!cache.open(directory)) {
+    std::cerr << "Warn: can't use " << directory
+              << " as texture cache, textures will always be decoded\n";
+    return;
+  }
+  texture_stream.set_cache(std::move(cache));
+}
+
+void app::open_scene_cache() {
+  const auto directory = cache_location(scene_cache_directory, "scenes");
+  if (directory.empty()) return;
+
+  if (!processed_scene_cache.open(directory))
+    std::cerr << "Warn: can't use " << directory
+              << " as scene cache, meshes will always be decoded\n";
+}
+
+void app::open_shader_cache() {
+  const auto directory = cache_location(shader_cache_directory, "shaders");
+  if (directory.empty()) return;
+
+  if (!program_binaries.open(directory))
+    std::cerr << "Warn: can't use " << directory
+              << " as shader cache, shaders will always be compiled\n";
 }
 
 void app::generate_joint_inverse_bind_matrix_map(
@@ -2081,26 +3760,93 @@ void app::cpu_compute_morphed_display_mesh(
     const std::vector<std::vector<morph_target>>& morph_targets,
     const std::vector<std::vector<float>>& vertex_coord,
     const std::vector<std::vector<float>>& normals,
+    const std::vector<std::vector<float>>& tangents,
     std::vector<std::vector<float>>& display_position,
-    std::vector<std::vector<float>>& display_normal, size_t vertex) {
-  // Get the base vector
-  display_position[submesh_id][vertex] = vertex_coord[submesh_id][vertex];
-  display_normal[submesh_id][vertex] = normals[submesh_id][vertex];
-
-  // Accumulate the delta, v = v0 + w0 * m0 + w1 * m1 + w2 * m2 ...
-  for (size_t w = 0; w < mesh_skeleton_graph.pose.blend_weights.size(); ++w) {
-    const float weight = mesh_skeleton_graph.pose.blend_weights[w];
-    display_position[submesh_id][vertex] +=
-        weight * morph_targets[submesh_id][w].position[vertex];
-    display_normal[submesh_id][vertex] +=
-        weight * morph_targets[submesh_id][w].normal[vertex];
+    std::vector<std::vector<float>>& display_normal,
+    std::vector<std::vector<float>>& display_tangent) {
+  // Start from the base mesh
+  auto& position = display_position[submesh_id];
+  auto& normal = display_normal[submesh_id];
+  auto& tangent = display_tangent[submesh_id];
+  position = vertex_coord[submesh_id];
+  normal = normals[submesh_id];
+  tangent = tangents[submesh_id];
+
+  // Accumulate the delta, v = v0 + w0 * m0 + w1 * m1 + w2 * m2 ... Targets
+  // without weight are skipped, and sparse targets only touch the vertices
+  // they move
+  const auto& weights = mesh_skeleton_graph.pose.blend_weights;
+  const auto& targets = morph_targets[submesh_id];
+  for (size_t w = 0; w < std::min(weights.size(), targets.size()); ++w) {
+    const float weight = weights[w];
+    if (weight == 0.f) continue;
+
+    const auto& target = targets[w];
+    // Tangents have a 4th handedness component the deltas don't touch
+    const bool with_tangents =
+        !target.tangent.empty() && tangent.size() / 4 == position.size() / 3;
+    if (target.is_sparse()) {
+      for (size_t i = 0; i < target.vertices.size(); ++i) {
+        const size_t vertex = 3 * size_t(target.vertices[i]);
+        if (vertex + 3 > position.size()) continue;
+        for (size_t c = 0; c < 3; ++c) {
+          position[vertex + c] += weight * target.position[3 * i + c];
+          if (!target.normal.empty())
+            normal[vertex + c] += weight * target.normal[3 * i + c];
+          if (with_tangents)
+            tangent[4 * size_t(target.vertices[i]) + c] +=
+                weight * target.tangent[3 * i + c];
+        }
+      }
+    } else {
+      const size_t nb_positions =
+          std::min(position.size(), target.position.size());
+      for (size_t i = 0; i < nb_positions; ++i)
+        position[i] += weight * target.position[i];
+      const size_t nb_normals = std::min(normal.size(), target.normal.size());
+      for (size_t i = 0; i < nb_normals; ++i)
+        normal[i] += weight * target.normal[i];
+      if (!with_tangents) continue;
+      const size_t nb_tangents =
+          std::min(tangent.size() / 4, target.tangent.size() / 3);
+      for (size_t i = 0; i < nb_tangents; ++i)
+        for (size_t c = 0; c < 3; ++c)
+          tangent[4 * i + c] += weight * target.tangent[3 * i + c];
+    }
   }
 }
 
 void app::gpu_update_submesh_buffers(
     size_t submesh_id, std::vector<std::vector<float>>& display_position,
     std::vector<std::vector<float>>& display_normal,
+    std::vector<std::vector<float>>& display_tangent,
     std::vector<std::array<GLuint, VBO_count>>& VBOs) {
+  if (mesh_vertex_layout == vertex_layout::interleaved) {
+    // Deformed meshes are always decoded to floats, so the stream is made of
+    // position, normal and, for normal mapped submeshes, tangent
+    const auto& position = display_position[submesh_id];
+    const auto& normal = display_normal[submesh_id];
+    const auto& tangent = display_tangent[submesh_id];
+    const size_t nb_vertices = position.size() / 3;
+    const size_t stride = tangent.empty() ? 6 : 10;
+
+    dynamic_stream.resize(nb_vertices * stride);
+    for (size_t v = 0; v < nb_vertices; ++v) {
+      float* vertex = &dynamic_stream[v * stride];
+      memcpy(vertex, &position[3 * v], 3 * sizeof(float));
+      memcpy(vertex + 3, &normal[3 * v], 3 * sizeof(float));
+      if (!tangent.empty())
+        memcpy(vertex + 6, &tangent[4 * v], 4 * sizeof(float));
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh_id][VBO_stream_dynamic]);
+    glBufferData(GL_ARRAY_BUFFER,
+                 GLsizeiptr(dynamic_stream.size() * sizeof(float)),
+                 dynamic_stream.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return;
+  }
+
   // upload to GPU
   glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh_id][VBO_layout_position]);
   glBufferData(GL_ARRAY_BUFFER,
@@ -2112,29 +3858,51 @@ void app::gpu_update_submesh_buffers(
                GLsizeiptr(display_normal[submesh_id].size() * sizeof(float)),
                display_normal[submesh_id].data(), GL_DYNAMIC_DRAW);
 
-  //// TODO create #defines for these layout numbers, they are arbitrary
-  // glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh_id][TANGENT_BUFFER]);
-  // glBufferData(GL_ARRAY_BUFFER,
-  //             display_tangent[submesh_id].size() * sizeof(float),
-  //             display_tangent[submesh_id].data(), GL_DYNAMIC_DRAW);
+  // Only normal mapped submeshes have tangents
+  if (!display_tangent[submesh_id].empty()) {
+    glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh_id][VBO_layout_tangent]);
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        GLsizeiptr(display_tangent[submesh_id].size() * sizeof(float)),
+        display_tangent[submesh_id].data(), GL_DYNAMIC_DRAW);
+  }
 
   // keep state clean
   glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void app::gpu_update_submesh_skinning_data(
-    size_t submesh_id, std::vector<std::vector<float>>& weight,
+    size_t submesh_id, size_t vertex_id,
+    std::vector<std::vector<float>>& weight,
     std::vector<std::vector<unsigned short>>& joint,
+    const std::vector<draw_call_submesh_descriptor>& descriptors,
     std::vector<std::array<GLuint, VBO_count>>& VBOs) {
-  glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh_id][VBO_layout_weights]);
-  glBufferData(GL_ARRAY_BUFFER,
-               GLsizeiptr(weight[submesh_id].size() * sizeof(float)),
-               weight[submesh_id].data(), GL_DYNAMIC_DRAW);
-
-  glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh_id][VBO_layout_joints]);
-  glBufferData(GL_ARRAY_BUFFER,
-               GLsizeiptr(joint[submesh_id].size() * sizeof(float)),
-               joint[submesh_id].data(), GL_DYNAMIC_DRAW);
+  const auto* vertex_joints = &joint[submesh_id][4 * vertex_id];
+  const auto* vertex_weights = &weight[submesh_id][4 * vertex_id];
+
+  if (mesh_vertex_layout == vertex_layout::interleaved) {
+    // The static stream of skinned submeshes starts with the 4 joints and the
+    // 4 weights of each vertex
+    const auto offset =
+        GLintptr(vertex_id) * descriptors[submesh_id].static_stride;
+    glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh_id][VBO_stream_static]);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, 4 * sizeof(unsigned short),
+                    vertex_joints);
+    glBufferSubData(GL_ARRAY_BUFFER,
+                    offset + GLintptr(4 * sizeof(unsigned short)),
+                    4 * sizeof(float), vertex_weights);
+  } else {
+    glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh_id][VBO_layout_weights]);
+    glBufferSubData(GL_ARRAY_BUFFER,
+                    GLintptr(4 * vertex_id * sizeof(float)),
+                    4 * sizeof(float), vertex_weights);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBOs[submesh_id][VBO_layout_joints]);
+    glBufferSubData(GL_ARRAY_BUFFER,
+                    GLintptr(4 * vertex_id * sizeof(unsigned short)),
+                    4 * sizeof(unsigned short), vertex_joints);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void app::perform_software_morphing(
@@ -2142,8 +3910,10 @@ void app::perform_software_morphing(
     const std::vector<std::vector<morph_target>>& morph_targets,
     const std::vector<std::vector<float>>& vertex_coord,
     const std::vector<std::vector<float>>& normals,
+    const std::vector<std::vector<float>>& tangents,
     std::vector<std::vector<float>>& display_position,
     std::vector<std::vector<float>>& display_normal,
+    std::vector<std::vector<float>>& display_tangent,
     std::vector<std::array<GLuint, VBO_count>>& VBOs, bool upload_to_gpu) {
 #ifdef __clang__
 #pragma clang diagnostic push
@@ -2201,18 +3971,15 @@ void app::perform_software_morphing(
 
     // If flag is found to be dirty
     if (!clean[submesh_id]) {
-      // Blend each vertex between morph targets on the CPU:
-      for (size_t vertex = 0; vertex < display_position[submesh_id].size();
-           ++vertex) {
-        cpu_compute_morphed_display_mesh(
-            mesh_skeleton_graph, submesh_id, morph_targets, vertex_coord,
-            normals, display_position, display_normal, vertex);
-      }
+      // Blend the morph targets on the CPU:
+      cpu_compute_morphed_display_mesh(
+          mesh_skeleton_graph, submesh_id, morph_targets, vertex_coord, normals,
+          tangents, display_position, display_normal, display_tangent);
 
       // If it is necessary to upload the new mesh data to the GPU, do it:
       if (upload_to_gpu)
         gpu_update_submesh_buffers(submesh_id, display_position, display_normal,
-                                   VBOs);
+                                   display_tangent, VBOs);
     }
   }
 }
@@ -2221,15 +3988,18 @@ void app::perform_software_skinning(
     size_t submesh_id, const std::vector<glm::mat4>& joint_matrix,
     const std::vector<std::vector<float>>& positions,
     const std::vector<std::vector<float>>& normals,
+    const std::vector<std::vector<float>>& tangents,
     const std::vector<std::vector<unsigned short>>& joints,
     const std::vector<std::vector<float>>& weights,
     std::vector<std::vector<float>>& display_position,
-    std::vector<std::vector<float>>& display_normal) {
+    std::vector<std::vector<float>>& display_normal,
+    std::vector<std::vector<float>>& display_tangent) {
   // TODO only perform this computation if the joints have moved
 
   // Fetch the arrays for the current primitive
   const auto& prim_positions = positions[submesh_id];
   const auto& prim_normals = normals[submesh_id];
+  const auto& prim_tangents = tangents[submesh_id];
   const auto& prim_joints = joints[submesh_id];
   const auto& prim_weights = weights[submesh_id];
   const auto vertex_count = prim_joints.size() / 4;
@@ -2240,6 +4010,16 @@ void app::perform_software_skinning(
          prim_joints.size() / 4 == vertex_count &&
          prim_weights.size() / 4 == vertex_count);
 
+  const bool use_dual_quaternions =
+      skinning == skinning_method::dual_quaternion;
+  std::vector<gltf_insight::dual_quaternion> joint_dual_quaternions;
+  if (use_dual_quaternions) {
+    joint_dual_quaternions.reserve(joint_matrix.size());
+    for (const auto& matrix : joint_matrix)
+      joint_dual_quaternions.push_back(
+          gltf_insight::to_dual_quaternion(matrix));
+  }
+
   for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
     using namespace glm;
 
@@ -2257,32 +4037,126 @@ void app::perform_software_skinning(
         vec4(prim_weights[4 * vertex + 0], prim_weights[4 * vertex + 1],
              prim_weights[4 * vertex + 2], prim_weights[4 * vertex + 3]);
 
-    // TODO it is possible to support more than 4 joints per vertex, but not
-    // required by glTF spec
-    const mat4 skin_matrix =
-        input_weights.x * joint_matrix[size_t(input_joints.x)] +
-        input_weights.y * joint_matrix[size_t(input_joints.y)] +
-        input_weights.z * joint_matrix[size_t(input_joints.z)] +
-        input_weights.w * joint_matrix[size_t(input_joints.w)];
-
-    auto skinned_position = skin_matrix * vec4(input_positions, 1.f);
-    auto normal_skin_matrix = mat3(transpose(inverse(skin_matrix)));
-
-    output_position = vec3(skinned_position) / skinned_position.w;
-    output_normal = normal_skin_matrix * input_normals;
+    // A dual quaternion is a rigid transform: the normals and tangents only
+    // need its rotation, no inverse
+    gltf_insight::dual_quaternion skin_dual_quaternion;
+    mat4 skin_matrix;
+    if (use_dual_quaternions) {
+      skin_dual_quaternion = gltf_insight::blend(
+          joint_dual_quaternions, input_joints, input_weights);
+      output_position =
+          gltf_insight::transform_point(skin_dual_quaternion, input_positions);
+      output_normal =
+          gltf_insight::transform_vector(skin_dual_quaternion, input_normals);
+    } else {
+      // TODO it is possible to support more than 4 joints per vertex, but not
+      // required by glTF spec
+      skin_matrix = input_weights.x * joint_matrix[size_t(input_joints.x)] +
+                    input_weights.y * joint_matrix[size_t(input_joints.y)] +
+                    input_weights.z * joint_matrix[size_t(input_joints.z)] +
+                    input_weights.w * joint_matrix[size_t(input_joints.w)];
+
+      auto skinned_position = skin_matrix * vec4(input_positions, 1.f);
+      auto normal_skin_matrix = mat3(transpose(inverse(skin_matrix)));
+
+      output_position = vec3(skinned_position) / skinned_position.w;
+      output_normal = normal_skin_matrix * input_normals;
+    }
 
     memcpy(&display_position[submesh_id][3 * vertex],
            value_ptr(output_position), 3 * sizeof(float));
     memcpy(&display_normal[submesh_id][3 * vertex], value_ptr(output_normal),
            3 * sizeof(float));
+
+    // Tangents follow the surface, the handedness is kept as is
+    if (prim_tangents.size() == 4 * vertex_count) {
+      const auto input_tangent = make_vec3(&prim_tangents[4 * vertex]);
+      const auto output_tangent =
+          use_dual_quaternions
+              ? gltf_insight::transform_vector(skin_dual_quaternion,
+                                               input_tangent)
+              : mat3(skin_matrix) * input_tangent;
+      memcpy(&display_tangent[submesh_id][4 * vertex],
+             value_ptr(output_tangent), 3 * sizeof(float));
+    }
   }
 }
 
+void app::benchmark_skinning() {
+  skinning_benchmark = skinning_report();
+  skinning_benchmark.nb_iterations = skinning_benchmark_iterations;
+  if (skinning_benchmark_iterations == 0) return;
+
+  update_mesh_skeleton_graph_transforms(gltf_scene_tree);
+  for (auto& a_mesh : loaded_meshes) {
+    if (!a_mesh.skinned) continue;
+    compute_joint_matrices(root_node_model_matrix, a_mesh.joint_matrices,
+                           a_mesh.flat_joint_list,
+                           a_mesh.inverse_bind_matrices);
+    for (const auto& joints : a_mesh.joints)
+      skinning_benchmark.nb_vertices += joints.size() / 4;
+  }
+
+  using clock = std::chrono::steady_clock;
+  const auto selected_method = skinning;
+  const auto time_skinning = [&](skinning_method method) {
+    skinning = method;
+    const auto start = clock::now();
+    for (size_t i = 0; i < skinning_benchmark_iterations; ++i)
+      for (auto& a_mesh : loaded_meshes) {
+        if (!a_mesh.skinned) continue;
+        for (size_t sm = 0; sm < a_mesh.indices.size(); ++sm)
+          perform_software_skinning(
+              sm, a_mesh.joint_matrices, a_mesh.display_position,
+              a_mesh.display_normals, a_mesh.display_tangents, a_mesh.joints,
+              a_mesh.weights, a_mesh.soft_skinned_position,
+              a_mesh.soft_skinned_normals, a_mesh.soft_skinned_tangents);
+      }
+    return std::chrono::duration<double, std::milli>(clock::now() - start)
+        .count();
+  };
+  skinning_benchmark.linear_blend_ms =
+      time_skinning(skinning_method::linear_blend);
+  skinning_benchmark.dual_quaternion_ms =
+      time_skinning(skinning_method::dual_quaternion);
+  skinning = selected_method;
+}
+
+void app::benchmark_load() {
+  load_benchmark = load_benchmark_report();
+  if (!load_benchmark_enabled) return;
+
+  // Restoring the meshes from the scene cache would skip the decoding
+  gltf_insight::scene_cache no_cache;
+  std::swap(processed_scene_cache, no_cache);
+  const auto selected_threads = load_threads;
+
+  using clock = std::chrono::steady_clock;
+  const auto time_load = [&](size_t nb_threads, double& mesh_decode_ms) {
+    load_threads = nb_threads;
+    staged_asset asset;
+    asset.filename = input_filename;
+    const auto start = clock::now();
+    load_cpu_side(asset, nullptr);
+    const auto stop = clock::now();
+    mesh_decode_ms = asset.load_report.decode_wall_ms;
+    load_benchmark.nb_threads = asset.load_report.nb_threads;
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+  };
+  load_benchmark.serial_ms =
+      time_load(1, load_benchmark.serial_mesh_decode_ms);
+  load_benchmark.parallel_ms =
+      time_load(selected_threads, load_benchmark.parallel_mesh_decode_ms);
+
+  load_threads = selected_threads;
+  std::swap(processed_scene_cache, no_cache);
+}
+
 void app::draw_bone_overlay(gltf_node& mesh_skeleton_graph,
                             int active_joint_node,
                             const glm::mat4& _view_matrix,
                             const glm::mat4& _projection_matrix,
-                            std::map<std::string, shader>& shaders,
+                            const shader_registry& shaders,
                             const mesh& a_mesh) {
   if (!a_mesh.skinned) return;
 
@@ -2290,9 +4164,10 @@ void app::draw_bone_overlay(gltf_node& mesh_skeleton_graph,
   glDisable(GL_DEPTH_TEST);
 
   // bone_display_window(&show_bone_display_window);
-  shaders["debug_color"].use();
+  const auto& debug_color = shaders[shader_id::debug_color];
+  debug_color.use();
   draw_bones(mesh_skeleton_graph, active_joint_node,
-             shaders["debug_color"].get_program(), _view_matrix,
+             debug_color.get_program(), _view_matrix,
              _projection_matrix, a_mesh);
 }
 
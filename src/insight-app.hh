@@ -34,10 +34,14 @@ SOFTWARE.
 #include "material.hh"
 
 // This includes opengl for us, along side debuging callbacks
+#include <array>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <thread>
 #include <vector>
 
 #include "gl_util.hh"
@@ -65,6 +69,13 @@ SOFTWARE.
 
 #include "gltf-graph.hh"
 #include "gltf-loader.hh"
+#include "draco_decoder.hh"
+#include "image_decoder.hh"
+#include "meshopt_decoder.hh"
+#include "program_cache.hh"
+#include "scene_cache.hh"
+#include "texture_streamer.hh"
+#include "texture_upload_queue.hh"
 #include "gui_util.hh"
 #include "shader.hh"
 #include "tiny_gltf.h"
@@ -141,6 +152,8 @@ struct mesh {
   int nb_joints = 0;
   std::vector<std::vector<unsigned short>> joints;
   std::vector<glm::mat4> joint_matrices;
+  // Where `joint_matrices` are in the joint palette of the frame
+  GLint joint_palette_offset = 0;
   std::map<int, int> joint_inverse_bind_matrix_map;
   std::vector<gltf_node*> flat_joint_list;
   std::vector<glm::mat4> inverse_bind_matrices;
@@ -154,26 +167,45 @@ struct mesh {
   std::vector<std::vector<float>> positions;
   std::vector<std::vector<float>> uvs;
   std::vector<std::vector<float>> normals;
+  // xyz + handedness, only for the normal mapped submeshes
+  std::vector<std::vector<float>> tangents;
   std::vector<std::vector<float>> weights;
   std::vector<std::vector<float>> display_position;
   std::vector<std::vector<float>> display_normals;
+  std::vector<std::vector<float>> display_tangents;
   std::vector<std::vector<float>> soft_skinned_position;
   std::vector<std::vector<float>> soft_skinned_normals;
+  std::vector<std::vector<float>> soft_skinned_tangents;
   std::vector<std::vector<float>> colors;
   std::vector<color_identifier> submesh_selection_ids;
   std::vector<int> materials;
 
+  // Static meshes are uploaded from the glTF buffers directly. Until
+  // `ensure_cpu_geometry()` is called, their vertex attributes are
+  // only referenced from there, and the arrays above are empty.
+  std::vector<borrowed_geometry> borrowed;
+
+  // Index in the loaded meshes of the instance this one copied its decoded
+  // geometry from, -1 if it decoded its own
+  int geometry_source = -1;
+  // Static instance that only reads the vertex arrays of its geometry source
+  // and holds none itself, see `app::cpu_geometry()`
+  bool shares_cpu_geometry = false;
+
   // Rendering
   std::vector<GLuint> VAOs;
   std::vector<std::array<GLuint, VBO_count>> VBOs;
   std::vector<draw_call_submesh_descriptor> draw_call_descriptors;
+  // The VAOs and VBOs belong to the geometry source, that outlives this mesh
+  bool shares_gpu_geometry = false;
 
   // Each mesh comes with a set of shader objects to be used. They need to be
   // created after we known some info about the mesh Because gl_util's
   // load_shader function take templated shader code and substitues values. This
-  // is required for the GPU skinning implementation.
-  std::unique_ptr<std::map<std::string, shader>> shader_list;
-  std::unique_ptr<std::map<std::string, shader>> soft_skin_shader_list;
+  // is required for the GPU skinning implementation. Meshes with the same
+  // number of joints share the same set.
+  std::shared_ptr<shader_registry> shader_list;
+  std::shared_ptr<shader_registry> soft_skin_shader_list;
 
   // is this mesh displayed on screen
   bool displayed = true;
@@ -186,6 +218,10 @@ struct mesh {
   mesh();
   ~mesh();
 
+  /// Make sure the geometry arrays are filled. Needed before any CPU side use
+  /// of the vertices (picking, OBJ export...)
+  void ensure_cpu_geometry();
+
   bool raycast_submesh_camera_mouse(glm::mat4 world_xform, size_t submesh,
                                     glm::vec3 world_camera_position,
                                     glm::mat4 vp, float x, float y) const;
@@ -224,6 +260,13 @@ class app {
   void initialize_mouse_select_framebuffer();
   app(int argc, char** argv);
   ~app();
+
+  /// True if `--headless` was given. No window or OpenGL context exists then
+  bool is_headless() const { return headless; }
+
+  /// Load the input file and evaluate its animations on the CPU only, then
+  /// print a JSON summary on stdout. Returns the process exit code
+  int run_headless();
   void run_file_menu();
   void run_edit_menu();
   void run_view_menu();
@@ -238,13 +281,25 @@ class app {
   void unload();
   void load_as_metal_roughness(size_t i, material& currently_loading,
                                tinygltf::Material gltf_material);
+
+  /// Load `input_filename` on the calling thread
   void load();
 
+  /// Load `filename` on a background thread. The current asset stays loaded
+  /// until the new one is ready, and is then replaced by it. A load that is
+  /// already running is cancelled first.
+  void start_loading(const std::string& filename);
+
   void main_loop();
   void update_mouse_select_framebuffer();
   void get_submesh_below_mouse_cursor(bool& clicked_on_submesh, size_t& mesh_id,
                                       size_t& submesh_id);
   void get_vertex_below_mouse_cursor(size_t mesh_id, size_t submesh_id);
+
+  /// The mesh holding the CPU side vertices of loaded mesh `index`: itself,
+  /// or its geometry source if it shares it. The arrays are filled if needed
+  const mesh& cpu_geometry(size_t index);
+
   void check_current_active_selection_valid(bool& current_selection_valid);
   void handle_click_on_geometry();
   void handle_current_selection();
@@ -275,8 +330,23 @@ class app {
   glm::vec3 world_camera_position;
   GLuint color_pick_fbo, color_pick_screen_texture, color_pick_depth_buffer;
 
+  // Per instance transforms of the instanced draw in progress, every static
+  // mesh VAO reads them from `instance_VBO`
+  GLuint instance_VBO = 0;
+  std::vector<instance_transform> instance_transforms;
+
+  // Uniform blocks: `frame_uniforms` updated at the start of each frame, and
+  // the uniforms of every material, updated when they are loaded or edited
+  GLuint frame_UBO = 0;
+  material_uniform_buffer material_blocks;
+  // Joint matrices of all the skinned meshes, uploaded once per frame
+  joint_palette skinning_palette;
+
+  /// Draw `mesh` with the given transforms, or, if `nb_instances` isn't 0,
+  /// that many times with the transforms in `instance_VBO`
   void draw_mesh(const glm::vec3& world_camera_position, const mesh& mesh,
-                 glm::mat3 normal_matrix, glm::mat4 model_matrix);
+                 glm::mat3 normal_matrix, glm::mat4 model_matrix,
+                 GLsizei nb_instances = 0);
 
   void draw_scene(const glm::vec3& world_camera_position);
 
@@ -289,8 +359,13 @@ class app {
     defered_draw(gltf_node* n) : node(n) {}
   };
 
+  // Nodes of the static meshes, by index of the mesh that owns their GPU
+  // geometry
+  using instanced_draws = std::map<size_t, std::vector<gltf_node*>>;
+
   void draw_scene_recur(const glm::vec3& world_camera_position, gltf_node& node,
-                        std::vector<defered_draw>& alpha_models);
+                        std::vector<defered_draw>& alpha_models,
+                        instanced_draws& instanced_models);
 
   editor_lighting editor_light;
 
@@ -318,6 +393,11 @@ class app {
   bool show_bone_display_window = true;
   bool show_scene_outline_window = true;
   bool do_soft_skinning = true;
+  /// How the joint transforms of a vertex are blended, on the CPU and GPU
+  /// paths alike. Dual quaternions keep the volume around twisted joints, but
+  /// ignore any scale in the joints
+  enum class skinning_method { linear_blend, dual_quaternion };
+  skinning_method skinning = skinning_method::linear_blend;
   bool show_debug_ray = false;
   bool show_obj_export_window = true;
 
@@ -333,12 +413,14 @@ class app {
 
   ImVec4 viewport_background_color = ImVec4(0.25f, 0.25f, 0.25f, 1.00f);
   tinygltf::Model model;
-  tinygltf::TinyGLTF gltf_ctx;
+  // Content of the buffers of `model` that lives outside of it. Static meshes
+  // point into it
+  gltf_insight::buffer_data::overrides model_buffers;
 
   // display parameters
   std::vector<std::string> shader_names;
   int selected_shader = 0;
-  std::string shader_to_use;
+  shader_id shader_to_use = shader_id::unlit;
   glm::mat4 view_matrix{1.f}, projection_matrix{1.f};
   glm::mat4& root_node_model_matrix = gltf_scene_tree.local_xform;
   int display_w, display_h;
@@ -349,6 +431,27 @@ class app {
   bool open_file_dialog = false;
   bool save_file_dialog = false;
   bool debug_output = false;
+  bool headless = false;
+  /// Decode the images headless too, instead of only checking their header
+  bool headless_image_decoding = false;
+  size_t load_threads = 0;
+  bool use_mmap = false;
+  vertex_layout mesh_vertex_layout = vertex_layout::separate;
+  /// Scratch buffer of the interleaved dynamic stream uploads
+  std::vector<float> dynamic_stream;
+  bool use_texture_cache = true;
+  std::string texture_cache_directory;
+  bool use_scene_cache = true;
+  std::string scene_cache_directory;
+  bool use_shader_cache = true;
+  std::string shader_cache_directory;
+  /// Rounds of `benchmark_uniform_updates` to run once a file is loaded
+  size_t uniform_benchmark_iterations = 0;
+  /// Rounds of CPU skinning timed with each method by `run_headless`
+  size_t skinning_benchmark_iterations = 0;
+  /// `run_headless` loads the input file again on one thread and on
+  /// `load_threads` to time the speedup
+  bool load_benchmark_enabled = false;
   bool show_imgui_demo = false;
   std::string input_filename;
   GLFWwindow* window{nullptr};
@@ -384,8 +487,140 @@ class app {
 
   GLuint logo = 0;
 
+  // Timings of the last `load_meshes` call
+  struct mesh_load_report {
+    size_t nb_meshes = 0;
+    size_t nb_threads = 1;
+    // Listing the instances and looking up the scene cache, before decoding
+    double setup_ms = 0.0;
+    double decode_wall_ms = 0.0;
+    double decode_cpu_ms = 0.0;
+    // The meshes were restored from the processed scene cache
+    bool from_scene_cache = false;
+
+    // See `gltf_insight::work_overlap`
+    double work_overlap() const {
+      return gltf_insight::work_overlap(decode_cpu_ms, decode_wall_ms);
+    }
+  } load_report;
+
+  // What sharing identical data saved during the last load
+  struct sharing_report {
+    // Mesh instances that copied the decoded geometry of an identical one,
+    // and the bytes of the decoded arrays they do not hold themselves
+    size_t nb_shared_meshes = 0;
+    size_t shared_decoded_bytes = 0;
+    // Submeshes drawn from the buffers of another instance, and the bytes
+    // they did not upload
+    size_t nb_shared_submeshes = 0;
+    size_t shared_buffer_bytes = 0;
+    // Images with the same file content as an earlier one, and their size
+    size_t nb_shared_images = 0;
+    size_t shared_image_bytes = 0;
+  } sharing;
+
+  // Timings of the last `benchmark_skinning` call
+  struct skinning_report {
+    size_t nb_iterations = 0;
+    // Skinned vertices processed in each iteration
+    size_t nb_vertices = 0;
+    double linear_blend_ms = 0.0;
+    double dual_quaternion_ms = 0.0;
+  } skinning_benchmark;
+
+  // Timings of the last `benchmark_load` call
+  struct load_benchmark_report {
+    // Threads used by the mesh decoding of the parallel load
+    size_t nb_threads = 0;
+    // `load_cpu_side` on one thread, then on `load_threads`
+    double serial_ms = 0.0;
+    double parallel_ms = 0.0;
+    // The mesh decoding part of them
+    double serial_mesh_decode_ms = 0.0;
+    double parallel_mesh_decode_ms = 0.0;
+
+    double speedup() const {
+      return parallel_ms > 0.0 ? serial_ms / parallel_ms : 0.0;
+    }
+    double mesh_decode_speedup() const {
+      return parallel_mesh_decode_ms > 0.0
+                 ? serial_mesh_decode_ms / parallel_mesh_decode_ms
+                 : 0.0;
+    }
+  } load_benchmark;
+
+  // Timings of the image decoding of the last load
+  image_decode_report image_report;
+
+  // Timings of the EXT_meshopt_compression decoding of the last load
+  meshopt_decode_report meshopt_report;
+
+  // Timings of the KHR_draco_mesh_compression decoding of the last load
+  draco_decode_report draco_report;
+
+  // Output of the CPU side of loading. It is filled without touching the
+  // application state, so it can be built on another thread, and is then
+  // moved in by `install_asset`
+  struct staged_asset {
+    std::string filename;
+    tinygltf::Model model;
+    gltf_insight::buffer_data::overrides buffers;
+    gltf_node scene_tree{gltf_node::node_type::empty};
+    std::vector<mesh> meshes;
+    std::vector<animation> animations;
+    mesh_load_report load_report;
+    sharing_report sharing;
+    image_decode_report image_report;
+    meshopt_decode_report meshopt_report;
+    draco_decode_report draco_report;
+
+    // Images are decoded on demand, see `texture_streamer`
+    std::vector<encoded_image> encoded_images;
+
+    // Processed scene cache file the static meshes point into, if any
+    std::shared_ptr<os_utils::mapped_file> cached_geometry;
+
+    staged_asset() = default;
+    staged_asset(const staged_asset&) = delete;
+    staged_asset& operator=(const staged_asset&) = delete;
+  };
+
+  // State shared between the main thread and a background load. The worker
+  // only writes `result` and `error` before setting `done`
+  struct background_load {
+    std::string filename;
+    std::thread thread;
+    std::atomic<bool> cancel{false};
+    std::atomic<bool> done{false};
+    std::atomic<float> progress{0.f};
+    std::atomic<const char*> stage{""};
+    std::unique_ptr<staged_asset> result;
+    std::string error;
+
+    // Publish the current step. Returns false if the load was cancelled
+    bool report(const char* name, float completion) {
+      stage = name;
+      progress = completion;
+      return !cancel;
+    }
+  };
+
+  std::unique_ptr<background_load> pending_load;
+
+  // Cancelled loads whose worker is still running. A worker only notices the
+  // cancellation between two steps, they are joined once `done` is set
+  std::vector<std::unique_ptr<background_load>> cancelled_loads;
+
   // Loaded data
   std::vector<GLuint> textures;
+  texture_upload_queue texture_uploads;
+  texture_streamer texture_stream;
+  gltf_insight::scene_cache processed_scene_cache;
+  gltf_insight::program_binary_cache program_binaries;
+  // Shader sets without and with GPU skinning, shared by all the meshes using
+  // them and kept from a file to the next
+  std::array<std::shared_ptr<shader_registry>, 2> shader_sets;
+  std::shared_ptr<os_utils::mapped_file> cached_geometry;
   std::vector<animation> animations;
   std::vector<std::string> animation_names;
 
@@ -395,12 +630,78 @@ class app {
 
   void parse_command_line(int argc, char** argv);
 
-  // Load glTF asset. Initial input filename is given at `parse_command_line`
-  void load_glTF_asset();
+  // Load glTF asset from `filename` into `asset_model`. If `deferred_images`
+  // is null, images are decoded in parallel once the file is parsed. Otherwise
+  // they are left encoded in it
+  void load_glTF_asset(const std::string& filename,
+                       tinygltf::Model& asset_model,
+                       gltf_insight::buffer_data::overrides& buffers,
+                       image_decode_report& report,
+                       std::vector<encoded_image>* deferred_images) const;
+
+  // Load a binary glTF file through a memory mapping. tinygltf only parses
+  // the JSON chunk, the BIN chunk is never copied and is read from the
+  // mapping through `buffers`
+  bool load_mapped_glb(tinygltf::TinyGLTF& gltf_ctx,
+                       const std::string& filename,
+                       tinygltf::Model& asset_model,
+                       gltf_insight::buffer_data::overrides& buffers,
+                       std::string& err, std::string& warn) const;
+
+  // Everything in loading that doesn't need an OpenGL context. Safe to call
+  // from any thread. `job` can be null, otherwise progress is reported to it.
+  // Returns false if the job was cancelled
+  bool load_cpu_side(staged_asset& asset, background_load* job);
+
+  // Replace the application state with `asset`, then create its OpenGL
+  // objects. Main thread only
+  void install_asset(staged_asset& asset);
+
+  // Install the result of a finished background load, if any, and join the
+  // cancelled loads that finished
+  void poll_background_load();
+
+  // Progress popup of the background load
+  void background_load_ui();
+
+  // Cancel the background load, if any, without waiting for its thread
+  void cancel_background_load();
+
+  // Cancel any background load and wait for every load thread
+  void stop_background_load();
 
   // Assume `textures` are already allocated at least with the size
-  // `nb_textures`
-  void load_all_textures(size_t nb_textures);
+  // `nb_textures`. The textures start as placeholders, and `images` are only
+  // decoded once `request_visible_textures` asks for them
+  void load_all_textures(size_t nb_textures, std::vector<encoded_image> images);
+
+  // Request the textures used by the materials of displayed meshes
+  void request_visible_textures();
+
+  // Set up the on-disk cache of decoded textures, in `texture_cache_directory`
+  // or in the user cache directory
+  void open_texture_cache();
+
+  // Set up the on-disk cache of processed scenes, in `scene_cache_directory`
+  // or in the user cache directory
+  void open_scene_cache();
+
+  // Set up the on-disk cache of linked shader programs, in
+  // `shader_cache_directory` or in the user cache directory
+  void open_shader_cache();
+
+  // The shader set for skinned or static meshes, built on first use
+  std::shared_ptr<shader_registry> shader_set(bool skinned);
+
+  void load_materials();
+
+  // CPU side part of the mesh loading, does not need an OpenGL context
+  void load_meshes(staged_asset& asset,
+                   const std::vector<gltf_mesh_instance>& meshes_indices,
+                   background_load* job);
+
+  // Create the VAOs, VBOs and shaders of the meshes in `loaded_meshes`
+  void upload_meshes();
 
   void generate_joint_inverse_bind_matrix_map(
       const tinygltf::Skin& skin, const std::vector<int>::size_type nb_joints,
@@ -411,17 +712,22 @@ class app {
       const std::vector<std::vector<morph_target>>& morph_targets,
       const std::vector<std::vector<float>>& vertex_coord,
       const std::vector<std::vector<float>>& normals,
+      const std::vector<std::vector<float>>& tangents,
       std::vector<std::vector<float>>& display_position,
-      std::vector<std::vector<float>>& display_normal, size_t vertex);
+      std::vector<std::vector<float>>& display_normal,
+      std::vector<std::vector<float>>& display_tangent);
 
   void gpu_update_submesh_buffers(
       size_t submesh_id, std::vector<std::vector<float>>& display_position,
       std::vector<std::vector<float>>& display_normal,
+      std::vector<std::vector<float>>& display_tangent,
       std::vector<std::array<GLuint, VBO_count>>& VBOs);
 
   void gpu_update_submesh_skinning_data(
-      size_t submesh_id, std::vector<std::vector<float>>& weight,
+      size_t submesh_id, size_t vertex_id,
+      std::vector<std::vector<float>>& weight,
       std::vector<std::vector<unsigned short>>& joint,
+      const std::vector<draw_call_submesh_descriptor>& descriptors,
       std::vector<std::array<GLuint, VBO_count>>& VBOs);
 
   void perform_software_morphing(
@@ -429,8 +735,10 @@ class app {
       const std::vector<std::vector<morph_target>>& morph_targets,
       const std::vector<std::vector<float>>& positions,
       const std::vector<std::vector<float>>& normals,
+      const std::vector<std::vector<float>>& tangents,
       std::vector<std::vector<float>>& display_position,
       std::vector<std::vector<float>>& display_normal,
+      std::vector<std::vector<float>>& display_tangent,
       std::vector<std::array<GLuint, VBO_count>>& VBOs,
       bool upload_to_gpu = true);
 
@@ -438,15 +746,25 @@ class app {
       size_t submesh_id, const std::vector<glm::mat4>& joint_matrices,
       const std::vector<std::vector<float>>& positions,
       const std::vector<std::vector<float>>& normals,
+      const std::vector<std::vector<float>>& tangents,
       const std::vector<std::vector<unsigned short>>& joints,
       const std::vector<std::vector<float>>& weights,
       std::vector<std::vector<float>>& display_position,
-      std::vector<std::vector<float>>& display_normal);
+      std::vector<std::vector<float>>& display_normal,
+      std::vector<std::vector<float>>& display_tangent);
+
+  /// Time `skinning_benchmark_iterations` rounds of `perform_software_skinning`
+  /// on every skinned mesh in its current pose, with each skinning method
+  void benchmark_skinning();
+
+  /// Time the CPU side of loading the input file on one thread and on
+  /// `load_threads`, without the scene cache, if `load_benchmark_enabled`
+  void benchmark_load();
 
   void draw_bone_overlay(gltf_node& mesh_skeleton_graph, int active_joint_node,
                          const glm::mat4& view_matrix,
                          const glm::mat4& projection_matrix,
-                         std::map<std::string, shader>& shaders,
+                         const shader_registry& shaders,
                          const mesh& a_mesh);
 
   void compute_joint_matrices(glm::mat4& model_matrix,
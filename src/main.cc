@@ -23,6 +23,7 @@ int main(int argc, char** argv) {
   std::cout <<"This program is running under emscripten\n";
 #endif
   gltf_insight::app application{argc, argv};
+  if (application.is_headless()) return application.run_headless();
   std::cout << "Created gltf_insight::app object\n";
 #ifndef __EMSCRIPTEN__
   application.main_loop();
@@ -23,6 +23,8 @@ SOFTWARE.
 */
 #include "material.hh"
 
+#include <cstring>
+
 #include "shader.hh"
 
 using namespace gltf_insight;
@@ -106,54 +108,79 @@ void material::bind_textures() const {
   }
 }
 
-void material::set_shader_uniform(const shader& shading_program) const {
-  // Bind program to opengl state machine
-  shading_program.use();
-
-  // set generic material uniform values
-  shading_program.set_uniform("normal_texture", 0);
-  shading_program.set_uniform("occlusion_texture", 1);
-  shading_program.set_uniform("emissive_texture", 2);
-  shading_program.set_uniform("emissive_factor", emissive_factor);
-  shading_program.set_uniform("alpha_mode", int(alpha_mode));
-  shading_program.set_uniform("alpha_cutoff", alpha_cutoff);
+material_uniforms material::get_uniforms() const {
+  material_uniforms uniforms;
+  uniforms.base_color_factor = glm::vec4(1.f);
+  uniforms.emissive_factor = emissive_factor;
+  uniforms.metallic_factor = 1.f;
+  uniforms.roughness_factor = 1.f;
+  uniforms.alpha_cutoff = alpha_cutoff;
+  uniforms.alpha_mode = GLint(alpha_mode);
+  uniforms.padding = 0.f;
 
-  // set shader specific material uniform values
   switch (intended_shader) {
     case shading_type::pbr_metal_rough:
-      shading_program.set_uniform("base_color_texture", 3);
-      shading_program.set_uniform("metallic_roughness_texture", 4);
-      shading_program.set_uniform(
-          "base_color_factor",
-          shader_inputs.pbr_metal_roughness.base_color_factor);
-      shading_program.set_uniform(
-          "metallic_factor", shader_inputs.pbr_metal_roughness.metallic_factor);
-      shading_program.set_uniform(
-          "roughness_factor",
-          shader_inputs.pbr_metal_roughness.roughness_factor);
+      uniforms.base_color_factor =
+          shader_inputs.pbr_metal_roughness.base_color_factor;
+      uniforms.metallic_factor =
+          shader_inputs.pbr_metal_roughness.metallic_factor;
+      uniforms.roughness_factor =
+          shader_inputs.pbr_metal_roughness.roughness_factor;
       break;
 
+    // Drawn with the metallic roughness shader for now, as a dielectric
     case shading_type::pbr_specular_glossy:
-      shading_program.set_uniform("diffuse_texture", 3);
-      shading_program.set_uniform("specular_glossiness_texture", 4);
-      shading_program.set_uniform(
-          "diffuse_factor",
-          shader_inputs.pbr_specular_glossiness.diffuse_factor);
-      shading_program.set_uniform(
-          "specular_factor",
-          shader_inputs.pbr_specular_glossiness.specular_factor);
-      shading_program.set_uniform(
-          "glossiness_factor",
-          shader_inputs.pbr_specular_glossiness.glossiness_factor);
+      uniforms.base_color_factor =
+          shader_inputs.pbr_specular_glossiness.diffuse_factor;
+      uniforms.metallic_factor = 0.f;
+      uniforms.roughness_factor =
+          1.f - shader_inputs.pbr_specular_glossiness.glossiness_factor;
       break;
 
     case shading_type::unlit:
-      shading_program.set_uniform("base_color_texture", 3);
-      shading_program.set_uniform("base_color_factor",
-                                  shader_inputs.unlit.base_color_factor);
-
+      uniforms.base_color_factor = shader_inputs.unlit.base_color_factor;
       break;
   }
+
+  return uniforms;
+}
+
+void material_uniform_buffer::upload(const std::vector<material>& materials) {
+  if (!buffer_) {
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    const auto size = GLintptr(sizeof(material_uniforms));
+    stride_ = alignment > 0 ? (size + alignment - 1) / alignment * alignment
+                            : size;
+    glGenBuffers(1, &buffer_);
+  }
+
+  nb_materials_ = materials.size();
+  if (materials.empty()) return;
+
+  std::vector<unsigned char> data(nb_materials_ * size_t(stride_), 0);
+  for (size_t i = 0; i < nb_materials_; ++i) {
+    const auto uniforms = materials[i].get_uniforms();
+    std::memcpy(data.data() + i * size_t(stride_), &uniforms, sizeof uniforms);
+  }
+
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+  glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(data.size()), data.data(),
+               GL_STATIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void material_uniform_buffer::bind(size_t index) const {
+  if (index >= nb_materials_) return;
+  glBindBufferRange(GL_UNIFORM_BUFFER, GLuint(uniform_block::material),
+                    buffer_, GLintptr(index) * stride_,
+                    GLsizeiptr(sizeof(material_uniforms)));
+}
+
+void material_uniform_buffer::release() {
+  if (buffer_) glDeleteBuffers(1, &buffer_);
+  buffer_ = 0;
+  nb_materials_ = 0;
 }
 
 #ifdef __clang__
@@ -45,10 +45,9 @@ SOFTWARE.
 
 #include <array>
 #include <string>
+#include <vector>
 
 
-class shader;
-
 namespace gltf_insight {
 
 struct fallback_textures {
@@ -101,6 +100,20 @@ static inline std::string to_string(shading_type s) {
 /// The maximum number of texture attachement our shader system can have
 static constexpr size_t max_texture_slots = 6;
 
+/// std140 layout of `material_block`
+struct material_uniforms {
+  glm::vec4 base_color_factor;
+  glm::vec3 emissive_factor;
+  float metallic_factor;
+  float roughness_factor;
+  float alpha_cutoff;
+  GLint alpha_mode;
+  float padding;
+};
+static_assert(sizeof(material_uniforms) == 48,
+              "material_uniforms must match the std140 layout of "
+              "material_block");
+
 struct material {
   std::string name = "not_set";
   // Hint about shader to use
@@ -160,7 +173,25 @@ struct material {
 
   void fill_material_texture_slots();
   void bind_textures() const;
-  void set_shader_uniform(const shader& shading_program) const;
+  material_uniforms get_uniforms() const;
+};
+
+/// The `material_block` of every material, packed in one uniform buffer.
+/// Draws only bind the range of their material
+class material_uniform_buffer {
+  GLuint buffer_ = 0;
+  GLintptr stride_ = 0;
+  size_t nb_materials_ = 0;
+
+ public:
+  /// Upload the uniforms of all `materials`. Called once they are loaded, and
+  /// again after one of them is edited
+  void upload(const std::vector<material>& materials);
+
+  /// Bind the range of material `index` to the material block
+  void bind(size_t index) const;
+
+  void release();
 };
 
 }  // namespace gltf_insight
@@ -0,0 +1,569 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "meshopt_decoder.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "buffer_data.hh"
+#include "parallel_for.hh"
+#include "tiny_gltf_util.h"
+
+using namespace gltf_insight;
+
+// The formats are described in the EXT_meshopt_compression specification,
+// this follows the reference decoder of meshoptimizer, minus the SIMD paths
+namespace {
+
+// Vertex codec
+constexpr unsigned char vertex_header = 0xa0;
+constexpr size_t vertex_block_size_bytes = 8192;
+constexpr size_t vertex_block_max_size = 256;
+constexpr size_t byte_group_size = 16;
+constexpr size_t byte_group_decode_limit = 24;
+constexpr size_t tail_max_size = 32;
+
+// Index codecs
+constexpr unsigned char index_header = 0xe0;
+constexpr unsigned char sequence_header = 0xd0;
+constexpr int decode_index_version = 1;
+
+void check(bool condition, const char* what) {
+  if (!condition)
+    throw std::runtime_error(std::string("meshopt: ") + what);
+}
+
+size_t vertex_block_size(size_t byte_stride) {
+  size_t result = vertex_block_size_bytes / byte_stride;
+  result &= ~(byte_group_size - 1);
+  return std::min(result, vertex_block_max_size);
+}
+
+unsigned char unzigzag8(unsigned char value) {
+  return static_cast<unsigned char>(-(value & 1) ^ (value >> 1));
+}
+
+// 16 values stored on 0, 2, 4 or 8 bits. A value with all its bits set is
+// an escape, the real byte follows the packed ones
+const unsigned char* decode_bytes_group(const unsigned char* data,
+                                        unsigned char* output, int bitslog2) {
+  switch (bitslog2) {
+    case 0:
+      std::memset(output, 0, byte_group_size);
+      return data;
+    case 1:
+    case 2: {
+      const unsigned bits = bitslog2 == 1 ? 2 : 4;
+      const unsigned escape = (1u << bits) - 1;
+      const unsigned char* escaped = data + bits * 2;
+      for (size_t i = 0; i < byte_group_size; ++i) {
+        const unsigned byte = data[i * bits / 8];
+        const unsigned shift = 8 - bits - unsigned(i * bits % 8);
+        const unsigned value = (byte >> shift) & escape;
+        if (value == escape)
+          output[i] = *escaped++;
+        else
+          output[i] = static_cast<unsigned char>(value);
+      }
+      return escaped;
+    }
+    default:
+      std::memcpy(output, data, byte_group_size);
+      return data + byte_group_size;
+  }
+}
+
+const unsigned char* decode_bytes(const unsigned char* data,
+                                  const unsigned char* data_end,
+                                  unsigned char* output, size_t output_size) {
+  // 2 bits of header per group, rounded up to whole bytes
+  const unsigned char* header = data;
+  const size_t header_size = (output_size / byte_group_size + 3) / 4;
+  check(size_t(data_end - data) >= header_size, "truncated vertex data");
+  data += header_size;
+
+  for (size_t i = 0; i < output_size; i += byte_group_size) {
+    check(size_t(data_end - data) >= byte_group_decode_limit,
+          "truncated vertex data");
+    const size_t group = i / byte_group_size;
+    const int bitslog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+    data = decode_bytes_group(data, output + i, bitslog2);
+  }
+  return data;
+}
+
+// Bytes are stored transposed, as deltas to the same byte of the previous
+// vertex
+const unsigned char* decode_vertex_block(const unsigned char* data,
+                                         const unsigned char* data_end,
+                                         unsigned char* destination,
+                                         size_t count, size_t byte_stride,
+                                         unsigned char* last_vertex) {
+  unsigned char deltas[vertex_block_max_size];
+  const size_t aligned_count =
+      (count + byte_group_size - 1) & ~(byte_group_size - 1);
+
+  for (size_t k = 0; k < byte_stride; ++k) {
+    data = decode_bytes(data, data_end, deltas, aligned_count);
+
+    unsigned char previous = last_vertex[k];
+    for (size_t i = 0; i < count; ++i) {
+      previous = static_cast<unsigned char>(unzigzag8(deltas[i]) + previous);
+      destination[i * byte_stride + k] = previous;
+    }
+    last_vertex[k] = previous;
+  }
+  return data;
+}
+
+uint32_t decode_vbyte(const unsigned char*& data) {
+  const unsigned char lead = *data++;
+  if (lead < 128) return lead;
+
+  uint32_t result = lead & 127u;
+  unsigned shift = 7;
+  for (int i = 0; i < 4; ++i) {
+    const unsigned char group = *data++;
+    result |= uint32_t(group & 127u) << shift;
+    shift += 7;
+    if (group < 128) break;
+  }
+  return result;
+}
+
+uint32_t unzigzag32(uint32_t value) {
+  return (value >> 1) ^ (0u - (value & 1u));
+}
+
+uint32_t decode_index(const unsigned char*& data, uint32_t last) {
+  return last + unzigzag32(decode_vbyte(data));
+}
+
+void write_index(unsigned char* destination, size_t i, size_t index_size,
+                 uint32_t index) {
+  if (index_size == 2) {
+    const uint16_t narrow = static_cast<uint16_t>(index);
+    std::memcpy(destination + i * 2, &narrow, 2);
+  } else {
+    std::memcpy(destination + i * 4, &index, 4);
+  }
+}
+
+template <typename T>
+T load(const unsigned char* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+template <typename T>
+void store(unsigned char* data, T value) {
+  std::memcpy(data, &value, sizeof(T));
+}
+
+template <typename T>
+T round_to(float value) {
+  return static_cast<T>(int(value + (value >= 0.f ? 0.5f : -0.5f)));
+}
+
+template <typename T>
+void decode_octahedral(unsigned char* data, size_t count, size_t byte_stride) {
+  const float max = float((1 << (sizeof(T) * 8 - 1)) - 1);
+  for (size_t i = 0; i < count; ++i) {
+    unsigned char* element = data + i * byte_stride;
+
+    // z stores the scale of x and y, which are octahedral coordinates
+    float x = float(load<T>(element));
+    float y = float(load<T>(element + sizeof(T)));
+    const float z = float(load<T>(element + 2 * sizeof(T))) - std::fabs(x) -
+                    std::fabs(y);
+
+    // Fold the lower hemisphere back
+    const float t = z < 0.f ? z : 0.f;
+    x += x >= 0.f ? t : -t;
+    y += y >= 0.f ? t : -t;
+
+    const float scale = max / std::sqrt(x * x + y * y + z * z);
+    store(element, round_to<T>(x * scale));
+    store(element + sizeof(T), round_to<T>(y * scale));
+    store(element + 2 * sizeof(T), round_to<T>(z * scale));
+  }
+}
+
+size_t json_size(const tinygltf::Value& object, const char* key) {
+  return size_t(std::max(0, get_int_value(object, key, 0)));
+}
+
+std::string json_string(const tinygltf::Value& object, const char* key,
+                        const char* fallback) {
+  if (!object.Has(key) || !object.Get(key).IsString()) return fallback;
+  return object.Get(key).Get<std::string>();
+}
+
+// What EXT_meshopt_compression says about one bufferView
+struct compressed_view {
+  int buffer_view = -1;
+  int buffer = -1;
+  size_t byte_offset = 0;
+  size_t byte_length = 0;
+  size_t byte_stride = 0;
+  size_t count = 0;
+  std::string mode;
+  std::string filter;
+};
+
+void decode_view(const tinygltf::Model& model,
+                 const buffer_data::overrides& buffers,
+                 const compressed_view& view,
+                 std::vector<unsigned char>& output) {
+  size_t buffer_size = 0;
+  const unsigned char* buffer =
+      buffers.get_buffer(model, view.buffer, buffer_size);
+  check(buffer && view.byte_offset + view.byte_length <= buffer_size,
+        "compressed data is out of its buffer");
+  const unsigned char* source = buffer + view.byte_offset;
+
+  output.resize(view.count * view.byte_stride);
+  if (view.mode == "ATTRIBUTES") {
+    meshopt::decode_vertex_buffer(output.data(), view.count, view.byte_stride,
+                                  source, view.byte_length);
+  } else if (view.mode == "TRIANGLES") {
+    meshopt::decode_index_buffer(output.data(), view.count, view.byte_stride,
+                                 source, view.byte_length);
+  } else if (view.mode == "INDICES") {
+    meshopt::decode_index_sequence(output.data(), view.count, view.byte_stride,
+                                   source, view.byte_length);
+  } else {
+    check(false, "unknown compression mode");
+  }
+
+  if (view.filter == "OCTAHEDRAL")
+    meshopt::decode_filter_octahedral(output.data(), view.count,
+                                      view.byte_stride);
+  else if (view.filter == "QUATERNION")
+    meshopt::decode_filter_quaternion(output.data(), view.count,
+                                      view.byte_stride);
+  else if (view.filter == "EXPONENTIAL")
+    meshopt::decode_filter_exponential(output.data(), view.count,
+                                       view.byte_stride);
+  else
+    check(view.filter == "NONE", "unknown filter");
+}
+
+}  // namespace
+
+void meshopt::decode_vertex_buffer(unsigned char* destination, size_t count,
+                                   size_t byte_stride,
+                                   const unsigned char* source,
+                                   size_t source_size) {
+  check(byte_stride > 0 && byte_stride <= 256 && byte_stride % 4 == 0,
+        "invalid vertex stride");
+  check(source_size >= 1 + byte_stride, "truncated vertex data");
+  check((source[0] & 0xf0) == vertex_header, "not a vertex buffer");
+  check((source[0] & 0x0f) == 0, "unsupported vertex codec version");
+
+  const unsigned char* data = source + 1;
+  const unsigned char* data_end = source + source_size;
+
+  // The tail holds the first vertex, the base of the deltas of the first block
+  unsigned char last_vertex[256];
+  std::memcpy(last_vertex, data_end - byte_stride, byte_stride);
+
+  const size_t block_size = vertex_block_size(byte_stride);
+  for (size_t offset = 0; offset < count; offset += block_size) {
+    data = decode_vertex_block(data, data_end,
+                               destination + offset * byte_stride,
+                               std::min(block_size, count - offset),
+                               byte_stride, last_vertex);
+  }
+
+  const size_t tail_size = std::max(byte_stride, tail_max_size);
+  check(size_t(data_end - data) == tail_size, "invalid vertex data size");
+}
+
+void meshopt::decode_index_buffer(unsigned char* destination, size_t count,
+                                  size_t index_size,
+                                  const unsigned char* source,
+                                  size_t source_size) {
+  check(count % 3 == 0, "triangle index count is not a multiple of 3");
+  check(index_size == 2 || index_size == 4, "invalid index size");
+  // Header, one code per triangle, and the 16 bytes code table at the end
+  check(source_size >= 1 + count / 3 + 16, "truncated index data");
+  check((source[0] & 0xf0) == index_header, "not an index buffer");
+  const int version = source[0] & 0x0f;
+  check(version <= decode_index_version, "unsupported index codec version");
+
+  // Recently seen edges and vertices, the codes reference them
+  uint32_t edge_fifo[16][2];
+  uint32_t vertex_fifo[16];
+  std::memset(edge_fifo, -1, sizeof(edge_fifo));
+  std::memset(vertex_fifo, -1, sizeof(vertex_fifo));
+  size_t edge_offset = 0;
+  size_t vertex_offset = 0;
+
+  const auto push_edge = [&](uint32_t a, uint32_t b) {
+    edge_fifo[edge_offset][0] = a;
+    edge_fifo[edge_offset][1] = b;
+    edge_offset = (edge_offset + 1) & 15;
+  };
+  const auto push_vertex = [&](uint32_t v, bool condition) {
+    vertex_fifo[vertex_offset] = v;
+    vertex_offset = (vertex_offset + (condition ? 1 : 0)) & 15;
+  };
+
+  uint32_t next = 0;
+  uint32_t last = 0;
+  const int fec_max = version >= 1 ? 13 : 15;
+
+  const unsigned char* code = source + 1;
+  const unsigned char* data = code + count / 3;
+  const unsigned char* data_safe_end = source + source_size - 16;
+  const unsigned char* code_table = data_safe_end;
+
+  for (size_t i = 0; i < count; i += 3) {
+    // A triangle reads at most 16 bytes, which the code table pads
+    check(data <= data_safe_end, "truncated index data");
+
+    uint32_t a, b, c;
+    const unsigned char code_triangle = *code++;
+    if (code_triangle < 0xf0) {
+      // Triangle on a recent edge
+      const size_t fe = code_triangle >> 4;
+      a = edge_fifo[(edge_offset - 1 - fe) & 15][0];
+      b = edge_fifo[(edge_offset - 1 - fe) & 15][1];
+
+      const int fec = code_triangle & 15;
+      if (fec < fec_max) {
+        // Third vertex is new, or a recent one
+        c = fec == 0 ? next
+                     : vertex_fifo[(vertex_offset - 1 - size_t(fec)) & 15];
+        if (fec == 0) ++next;
+        push_vertex(c, fec == 0);
+      } else {
+        // Third vertex is given relative to the last free index
+        c = last = fec != 15 ? last + uint32_t(fec - (fec ^ 3))
+                             : decode_index(data, last);
+        push_vertex(c, true);
+      }
+      push_edge(c, b);
+      push_edge(a, c);
+    } else {
+      int fea, feb, fec;
+      if (code_triangle < 0xfe) {
+        // Common vertex combinations are looked up in the code table
+        const unsigned char code_aux = code_table[code_triangle & 15];
+        fea = 0;
+        feb = code_aux >> 4;
+        fec = code_aux & 15;
+      } else {
+        const unsigned char code_aux = *data++;
+        fea = code_triangle == 0xfe ? 0 : 15;
+        feb = code_aux >> 4;
+        fec = code_aux & 15;
+        // Restart of the new vertex counter
+        if (code_aux == 0) next = 0;
+      }
+
+      a = fea == 0 ? next++ : 0;
+      b = feb == 0 ? next++ : vertex_fifo[(vertex_offset - size_t(feb)) & 15];
+      c = fec == 0 ? next++ : vertex_fifo[(vertex_offset - size_t(fec)) & 15];
+      if (fea == 15) last = a = decode_index(data, last);
+      if (feb == 15) last = b = decode_index(data, last);
+      if (fec == 15) last = c = decode_index(data, last);
+
+      push_vertex(a, true);
+      push_vertex(b, feb == 0 || feb == 15);
+      push_vertex(c, fec == 0 || fec == 15);
+      push_edge(b, a);
+      push_edge(c, b);
+      push_edge(a, c);
+    }
+
+    write_index(destination, i + 0, index_size, a);
+    write_index(destination, i + 1, index_size, b);
+    write_index(destination, i + 2, index_size, c);
+  }
+
+  check(data == data_safe_end, "invalid index data size");
+}
+
+void meshopt::decode_index_sequence(unsigned char* destination, size_t count,
+                                    size_t index_size,
+                                    const unsigned char* source,
+                                    size_t source_size) {
+  check(index_size == 2 || index_size == 4, "invalid index size");
+  // Header, at least one byte per index, and a 4 bytes tail
+  check(source_size >= 1 + count + 4, "truncated index data");
+  check((source[0] & 0xf0) == sequence_header, "not an index sequence");
+  check((source[0] & 0x0f) <= decode_index_version,
+        "unsupported index codec version");
+
+  const unsigned char* data = source + 1;
+  const unsigned char* data_safe_end = source + source_size - 4;
+
+  // Deltas are relative to one of two baselines, chosen by the low bit
+  uint32_t last[2] = {0, 0};
+  for (size_t i = 0; i < count; ++i) {
+    // An index reads at most 5 bytes, which the tail pads
+    check(data < data_safe_end, "truncated index data");
+
+    const uint32_t value = decode_vbyte(data);
+    const uint32_t baseline = value & 1;
+    const uint32_t index = last[baseline] + unzigzag32(value >> 1);
+    last[baseline] = index;
+    write_index(destination, i, index_size, index);
+  }
+
+  check(data == data_safe_end, "invalid index data size");
+}
+
+void meshopt::decode_filter_octahedral(unsigned char* data, size_t count,
+                                       size_t byte_stride) {
+  // 4 components of 8 or 16 bits, the 4th one is left untouched
+  if (byte_stride == 4)
+    decode_octahedral<int8_t>(data, count, byte_stride);
+  else if (byte_stride == 8)
+    decode_octahedral<int16_t>(data, count, byte_stride);
+  else
+    check(false, "invalid stride for the octahedral filter");
+}
+
+void meshopt::decode_filter_quaternion(unsigned char* data, size_t count,
+                                       size_t byte_stride) {
+  check(byte_stride == 8, "invalid stride for the quaternion filter");
+
+  const float scale = 1.f / std::sqrt(2.f);
+  for (size_t i = 0; i < count; ++i) {
+    unsigned char* element = data + i * byte_stride;
+
+    // The 4th component holds the index of the largest component, which is
+    // dropped, and the scale of the 3 others
+    const int16_t packed = load<int16_t>(element + 6);
+    const float component_scale = scale / float(packed | 3);
+    const float x = float(load<int16_t>(element)) * component_scale;
+    const float y = float(load<int16_t>(element + 2)) * component_scale;
+    const float z = float(load<int16_t>(element + 4)) * component_scale;
+    const float ww = 1.f - x * x - y * y - z * z;
+    const float w = std::sqrt(ww >= 0.f ? ww : 0.f);
+
+    const size_t largest = size_t(packed & 3);
+    store(element + 2 * ((largest + 1) & 3), round_to<int16_t>(x * 32767.f));
+    store(element + 2 * ((largest + 2) & 3), round_to<int16_t>(y * 32767.f));
+    store(element + 2 * ((largest + 3) & 3), round_to<int16_t>(z * 32767.f));
+    store(element + 2 * largest, round_to<int16_t>(w * 32767.f));
+  }
+}
+
+void meshopt::decode_filter_exponential(unsigned char* data, size_t count,
+                                        size_t byte_stride) {
+  check(byte_stride % 4 == 0, "invalid stride for the exponential filter");
+
+  // Each 32 bits value is a 24 bits signed mantissa and an 8 bits signed
+  // exponent
+  const size_t nb_values = count * byte_stride / 4;
+  for (size_t i = 0; i < nb_values; ++i) {
+    const uint32_t packed = load<uint32_t>(data + i * 4);
+    const int32_t mantissa = int32_t(packed << 8) >> 8;
+    const int32_t exponent = int32_t(packed) >> 24;
+    store(data + i * 4,
+          float(std::ldexp(double(mantissa), int(exponent))));
+  }
+}
+
+meshopt_decode_report gltf_insight::decode_meshopt_buffer_views(
+    const tinygltf::Model& model, buffer_data::overrides& buffers,
+    size_t nb_threads) {
+  using clock = std::chrono::steady_clock;
+
+  std::vector<compressed_view> views;
+  for (size_t i = 0; i < model.bufferViews.size(); ++i) {
+    const auto& extensions = model.bufferViews[i].extensions;
+    const auto found = extensions.find("EXT_meshopt_compression");
+    if (found == extensions.end() || !found->second.IsObject()) continue;
+
+    const auto& extension = found->second;
+    compressed_view view;
+    view.buffer_view = int(i);
+    view.buffer = get_int_value(extension, "buffer", -1);
+    view.byte_offset = json_size(extension, "byteOffset");
+    view.byte_length = json_size(extension, "byteLength");
+    view.byte_stride = json_size(extension, "byteStride");
+    view.count = json_size(extension, "count");
+    view.mode = json_string(extension, "mode", "");
+    view.filter = json_string(extension, "filter", "NONE");
+    views.push_back(view);
+  }
+
+  meshopt_decode_report report;
+  report.nb_buffer_views = views.size();
+  report.nb_threads = parallel_for_thread_count(views.size(), nb_threads);
+  std::vector<double> view_ms(views.size());
+
+  // The overrides are only registered once all threads are done
+  std::vector<std::shared_ptr<std::vector<unsigned char>>> decoded(
+      views.size());
+  const auto decode_start = clock::now();
+  parallel_for(views.size(), nb_threads, [&](size_t i) {
+    const auto view_start = clock::now();
+    const auto& view = views[i];
+
+    decoded[i] = std::make_shared<std::vector<unsigned char>>();
+    try {
+      decode_view(model, buffers, view, *decoded[i]);
+    } catch (const std::exception& e) {
+      throw std::runtime_error("Cannot decode bufferView " +
+                               std::to_string(view.buffer_view) + ": " +
+                               e.what());
+    }
+
+    view_ms[i] =
+        std::chrono::duration<double, std::milli>(clock::now() - view_start)
+            .count();
+  });
+
+  report.decode_wall_ms =
+      std::chrono::duration<double, std::milli>(clock::now() - decode_start)
+          .count();
+  for (const double ms : view_ms) report.decode_cpu_ms += ms;
+  for (size_t i = 0; i < views.size(); ++i) {
+    const auto& view = views[i];
+    report.encoded_bytes += view.byte_length;
+    report.decoded_bytes += view.count * view.byte_stride;
+
+    buffer_data::external_bytes bytes;
+    bytes.data = decoded[i]->data();
+    bytes.size = decoded[i]->size();
+    bytes.owner = std::move(decoded[i]);
+    buffers.override_buffer_view(view.buffer_view, std::move(bytes));
+  }
+
+  return report;
+}
@@ -0,0 +1,96 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include <cstddef>
+
+#include "buffer_data.hh"
+#include "parallel_for.hh"
+#include "tiny_gltf.h"
+
+namespace gltf_insight {
+
+/// Decoders for the bitstreams of EXT_meshopt_compression, as produced by
+/// meshoptimizer (gltfpack...). They throw std::runtime_error on malformed
+/// input.
+namespace meshopt {
+
+/// Vertex data, `count` elements of `byte_stride` bytes (a multiple of 4, up
+/// to 256). Used by the "ATTRIBUTES" mode
+void decode_vertex_buffer(unsigned char* destination, size_t count,
+                          size_t byte_stride, const unsigned char* source,
+                          size_t source_size);
+
+/// Triangle list indices of 2 or 4 bytes. Used by the "TRIANGLES" mode
+void decode_index_buffer(unsigned char* destination, size_t count,
+                         size_t index_size, const unsigned char* source,
+                         size_t source_size);
+
+/// Any other index sequence of 2 or 4 bytes. Used by the "INDICES" mode
+void decode_index_sequence(unsigned char* destination, size_t count,
+                           size_t index_size, const unsigned char* source,
+                           size_t source_size);
+
+/// Filters, applied in place to the output of `decode_vertex_buffer`
+void decode_filter_octahedral(unsigned char* data, size_t count,
+                              size_t byte_stride);
+void decode_filter_quaternion(unsigned char* data, size_t count,
+                              size_t byte_stride);
+void decode_filter_exponential(unsigned char* data, size_t count,
+                               size_t byte_stride);
+
+}  // namespace meshopt
+
+/// Statistics of a `decode_meshopt_buffer_views` call
+struct meshopt_decode_report {
+  size_t nb_buffer_views = 0;
+  size_t nb_threads = 1;
+  size_t encoded_bytes = 0;
+  size_t decoded_bytes = 0;
+  double decode_wall_ms = 0.0;
+  double decode_cpu_ms = 0.0;
+
+  /// See `gltf_insight::work_overlap`
+  double work_overlap() const {
+    return gltf_insight::work_overlap(decode_cpu_ms, decode_wall_ms);
+  }
+
+  /// Decoded bytes produced per second of wall time, in GB/s
+  double throughput() const {
+    return decode_wall_ms > 0.0
+               ? double(decoded_bytes) / (decode_wall_ms * 1e6)
+               : 0.0;
+  }
+};
+
+/// Decode every bufferView of `model` compressed with EXT_meshopt_compression,
+/// using up to `nb_threads` threads (0 means one per core). The decoded data is
+/// registered as the content of the bufferView in `buffers`, the overrides
+/// of `model`, so accessors read it transparently.
+/// Throws std::runtime_error if a bufferView cannot be decoded.
+meshopt_decode_report decode_meshopt_buffer_views(
+    const tinygltf::Model& model, buffer_data::overrides& buffers,
+    size_t nb_threads);
+
+}  // namespace gltf_insight
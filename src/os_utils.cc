@@ -111,3 +111,134 @@ bool os_utils::open_url(const std::string& url) {
   return true;
 }
 // end of open_url
+
+// cache_directory
+std::string os_utils::cache_directory() {
+#if defined(OS_UTILS_WINDOWS)
+  const char* local_app_data = std::getenv("LOCALAPPDATA");
+  return local_app_data ? local_app_data : "";
+#elif defined(OS_UTILS_WEB)
+  // Nothing survives a page reload
+  return "";
+#elif defined(OS_UTILS_APPLE)
+  const char* home = std::getenv("HOME");
+  return home ? std::string(home) + "/Library/Caches" : "";
+#elif defined(OS_UTILS_UNIX)
+  const char* xdg_cache_home = std::getenv("XDG_CACHE_HOME");
+  if (xdg_cache_home && *xdg_cache_home) return xdg_cache_home;
+  const char* home = std::getenv("HOME");
+  return home ? std::string(home) + "/.cache" : "";
+#else
+  return "";
+#endif
+}
+// end of cache_directory
+
+// replace_file
+#include <cstdio>
+
+bool os_utils::replace_file(const std::string& from, const std::string& to) {
+#if defined(OS_UTILS_WINDOWS)
+  return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  // rename() replaces the destination atomically on POSIX systems
+  return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+// end of replace_file
+
+// mapped_file
+#if defined(OS_UTILS_UNIX) && !defined(OS_UTILS_WEB)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#elif !defined(OS_UTILS_WINDOWS)
+#include <fstream>
+#endif
+
+bool os_utils::mapped_file::open(const std::string& path) {
+  close();
+
+#if defined(OS_UTILS_WINDOWS)
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  // The mapping object keeps a reference to the file
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping) return false;
+
+  const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!view) {
+    CloseHandle(mapping);
+    return false;
+  }
+
+  handle_ = mapping;
+  data_ = static_cast<const unsigned char*>(view);
+  size_ = size_t(file_size.QuadPart);
+#elif defined(OS_UTILS_UNIX) && !defined(OS_UTILS_WEB)
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  void* view = mmap(nullptr, size_t(file_stat.st_size), PROT_READ,
+                    MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (view == MAP_FAILED) return false;
+
+  data_ = static_cast<const unsigned char*>(view);
+  size_ = size_t(file_stat.st_size);
+#else
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) return false;
+  const auto file_size = file.tellg();
+  if (file_size <= 0) return false;
+  fallback_.resize(size_t(file_size));
+  file.seekg(0);
+  if (!file.read(reinterpret_cast<char*>(fallback_.data()),
+                 std::streamsize(file_size))) {
+    fallback_.clear();
+    return false;
+  }
+
+  data_ = fallback_.data();
+  size_ = fallback_.size();
+#endif
+
+  return true;
+}
+
+void os_utils::mapped_file::close() {
+  if (!data_) return;
+
+#if defined(OS_UTILS_WINDOWS)
+  UnmapViewOfFile(data_);
+  CloseHandle(static_cast<HANDLE>(handle_));
+#elif defined(OS_UTILS_UNIX) && !defined(OS_UTILS_WEB)
+  munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+
+  std::vector<unsigned char>().swap(fallback_);
+  data_ = nullptr;
+  size_ = 0;
+  handle_ = nullptr;
+}
+
+os_utils::mapped_file::~mapped_file() { close(); }
+// end of mapped_file
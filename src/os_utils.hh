@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
 /// Lose collection of wrapping of operating system APIs
 namespace os_utils {
@@ -13,6 +15,37 @@ bool mkdir_from_filepath(const std::string& file_name);
 /// Open an URL
 bool open_url(const std::string& url);
 
+/// Per user directory for cached data (e.g. ~/.cache). Empty if the platform
+/// doesn't have one
+std::string cache_directory();
+
+/// Rename `from` to `to`, replacing `to` if it exists
+bool replace_file(const std::string& from, const std::string& to);
+
 /// Get the detected platform
 std::string platform();
+
+/// Read-only memory mapping of a whole file. On platforms without mmap, the
+/// file is read into memory instead.
+class mapped_file {
+ public:
+  mapped_file() = default;
+  ~mapped_file();
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  /// Map the file, returns false on error
+  bool open(const std::string& path);
+  void close();
+
+  bool is_open() const { return data_ != nullptr; }
+  const unsigned char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const unsigned char* data_ = nullptr;
+  size_t size_ = 0;
+  void* handle_ = nullptr;  // Win32 file mapping object
+  std::vector<unsigned char> fallback_;
+};
 }  // namespace os_utils
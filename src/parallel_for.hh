@@ -0,0 +1,103 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gltf_insight {
+
+/// Number of threads to use when the user didn't ask for a specific count
+inline size_t default_thread_count() {
+  return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+/// Number of threads `parallel_for` really uses for `count` items
+inline size_t parallel_for_thread_count(size_t count, size_t nb_threads) {
+#ifdef __EMSCRIPTEN__
+  // No pthread in our emscripten build
+  (void)count;
+  (void)nb_threads;
+  return 1;
+#else
+  if (nb_threads == 0) nb_threads = default_thread_count();
+  return std::max<size_t>(1, std::min(nb_threads, count));
+#endif
+}
+
+/// Time spent in the work items of a `parallel_for`, added up, divided by its
+/// wall time. The items slow each other down when they run together (memory
+/// bandwidth, allocator, turbo clocks), so this only tells how much of the
+/// work overlapped. It is not the speedup over a serial run, to get that time
+/// the same load with `--load-threads 1`
+inline double work_overlap(double work_ms, double wall_ms) {
+  return wall_ms > 0.0 ? work_ms / wall_ms : 1.0;
+}
+
+/// Call `function(i)` for every i in [0, count) using up to `nb_threads`
+/// threads (0 means `default_thread_count()`). Work items are handed out one by
+/// one, so uneven item costs balance themselves. The calling thread takes part
+/// in the work. If an item throws, remaining items are skipped and the first
+/// exception is rethrown here once every thread has finished.
+template <typename Function>
+void parallel_for(size_t count, size_t nb_threads, Function function) {
+  nb_threads = parallel_for_thread_count(count, nb_threads);
+  if (nb_threads == 1) {
+    for (size_t i = 0; i < count; ++i) function(i);
+    return;
+  }
+
+  std::atomic<size_t> next_item{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  const auto worker = [&] {
+    for (;;) {
+      const size_t i = next_item++;
+      if (i >= count) return;
+      try {
+        function(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) error = std::current_exception();
+        next_item = count;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(nb_threads - 1);
+  for (size_t t = 1; t < nb_threads; ++t) threads.emplace_back(worker);
+  worker();
+  for (auto& thread : threads) thread.join();
+
+  if (error) std::rethrow_exception(error);
+}
+
+}  // namespace gltf_insight
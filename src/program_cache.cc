@@ -0,0 +1,65 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "program_cache.hh"
+
+using namespace gltf_insight;
+using cache_file::read_value;
+using cache_file::write_value;
+
+namespace {
+constexpr uint32_t cache_magic = 0x42504947;  // "GIPB"
+constexpr uint32_t cache_version = 1;
+constexpr size_t header_size = 4 * sizeof(uint32_t);
+}  // namespace
+
+bool program_binary_cache::load(uint64_t hash, program_binary& binary) const {
+  binary = program_binary();
+
+  auto file = files_.map(hash, cache_magic, cache_version);
+  if (!file) return false;
+
+  const unsigned char* data = file->data();
+  const size_t size = file->size();
+  if (size <= header_size) return false;
+
+  binary.format = read_value<uint32_t>(data + 8);
+  binary.data = data + header_size;
+  binary.size = size - header_size;
+  binary.mapping = std::move(file);
+  return true;
+}
+
+bool program_binary_cache::store(uint64_t hash,
+                                 const program_binary& binary) const {
+  if (binary.size == 0) return false;
+
+  const auto write_binary = [&](std::ofstream& file) {
+    write_value(file, binary.format);
+    write_value(file, uint32_t(0));
+    file.write(reinterpret_cast<const char*>(binary.data),
+               std::streamsize(binary.size));
+  };
+
+  return files_.store(hash, cache_magic, cache_version, write_binary);
+}
@@ -0,0 +1,73 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "cache_file.hh"
+#include "os_utils.hh"
+
+namespace gltf_insight {
+
+/// A linked program as returned by glGetProgramBinary
+struct program_binary {
+  uint32_t format = 0;
+  const unsigned char* data = nullptr;
+  size_t size = 0;
+  /// Owner of `data` once loaded from the cache
+  std::shared_ptr<os_utils::mapped_file> mapping;
+};
+
+/// Directory of linked shader programs, keyed by a hash of their sources and
+/// of the driver that linked them. Each entry is a flat file:
+///
+///   header : magic, version, binary format (3 x uint32), padding (uint32)
+///   binary : the bytes given by the driver, up to the end of the file
+///
+/// Drivers can refuse a binary they gave back earlier, after an update for
+/// instance, so a loaded binary may still have to be compiled again.
+class program_binary_cache {
+ public:
+  /// Use `directory`, it is created if needed. Returns false and leaves the
+  /// cache disabled if it can't be used
+  bool open(const std::string& directory) { return files_.open(directory); }
+
+  bool enabled() const { return files_.enabled(); }
+
+  /// Map the binary stored for `hash`. Returns false on a miss or if the file
+  /// is not valid
+  bool load(uint64_t hash, program_binary& binary) const;
+
+  /// Store `binary` for `hash`. The file is written under a temporary name
+  /// and then renamed, so a reader never sees it half written
+  bool store(uint64_t hash, const program_binary& binary) const;
+
+ private:
+  cache_file::directory files_{"program"};
+};
+
+}  // namespace gltf_insight
@@ -0,0 +1,140 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "scene_cache.hh"
+
+#include "build_identity.hh"
+#include "draco_decoder.hh"
+#include "fnv1a.hh"
+
+#ifndef GLTF_INSIGHT_VERSION
+#define GLTF_INSIGHT_VERSION "unknown"
+#endif
+
+using namespace gltf_insight;
+using cache_file::read_value;
+using cache_file::write_value;
+
+namespace {
+constexpr uint32_t cache_magic = 0x43534947;  // "GISC"
+
+// Bump this when what is stored, or how it is computed, changes
+constexpr uint32_t cache_version = 5;
+
+constexpr size_t header_size = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+constexpr size_t array_header_size = 2 * sizeof(uint64_t);
+constexpr size_t array_alignment = 16;
+
+size_t align_up(size_t offset) {
+  return cache_file::align_up(offset, array_alignment);
+}
+
+// Identity of the build that decoded the meshes: its version, its sources
+// (GLTF_INSIGHT_SOURCES_HASH) and the optional decoders it has
+uint64_t build_identity_hash() {
+  std::string identity = GLTF_INSIGHT_VERSION " " GLTF_INSIGHT_SOURCES_HASH;
+  identity += draco_available() ? " draco" : " no-draco";
+  return fnv1a_64(reinterpret_cast<const unsigned char*>(identity.data()),
+                  identity.size());
+}
+}  // namespace
+
+uint64_t gltf_insight::scene_content_hash(const std::string& filename,
+                                          const tinygltf::Model& model) {
+  os_utils::mapped_file file;
+  if (!file.open(filename)) return 0;
+  uint64_t hash = fnv1a_64(file.data(), file.size());
+  file.close();
+
+  // Embedded buffers are part of the file already
+  for (const auto& buffer : model.buffers) {
+    if (buffer.uri.empty() || buffer.uri.compare(0, 5, "data:") == 0)
+      continue;
+    hash = fnv1a_64(buffer.data.data(), buffer.data.size(), hash);
+  }
+
+  return hash;
+}
+
+bool scene_cache::load(uint64_t hash, scene_cache_entry& entry) const {
+  entry.arrays.clear();
+  entry.mapping.reset();
+
+  auto file = files_.map(hash, cache_magic, cache_version);
+  if (!file) return false;
+
+  const unsigned char* data = file->data();
+  const size_t size = file->size();
+  if (size < header_size ||
+      read_value<uint64_t>(data + 8) != build_identity_hash())
+    return false;
+
+  const auto nb_arrays = read_value<uint64_t>(data + 16);
+  if (nb_arrays > (size - header_size) / array_header_size) return false;
+
+  std::vector<scene_cache_entry::array> arrays(static_cast<size_t>(nb_arrays));
+  for (size_t i = 0; i < arrays.size(); ++i) {
+    const unsigned char* array_header =
+        data + header_size + i * array_header_size;
+    const auto offset = read_value<uint64_t>(array_header);
+    const auto byte_size = read_value<uint64_t>(array_header + 8);
+    if (offset > size || byte_size > size - offset ||
+        offset % array_alignment != 0)
+      return false;
+
+    arrays[i].data = data + offset;
+    arrays[i].size = size_t(byte_size);
+  }
+
+  entry.arrays = std::move(arrays);
+  entry.mapping = std::move(file);
+  return true;
+}
+
+bool scene_cache::store(uint64_t hash, const scene_cache_entry& entry) const {
+  const auto write_arrays = [&](std::ofstream& file) {
+    write_value(file, build_identity_hash());
+    write_value(file, uint64_t(entry.arrays.size()));
+
+    size_t offset =
+        align_up(header_size + entry.arrays.size() * array_header_size);
+    for (const auto& array : entry.arrays) {
+      write_value(file, uint64_t(offset));
+      write_value(file, uint64_t(array.size));
+      offset = align_up(offset + array.size);
+    }
+
+    static const char padding[array_alignment] = {};
+    size_t written = header_size + entry.arrays.size() * array_header_size;
+    for (const auto& array : entry.arrays) {
+      file.write(padding, std::streamsize(align_up(written) - written));
+      written = align_up(written);
+
+      file.write(reinterpret_cast<const char*>(array.data),
+                 std::streamsize(array.size));
+      written += array.size;
+    }
+  };
+
+  return files_.store(hash, cache_magic, cache_version, write_arrays);
+}
@@ -0,0 +1,129 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cache_file.hh"
+#include "os_utils.hh"
+#include "tiny_gltf.h"
+
+namespace gltf_insight {
+
+/// Hash of everything the processed scene is derived from: the glTF file, and
+/// the external buffers it references
+uint64_t scene_content_hash(const std::string& filename,
+                            const tinygltf::Model& model);
+
+/// A list of arrays of plain data, that is either written to a cache file, or
+/// read from one. When read, the arrays point into a memory mapping of the
+/// file, that `mapping` keeps alive.
+struct scene_cache_entry {
+  struct array {
+    const unsigned char* data = nullptr;
+    size_t size = 0;  // in bytes
+  };
+
+  std::vector<array> arrays;
+  std::shared_ptr<os_utils::mapped_file> mapping;
+
+  /// Append `values`. They are referenced, not copied, and must outlive the
+  /// call to `scene_cache::store`
+  template <typename T>
+  void add(const std::vector<T>& values) {
+    add(values.data(), values.size());
+  }
+
+  template <typename T>
+  void add(const T* values, size_t count) {
+    array added;
+    added.data = reinterpret_cast<const unsigned char*>(values);
+    added.size = count * sizeof(T);
+    arrays.push_back(added);
+  }
+
+  /// Number of T in array `index`, or 0 if it doesn't exist or doesn't hold
+  /// a whole number of T
+  template <typename T>
+  size_t count(size_t index) const {
+    if (index >= arrays.size() || arrays[index].size % sizeof(T) != 0) return 0;
+    return arrays[index].size / sizeof(T);
+  }
+
+  /// Array `index` viewed as T. Arrays are 16 bytes aligned in the file
+  template <typename T>
+  const T* view(size_t index) const {
+    return index < arrays.size()
+               ? reinterpret_cast<const T*>(arrays[index].data)
+               : nullptr;
+  }
+
+  /// Copy array `index` to `values`
+  template <typename T>
+  void get(size_t index, std::vector<T>& values) const {
+    values.resize(count<T>(index));
+    if (!values.empty())
+      std::memcpy(values.data(), arrays[index].data,
+                  values.size() * sizeof(T));
+  }
+};
+
+/// Directory of processed scenes, keyed by `scene_content_hash`. A warm load
+/// maps the file and copies, or directly uses, the arrays it holds instead of
+/// decoding the glTF accessors again:
+///
+///   header : magic, format version, build identity hash, array count
+///            (2 x uint32, 2 x uint64)
+///   arrays : byte offset, byte size (2 x uint64), per array
+///   data   : content of every array, each one 16 bytes aligned
+///
+/// An entry written by another format version or build is seen as a miss, and
+/// replaced on the next store. Integers are in the byte order of the machine
+/// that wrote them.
+class scene_cache {
+ public:
+  /// Use `directory`, it is created if needed. Returns false and leaves the
+  /// cache disabled if it can't be used
+  bool open(const std::string& directory) { return files_.open(directory); }
+
+  bool enabled() const { return files_.enabled(); }
+
+  /// Map the entry stored for `hash`. Returns false on a miss or if the file
+  /// is not valid
+  bool load(uint64_t hash, scene_cache_entry& entry) const;
+
+  /// Store `entry` for `hash`. The file is written under a temporary name and
+  /// then renamed, so a reader never sees it half written
+  bool store(uint64_t hash, const scene_cache_entry& entry) const;
+
+ private:
+  cache_file::directory files_{"scene"};
+};
+
+}  // namespace gltf_insight
@@ -23,18 +23,139 @@ SOFTWARE.
 */
 #include "shader.hh"
 
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 
+#include "fnv1a.hh"
 #include "glm/gtc/type_ptr.hpp"
 #include "glm/matrix.hpp"
+#include "program_cache.hh"
+
+using gltf_insight::program_binary;
+using gltf_insight::program_binary_cache;
+
+namespace {
+/// Binaries are only valid for the driver that produced them, the key of a
+/// program covers both its sources and the driver
+uint64_t program_key(const std::string& vertex_source,
+                     const std::string& fragment_source) {
+  static const uint64_t driver_hash = [] {
+    uint64_t hash = gltf_insight::fnv1a_64_basis;
+    for (const GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+      const auto value = glGetString(name);
+      if (value)
+        hash = gltf_insight::fnv1a_64(
+            value, strlen(reinterpret_cast<const char*>(value)), hash);
+    }
+    return hash;
+  }();
+
+  uint64_t hash = gltf_insight::fnv1a_64(
+      reinterpret_cast<const unsigned char*>(vertex_source.c_str()),
+      vertex_source.size() + 1, driver_hash);
+  return gltf_insight::fnv1a_64(
+      reinterpret_cast<const unsigned char*>(fragment_source.c_str()),
+      fragment_source.size() + 1, hash);
+}
+
+bool program_binaries_usable(const program_binary_cache* binaries) {
+#ifndef __EMSCRIPTEN__
+  if (!binaries || !binaries->enabled()) return false;
+
+  static const bool supported = [] {
+    if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary) return false;
+    GLint nb_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nb_formats);
+    return nb_formats > 0;
+  }();
+  return supported;
+#else
+  // WebGL doesn't expose program binaries
+  (void)binaries;
+  return false;
+#endif
+}
+
+/// Link `program` from the binary stored for `key`
+bool load_program_binary(GLuint program, const program_binary_cache& binaries,
+                         uint64_t key) {
+#ifndef __EMSCRIPTEN__
+  program_binary binary;
+  if (!binaries.load(key, binary)) return false;
+
+  glProgramBinary(program, GLenum(binary.format), binary.data,
+                  GLsizei(binary.size));
+  GLint success = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  return success == GL_TRUE;
+#else
+  (void)program;
+  (void)binaries;
+  (void)key;
+  return false;
+#endif
+}
+
+bool store_program_binary(GLuint program, const program_binary_cache& binaries,
+                          uint64_t key) {
+#ifndef __EMSCRIPTEN__
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) return false;
+
+  std::vector<unsigned char> data(size_t(length), 0);
+  GLenum format = 0;
+  GLsizei written = 0;
+  glGetProgramBinary(program, length, &written, &format, data.data());
+  if (written <= 0) return false;
+
+  program_binary binary;
+  binary.format = uint32_t(format);
+  binary.data = data.data();
+  binary.size = size_t(written);
+  return binaries.store(key, binary);
+#else
+  (void)program;
+  (void)binaries;
+  (void)key;
+  return false;
+#endif
+}
+}  // namespace
+
+const char* uniform_name(uniform_id id) {
+  static const char* const names[] = {"active_vertex",
+                                      "active_joint",
+                                      "joint_palette_offset",
+                                      "mvp",
+                                      "model",
+                                      "normal",
+                                      "view_projection",
+                                      "instanced",
+                                      "debug_color"};
+  static_assert(sizeof names / sizeof names[0] == size_t(uniform_id::count),
+                "every uniform_id needs a name");
+  return names[size_t(id)];
+}
+
+const char* uniform_block_name(uniform_block block) {
+  static const char* const names[] = {"frame_block", "material_block"};
+  static_assert(
+      sizeof names / sizeof names[0] == size_t(uniform_block::count),
+      "every uniform_block needs a name");
+  return names[size_t(block)];
+}
 
 shader::shader(shader&& other) { *this = std::move(other); }
 
 shader& shader::operator=(shader&& other) {
   program_ = other.program_;
   shader_name_ = std::move(other.shader_name_);
+  uniform_locations_ = other.uniform_locations_;
   other.program_ = 0;
+  other.uniform_locations_.fill(-1);
   return *this;
 }
 
@@ -42,15 +163,25 @@ shader::~shader() {
   if (glIsProgram(program_) == GL_TRUE) glDeleteProgram(program_);
 }
 
-shader::shader() {}
+shader::shader() : program_(0) { uniform_locations_.fill(-1); }
+
+void shader::resolve_uniform_locations() {
+  for (size_t i = 0; i < uniform_locations_.size(); ++i)
+    uniform_locations_[i] =
+        glGetUniformLocation(program_, uniform_name(uniform_id(i)));
+
+  for (GLuint block = 0; block < GLuint(uniform_block::count); ++block) {
+    const auto index = glGetUniformBlockIndex(
+        program_, uniform_block_name(uniform_block(block)));
+    if (index != GL_INVALID_INDEX)
+      glUniformBlockBinding(program_, index, block);
+  }
+}
 
 shader::shader(const char* shader_name, const char* vertex_shader_source_code,
-               const char* fragment_shader_source_code)
+               const char* fragment_shader_source_code,
+               const program_binary_cache* binaries)
     : shader_name_(shader_name) {
-  std::cout << "Creating " << shader_name << "\n";
-
-  const GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-  const GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
   program_ = glCreateProgram();
 
 #ifdef __EMSCRIPTEN__
@@ -65,6 +196,19 @@ shader::shader(const char* shader_name, const char* vertex_shader_source_code,
       shader_preamble + std::string(vertex_shader_source_code);
   std::string frag_source =
       shader_preamble + std::string(fragment_shader_source_code);
+
+  const bool use_binaries = program_binaries_usable(binaries);
+  const uint64_t key = use_binaries ? program_key(vtx_source, frag_source) : 0;
+  if (use_binaries && load_program_binary(program_, *binaries, key)) {
+    std::cout << "Loaded " << shader_name << " from the shader cache\n";
+    resolve_uniform_locations();
+    return;
+  }
+
+  std::cout << "Creating " << shader_name << "\n";
+
+  const GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+  const GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
   const GLchar* vtx_source_ptrs[1] = {vtx_source.c_str()};
   const GLchar* frag_source_ptrs[1] = {frag_source.c_str()};
 
@@ -100,23 +244,29 @@ shader::shader(const char* shader_name, const char* vertex_shader_source_code,
   // Link shader
   glAttachShader(program_, vertex_shader);
   glAttachShader(program_, fragment_shader);
+#ifndef __EMSCRIPTEN__
+  if (use_binaries)
+    glProgramParameteri(program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
   glLinkProgram(program_);
 
   glGetProgramiv(program_, GL_LINK_STATUS, &success);
   if (!success) {
     glGetProgramInfoLog(program_, sizeof info_log, nullptr, info_log);
     std::cout << info_log << "\n";
+  } else if (use_binaries && !store_program_binary(program_, *binaries, key)) {
+    std::cerr << "Warn: cannot store " << shader_name_
+              << " in the shader cache\n";
   }
 
   glDeleteShader(vertex_shader);
   glDeleteShader(fragment_shader);
-}
 
-void shader::use() const {
-  glUseProgram(program_);
-  set_uniform("highlight_color", gltf_insight::configuration::highlight_color);
+  resolve_uniform_locations();
 }
 
+void shader::use() const { glUseProgram(program_); }
+
 const char* shader::get_name() const { return shader_name_.c_str(); }
 
 void shader::set_uniform(const char* name, const float value) const {
@@ -226,3 +376,45 @@ void shader::set_uniform(const char* name, size_t number_of_matrices,
 }
 
 GLuint shader::get_program() const { return program_; }
+
+void shader::set_uniform(uniform_id id, const float value) const {
+  const auto location = get_uniform_location(id);
+  if (location != -1) glUniform1f(location, value);
+}
+
+void shader::set_uniform(uniform_id id, const int value) const {
+  const auto location = get_uniform_location(id);
+  if (location != -1) glUniform1i(location, value);
+}
+
+void shader::set_uniform(uniform_id id, const glm::vec4& v) const {
+  const auto location = get_uniform_location(id);
+  if (location != -1) glUniform4f(location, v.x, v.y, v.z, v.w);
+}
+
+void shader::set_uniform(uniform_id id, const glm::vec3& v) const {
+  const auto location = get_uniform_location(id);
+  if (location != -1) glUniform3f(location, v.x, v.y, v.z);
+}
+
+void shader::set_uniform(uniform_id id, const glm::mat4& m) const {
+  const auto location = get_uniform_location(id);
+  if (location != -1)
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(m));
+}
+
+void shader::set_uniform(uniform_id id, const glm::mat3& m) const {
+  const auto location = get_uniform_location(id);
+  if (location != -1)
+    glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(m));
+}
+
+void shader::set_uniform(uniform_id id,
+                         const std::vector<glm::mat4>& matrices) const {
+  if (matrices.empty()) return;
+
+  const auto location = get_uniform_location(id);
+  if (location != -1)
+    glUniformMatrix4fv(location, GLsizei(matrices.size()), GL_FALSE,
+                       glm::value_ptr(matrices[0]));
+}
@@ -40,26 +40,68 @@ SOFTWARE.
 #pragma clang diagnostic pop
 #endif
 
+#include <array>
 #include <string>
 #include <vector>
 
 #include "configuration.hh"
 
+namespace gltf_insight {
+class program_binary_cache;
+}
+
+/// Uniforms set by the viewer for each draw. Their locations are looked up
+/// once, when the program is linked, so setting one is an array access
+enum class uniform_id : unsigned {
+  active_vertex,
+  active_joint,
+  joint_palette_offset,
+  mvp,
+  model,
+  normal,
+  view_projection,
+  instanced,
+  debug_color,
+  count
+};
+
+/// GLSL name of `id`
+const char* uniform_name(uniform_id id);
+
+/// std140 uniform blocks shared by the programs. The value of each one is the
+/// binding point its block is attached to
+enum class uniform_block : GLuint {
+  /// Camera and lighting, see `frame_uniforms`
+  frame,
+  /// Factors of the material being drawn, see `material_uniforms`
+  material,
+  count
+};
+
+/// GLSL name of `block`
+const char* uniform_block_name(uniform_block block);
+
 class shader {
   GLuint program_;
   std::string shader_name_;
+  std::array<GLint, size_t(uniform_id::count)> uniform_locations_;
+
+  void resolve_uniform_locations();
 
  public:
   // default ctor
   shader();
   // delegate ctor
   shader(const char* shader_name, const std::string& vertex_shader_source_code,
-         const std::string& fragment_shader_source_code)
+         const std::string& fragment_shader_source_code,
+         const gltf_insight::program_binary_cache* binaries = nullptr)
       : shader(shader_name, vertex_shader_source_code.c_str(),
-               fragment_shader_source_code.c_str()) {}
-  // actual ctor
+               fragment_shader_source_code.c_str(), binaries) {}
+  // actual ctor. When `binaries` is given, the linked program is looked up
+  // there first and stored there after a compilation
   shader(const char* shader_name, const char* vertex_shader_source_code,
-         const char* fragment_shader_source_code);
+         const char* fragment_shader_source_code,
+         const gltf_insight::program_binary_cache* binaries = nullptr);
   ~shader();
   shader(shader&& other);
   shader& operator=(shader&& other);
@@ -80,4 +122,17 @@ class shader {
                    const std::vector<glm::mat4>& matrices) const;
   void set_uniform(const char* name, size_t number_of_matrices,
                    float* data) const;
+
+  /// Location of `id` in this program, -1 if the program doesn't use it
+  GLint get_uniform_location(uniform_id id) const {
+    return uniform_locations_[size_t(id)];
+  }
+
+  void set_uniform(uniform_id id, const float value) const;
+  void set_uniform(uniform_id id, const int value) const;
+  void set_uniform(uniform_id id, const glm::vec4& v) const;
+  void set_uniform(uniform_id id, const glm::vec3& v) const;
+  void set_uniform(uniform_id id, const glm::mat4& m) const;
+  void set_uniform(uniform_id id, const glm::mat3& m) const;
+  void set_uniform(uniform_id id, const std::vector<glm::mat4>& matrices) const;
 };
@@ -0,0 +1,212 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "tangent_space.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include <glm/gtc/type_ptr.hpp>
+
+namespace gltf_insight {
+
+namespace {
+glm::vec3 position_of(const float* positions, size_t vertex) {
+  return glm::make_vec3(positions + 3 * vertex);
+}
+
+// Angle between two edges of a triangle that has an area
+float corner_angle(const glm::vec3& e1, const glm::vec3& e2) {
+  const float cosine = glm::dot(glm::normalize(e1), glm::normalize(e2));
+  return std::acos(glm::clamp(cosine, -1.f, 1.f));
+}
+}  // namespace
+
+tangent_space_generator::tangent_space_generator(
+    const std::vector<unsigned>& triangle_list,
+    const std::vector<float>& positions,
+    const std::vector<float>& texture_coords)
+    : indices(triangle_list),
+      uvs(texture_coords),
+      nb_vertices(positions.size() / 3) {
+  // Triangles referencing a vertex that doesn't exist are ignored
+  const size_t nb_triangles = indices.size() / 3;
+  const auto valid = [&](size_t triangle) {
+    return indices[3 * triangle + 0] < nb_vertices &&
+           indices[3 * triangle + 1] < nb_vertices &&
+           indices[3 * triangle + 2] < nb_vertices;
+  };
+
+  triangle_start.assign(nb_vertices + 1, 0);
+  for (size_t triangle = 0; triangle < nb_triangles; ++triangle) {
+    if (!valid(triangle)) continue;
+    for (size_t c = 0; c < 3; ++c)
+      ++triangle_start[indices[3 * triangle + c] + 1];
+  }
+  for (size_t vertex = 0; vertex < nb_vertices; ++vertex)
+    triangle_start[vertex + 1] += triangle_start[vertex];
+
+  triangles.resize(triangle_start.back());
+  std::vector<size_t> next(triangle_start.begin(), triangle_start.end() - 1);
+  for (size_t triangle = 0; triangle < nb_triangles; ++triangle) {
+    if (!valid(triangle)) continue;
+    for (size_t c = 0; c < 3; ++c)
+      triangles[next[indices[3 * triangle + c]]++] = triangle;
+  }
+
+  // Sorting the vertices by position puts the ones to weld next to each other
+  welded.resize(nb_vertices);
+  std::iota(welded.begin(), welded.end(), size_t(0));
+  const auto position_less = [&](size_t a, size_t b) {
+    return std::lexicographical_compare(
+        &positions[3 * a], &positions[3 * a + 3], &positions[3 * b],
+        &positions[3 * b + 3]);
+  };
+  std::sort(welded.begin(), welded.end(), position_less);
+
+  weld_group.resize(nb_vertices);
+  for (size_t i = 0; i < nb_vertices; ++i) {
+    if (i == 0 || position_less(welded[i - 1], welded[i]))
+      weld_start.push_back(i);
+    weld_group[welded[i]] = weld_start.size() - 1;
+  }
+  weld_start.push_back(nb_vertices);
+}
+
+glm::vec3 tangent_space_generator::normal(size_t vertex,
+                                          const float* positions) const {
+  glm::vec3 sum(0.f);
+
+  const size_t group = weld_group[vertex];
+  for (size_t w = weld_start[group]; w < weld_start[group + 1]; ++w) {
+    const size_t member = welded[w];
+    for (size_t i = triangle_start[member]; i < triangle_start[member + 1];
+         ++i) {
+      const unsigned* corners = &indices[3 * triangles[i]];
+      const size_t c =
+          size_t(std::find(corners, corners + 3, member) - corners);
+
+      const glm::vec3 p0 = position_of(positions, corners[c]);
+      const glm::vec3 e1 = position_of(positions, corners[(c + 1) % 3]) - p0;
+      const glm::vec3 e2 = position_of(positions, corners[(c + 2) % 3]) - p0;
+      const glm::vec3 face = glm::cross(e1, e2);
+      const float area = glm::length(face);
+      if (!(area > 0.f)) continue;
+
+      sum += corner_angle(e1, e2) / area * face;
+    }
+  }
+
+  const float length = glm::length(sum);
+  return length > 0.f ? sum / length : glm::vec3(0.f, 0.f, 1.f);
+}
+
+glm::vec4 tangent_space_generator::tangent(size_t vertex,
+                                           const float* positions,
+                                           const glm::vec3& normal) const {
+  // glTF puts the texture origin at the top left, MikkTSpace at the bottom
+  // left
+  const auto uv_of = [&](size_t index) {
+    return glm::vec2(uvs[2 * index], 1.f - uvs[2 * index + 1]);
+  };
+
+  glm::vec3 sum(0.f);
+  float handedness = 0.f;
+  if (uvs.size() >= 2 * nb_vertices) {
+    for (size_t i = triangle_start[vertex]; i < triangle_start[vertex + 1];
+         ++i) {
+      const unsigned* corners = &indices[3 * triangles[i]];
+      const size_t c =
+          size_t(std::find(corners, corners + 3, vertex) - corners);
+      const size_t i0 = corners[c];
+      const size_t i1 = corners[(c + 1) % 3];
+      const size_t i2 = corners[(c + 2) % 3];
+
+      const glm::vec3 p0 = position_of(positions, i0);
+      const glm::vec3 e1 = position_of(positions, i1) - p0;
+      const glm::vec3 e2 = position_of(positions, i2) - p0;
+      const glm::vec2 d1 = uv_of(i1) - uv_of(i0);
+      const glm::vec2 d2 = uv_of(i2) - uv_of(i0);
+      const float uv_area = d1.x * d2.y - d2.x * d1.y;
+      if (uv_area == 0.f || !(glm::length(glm::cross(e1, e2)) > 0.f)) continue;
+
+      // Direction of +u on the triangle, projected on the tangent plane of the
+      // vertex
+      glm::vec3 direction =
+          (uv_area > 0.f ? 1.f : -1.f) * (e1 * d2.y - e2 * d1.y);
+      direction -= glm::dot(normal, direction) * normal;
+      const float length = glm::length(direction);
+      if (!(length > 0.f)) continue;
+
+      const float angle = corner_angle(e1, e2);
+      sum += angle / length * direction;
+      handedness += uv_area > 0.f ? angle : -angle;
+    }
+  }
+
+  // Without a usable UV mapping, any direction of the tangent plane will do
+  if (!(glm::length(sum) > 0.f)) {
+    const glm::vec3 axis = std::abs(normal.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f)
+                                                     : glm::vec3(0.f, 1.f, 0.f);
+    sum = glm::cross(normal, axis);
+    if (!(glm::length(sum) > 0.f)) sum = glm::vec3(1.f, 0.f, 0.f);
+  }
+
+  return glm::vec4(glm::normalize(sum), handedness < 0.f ? -1.f : 1.f);
+}
+
+void tangent_space_generator::mark_dependents(
+    size_t vertex, std::vector<bool>& dependents) const {
+  dependents[vertex] = true;
+  for (size_t i = triangle_start[vertex]; i < triangle_start[vertex + 1]; ++i) {
+    const unsigned* corners = &indices[3 * triangles[i]];
+    for (size_t c = 0; c < 3; ++c) {
+      const size_t group = weld_group[corners[c]];
+      for (size_t w = weld_start[group]; w < weld_start[group + 1]; ++w)
+        dependents[welded[w]] = true;
+    }
+  }
+}
+
+void tangent_space_generator::generate_normals(
+    const std::vector<float>& positions, std::vector<float>& normals) const {
+  normals.resize(3 * nb_vertices);
+  for (size_t vertex = 0; vertex < nb_vertices; ++vertex) {
+    const glm::vec3 n = normal(vertex, positions.data());
+    std::copy(glm::value_ptr(n), glm::value_ptr(n) + 3, &normals[3 * vertex]);
+  }
+}
+
+void tangent_space_generator::generate_tangents(
+    const std::vector<float>& positions, const std::vector<float>& normals,
+    std::vector<float>& tangents) const {
+  tangents.resize(4 * nb_vertices);
+  for (size_t vertex = 0; vertex < nb_vertices; ++vertex) {
+    const glm::vec4 t = tangent(vertex, positions.data(),
+                                glm::make_vec3(&normals[3 * vertex]));
+    std::copy(glm::value_ptr(t), glm::value_ptr(t) + 4, &tangents[4 * vertex]);
+  }
+}
+
+}  // namespace gltf_insight
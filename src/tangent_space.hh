@@ -0,0 +1,91 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace gltf_insight {
+
+/// Generates the vertex normals and tangents of an indexed triangle list.
+///
+/// Normals are smooth, each triangle contributes its face normal weighted by
+/// the angle of the corner, and vertices at the same position are averaged
+/// together so UV seams don't show. Tangents follow the MikkTSpace
+/// conventions glTF asks for: the tangent points along +u, the bitangent is
+/// cross(normal, tangent.xyz) * tangent.w, and both are computed with the
+/// texture origin at the bottom left. Vertices are never split, a vertex
+/// shared by mirrored and unmirrored triangles takes the handedness that
+/// covers the most corner angle.
+///
+/// Per vertex queries take the vertex positions as a parameter, so the frames
+/// of a morphed mesh can be evaluated against the topology of the base mesh.
+class tangent_space_generator {
+ public:
+  /// `indices` is a triangle list, `uvs` may be empty if no tangents are
+  /// needed. Both are referenced and must outlive the generator. Vertices at
+  /// the same `positions` are welded for normal generation
+  tangent_space_generator(const std::vector<unsigned>& indices,
+                          const std::vector<float>& positions,
+                          const std::vector<float>& uvs);
+
+  size_t vertex_count() const { return nb_vertices; }
+
+  /// Smooth normal of `vertex`, +Z if no triangle with an area uses it
+  glm::vec3 normal(size_t vertex, const float* positions) const;
+
+  /// Unit tangent of `vertex` orthogonal to `normal`, handedness in w
+  glm::vec4 tangent(size_t vertex, const float* positions,
+                    const glm::vec3& normal) const;
+
+  /// Flag in `dependents` every vertex whose normal or tangent changes when
+  /// `vertex` moves
+  void mark_dependents(size_t vertex, std::vector<bool>& dependents) const;
+
+  /// Normals of every vertex at the base positions, 3 floats per vertex
+  void generate_normals(const std::vector<float>& positions,
+                        std::vector<float>& normals) const;
+
+  /// Tangents of every vertex at the base positions, 4 floats per vertex
+  void generate_tangents(const std::vector<float>& positions,
+                         const std::vector<float>& normals,
+                         std::vector<float>& tangents) const;
+
+ private:
+  const std::vector<unsigned>& indices;
+  const std::vector<float>& uvs;
+  size_t nb_vertices;
+
+  // Compressed lists of the triangles using each vertex, and of the welded
+  // vertices sharing the position of each vertex
+  std::vector<size_t> triangle_start;
+  std::vector<size_t> triangles;
+  std::vector<size_t> weld_start;
+  std::vector<size_t> welded;
+  std::vector<size_t> weld_group;
+};
+
+}  // namespace gltf_insight
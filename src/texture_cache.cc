@@ -0,0 +1,179 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "texture_cache.hh"
+
+#include <algorithm>
+
+using namespace gltf_insight;
+using cache_file::read_value;
+using cache_file::write_value;
+
+namespace {
+constexpr uint32_t cache_magic = 0x58544947;  // "GITX"
+constexpr uint32_t cache_version = 1;
+constexpr size_t header_size = 4 * sizeof(uint32_t);
+constexpr size_t level_header_size = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+constexpr size_t level_alignment = 16;
+
+size_t align_up(size_t offset) {
+  return cache_file::align_up(offset, level_alignment);
+}
+
+size_t level_size(int width, int height) {
+  return size_t(width) * size_t(height) * 4;
+}
+
+decoded_image half_size(const mip_level& source) {
+  decoded_image half;
+  half.width = std::max(1, source.width / 2);
+  half.height = std::max(1, source.height / 2);
+  half.pixels.resize(level_size(half.width, half.height));
+
+  const auto texel = [&](int x, int y, size_t c) {
+    return unsigned(
+        source.pixels[(size_t(y) * size_t(source.width) + size_t(x)) * 4 + c]);
+  };
+
+  for (int y = 0; y < half.height; ++y) {
+    const int y0 = std::min(2 * y, source.height - 1);
+    const int y1 = std::min(2 * y + 1, source.height - 1);
+    for (int x = 0; x < half.width; ++x) {
+      const int x0 = std::min(2 * x, source.width - 1);
+      const int x1 = std::min(2 * x + 1, source.width - 1);
+      for (size_t c = 0; c < 4; ++c) {
+        const unsigned sum = texel(x0, y0, c) + texel(x1, y0, c) +
+                             texel(x0, y1, c) + texel(x1, y1, c);
+        half.pixels[(size_t(y) * size_t(half.width) + size_t(x)) * 4 + c] =
+            static_cast<unsigned char>((sum + 2) / 4);
+      }
+    }
+  }
+
+  return half;
+}
+}  // namespace
+
+void mip_chain::clear() {
+  levels.clear();
+  owned_levels.clear();
+  mapping.reset();
+}
+
+void gltf_insight::build_mip_chain(decoded_image full, mip_chain& chain) {
+  chain.clear();
+
+  // Levels are never moved once added, so pointers to their pixels stay valid
+  size_t nb_levels = 1;
+  for (int size = std::max(full.width, full.height); size > 1; size /= 2)
+    ++nb_levels;
+  chain.owned_levels.reserve(nb_levels);
+
+  chain.owned_levels.push_back(std::move(full));
+  for (;;) {
+    const auto& last = chain.owned_levels.back();
+    mip_level level;
+    level.width = last.width;
+    level.height = last.height;
+    level.pixels = last.pixels.data();
+    chain.levels.push_back(level);
+
+    if (level.width == 1 && level.height == 1) break;
+    chain.owned_levels.push_back(half_size(level));
+  }
+}
+
+bool texture_cache::load(uint64_t hash, mip_chain& chain) const {
+  chain.clear();
+
+  auto file = files_.map(hash, cache_magic, cache_version);
+  if (!file) return false;
+
+  const unsigned char* data = file->data();
+  const size_t size = file->size();
+  if (size < header_size) return false;
+
+  const size_t nb_levels = read_value<uint32_t>(data + 8);
+  if (nb_levels == 0 || header_size + nb_levels * level_header_size > size)
+    return false;
+
+  std::vector<mip_level> levels(nb_levels);
+  for (size_t i = 0; i < nb_levels; ++i) {
+    const unsigned char* level_header =
+        data + header_size + i * level_header_size;
+    const auto width = read_value<uint32_t>(level_header);
+    const auto height = read_value<uint32_t>(level_header + 4);
+    const auto offset = read_value<uint64_t>(level_header + 8);
+
+    // Each level has to be the half of the previous one
+    const bool expected_size =
+        i == 0 ? width > 0 && height > 0
+               : int(width) == std::max(1, levels[i - 1].width / 2) &&
+                     int(height) == std::max(1, levels[i - 1].height / 2);
+    if (!expected_size || width > 1u << 16 || height > 1u << 16 ||
+        offset > size || level_size(int(width), int(height)) > size - offset)
+      return false;
+
+    levels[i].width = int(width);
+    levels[i].height = int(height);
+    levels[i].pixels = data + offset;
+  }
+
+  if (levels.back().width != 1 || levels.back().height != 1) return false;
+
+  chain.levels = std::move(levels);
+  chain.mapping = std::move(file);
+  return true;
+}
+
+bool texture_cache::store(uint64_t hash, const mip_chain& chain) const {
+  if (chain.empty()) return false;
+
+  const auto write_levels = [&](std::ofstream& file) {
+    write_value(file, uint32_t(chain.levels.size()));
+    write_value(file, uint32_t(0));
+
+    size_t offset =
+        align_up(header_size + chain.levels.size() * level_header_size);
+    for (const auto& level : chain.levels) {
+      write_value(file, uint32_t(level.width));
+      write_value(file, uint32_t(level.height));
+      write_value(file, uint64_t(offset));
+      offset = align_up(offset + level_size(level.width, level.height));
+    }
+
+    static const char padding[level_alignment] = {};
+    size_t written = header_size + chain.levels.size() * level_header_size;
+    for (const auto& level : chain.levels) {
+      file.write(padding, std::streamsize(align_up(written) - written));
+      written = align_up(written);
+
+      const size_t nb_bytes = level_size(level.width, level.height);
+      file.write(reinterpret_cast<const char*>(level.pixels),
+                 std::streamsize(nb_bytes));
+      written += nb_bytes;
+    }
+  };
+
+  return files_.store(hash, cache_magic, cache_version, write_levels);
+}
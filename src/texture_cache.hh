@@ -0,0 +1,89 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cache_file.hh"
+#include "image_decoder.hh"
+#include "os_utils.hh"
+
+namespace gltf_insight {
+
+/// One level of a mip chain, tightly packed 8 bits RGBA
+struct mip_level {
+  int width = 0;
+  int height = 0;
+  const unsigned char* pixels = nullptr;
+};
+
+/// Every mip level of a texture, from the full resolution down to 1x1. The
+/// pixels are either owned by `owned_levels`, or live in `mapping`
+struct mip_chain {
+  std::vector<mip_level> levels;
+  std::vector<decoded_image> owned_levels;
+  std::shared_ptr<os_utils::mapped_file> mapping;
+
+  bool empty() const { return levels.empty(); }
+
+  /// Free the pixels
+  void clear();
+};
+
+/// Build the whole chain from `full`, with a box filter and the level sizes
+/// OpenGL uses
+void build_mip_chain(decoded_image full, mip_chain& chain);
+
+/// Directory of decoded textures, keyed by a hash of the encoded image. Each
+/// entry is a flat file holding every mip level, ready to be uploaded as is
+/// from a memory mapping:
+///
+///   header : magic, version, level count (3 x uint32), padding (uint32)
+///   levels : width, height (2 x uint32), byte offset (uint64), per level
+///   pixels : RGBA8 rows of every level, each level 16 bytes aligned
+class texture_cache {
+ public:
+  /// Use `directory`, it is created if needed. Returns false and leaves the
+  /// cache disabled if it can't be used
+  bool open(const std::string& directory) { return files_.open(directory); }
+
+  bool enabled() const { return files_.enabled(); }
+
+  /// Map the chain stored for `hash`. Returns false on a miss or if the file
+  /// is not valid
+  bool load(uint64_t hash, mip_chain& chain) const;
+
+  /// Store `chain` for `hash`. The file is written under a temporary name and
+  /// then renamed, so a reader never sees it half written
+  bool store(uint64_t hash, const mip_chain& chain) const;
+
+ private:
+  cache_file::directory files_{"mips"};
+};
+
+}  // namespace gltf_insight
@@ -0,0 +1,252 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "texture_streamer.hh"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <stdexcept>
+
+#include "fnv1a.hh"
+#include "parallel_for.hh"
+
+using namespace gltf_insight;
+
+namespace {
+// Largest side of the preview put in the smallest mip levels
+constexpr int preview_size = 64;
+}  // namespace
+
+texture_streamer::~texture_streamer() { stop(); }
+
+void texture_streamer::start(size_t nb_threads) {
+  stop();
+
+#ifdef __EMSCRIPTEN__
+  // No pthread in our emscripten build, `update` decodes on the main thread
+  (void)nb_threads;
+#else
+  if (nb_threads == 0)
+    nb_threads = std::max<size_t>(1, default_thread_count() - 1);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  stopping_ = false;
+  for (size_t i = 0; i < nb_threads; ++i)
+    workers_.emplace_back(&texture_streamer::work, this);
+#endif
+}
+
+void texture_streamer::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    queue_.clear();
+  }
+  wake_.notify_all();
+
+  for (auto& worker : workers_) worker.join();
+  workers_.clear();
+}
+
+void texture_streamer::set_cache(texture_cache cache) {
+  cache_ = std::move(cache);
+}
+
+void texture_streamer::reset(std::vector<encoded_image> images,
+                             const std::vector<GLuint>& textures,
+                             const std::vector<bool>& normal_maps) {
+  clear();
+
+  static const std::array<unsigned char, 4> white{{255, 255, 255, 255}};
+  static const std::array<unsigned char, 4> flat_normal{{128, 128, 255, 255}};
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.resize(textures.size());
+  for (size_t i = 0; i < textures.size(); ++i) {
+    entries_[i] = std::make_shared<entry>();
+    entries_[i]->texture = textures[i];
+    by_texture_[textures[i]] = entries_[i];
+
+    const bool normal_map = i < normal_maps.size() && normal_maps[i];
+    glBindTexture(GL_TEXTURE_2D, textures[i]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 normal_map ? flat_normal.data() : white.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  for (auto& image : images) {
+    if (image.index < 0 || size_t(image.index) >= entries_.size()) continue;
+    entries_[size_t(image.index)]->encoded = std::move(image);
+  }
+}
+
+void texture_streamer::request(GLuint texture) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const auto it = by_texture_.find(texture);
+  if (it == by_texture_.end() || it->second->state != status::placeholder)
+    return;
+
+  it->second->state = status::queued;
+  queue_.push_back(it->second);
+  lock.unlock();
+  wake_.notify_one();
+}
+
+void texture_streamer::update(texture_upload_queue& uploads) {
+  if (workers_.empty()) {
+    // Decode one image per frame on this thread
+    std::shared_ptr<entry> next;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!queue_.empty()) {
+        next = queue_.front();
+        queue_.pop_front();
+        next->state = status::decoding;
+      }
+    }
+    if (next) decode(*next);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& image : entries_) {
+    if (image->state == status::decoded) {
+      upload_preview(*image);
+      if (image->preview_level == 0) {
+        // Small enough to be done already
+        image->chain.clear();
+        image->state = status::resident;
+      } else {
+        // From the smallest to the largest, each finished level becomes the
+        // new base level
+        for (GLint level = image->preview_level - 1; level >= 0; --level) {
+          const auto& mip = image->chain.levels[size_t(level)];
+          uploads.stream_level(image->texture, level, mip.width, mip.height, 4,
+                               mip.pixels);
+        }
+        image->state = status::streaming;
+      }
+    } else if (image->state == status::streaming &&
+               !uploads.is_pending(image->texture)) {
+      image->chain.clear();
+      image->state = status::resident;
+    }
+  }
+}
+
+void texture_streamer::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_.clear();
+  by_texture_.clear();
+  entries_.clear();
+}
+
+size_t texture_streamer::nb_resident() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_t(std::count_if(entries_.begin(), entries_.end(),
+                              [](const std::shared_ptr<entry>& image) {
+                                return image->state == status::resident;
+                              }));
+}
+
+size_t texture_streamer::nb_textures() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void texture_streamer::work() {
+  for (;;) {
+    std::shared_ptr<entry> next;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+      if (stopping_) return;
+      next = queue_.front();
+      queue_.pop_front();
+      next->state = status::decoding;
+    }
+
+    // Only this thread touches an entry while it is decoding. If the asset is
+    // unloaded meanwhile, the entry dies with the last reference, here.
+    decode(*next);
+  }
+}
+
+void texture_streamer::decode(entry& image) {
+  mip_chain chain;
+  GLint preview_level = 0;
+  bool success = false;
+
+  try {
+    const auto hash =
+        fnv1a_64(image.encoded.bytes.data(), image.encoded.bytes.size());
+    if (!cache_.enabled() || !cache_.load(hash, chain)) {
+      decoded_image full;
+      decode_image(image.encoded, full);
+      build_mip_chain(std::move(full), chain);
+      if (cache_.enabled() && !cache_.store(hash, chain))
+        std::cerr << "Warn: could not write to the texture cache\n";
+    }
+
+    // The preview is the first level that is small enough
+    while (size_t(preview_level) + 1 < chain.levels.size() &&
+           (chain.levels[size_t(preview_level)].width > preview_size ||
+            chain.levels[size_t(preview_level)].height > preview_size))
+      ++preview_level;
+    success = true;
+  } catch (const std::exception& e) {
+    std::cerr << "Warn: " << e.what() << ", keeping a placeholder texture\n";
+  }
+
+  std::vector<unsigned char>().swap(image.encoded.bytes);
+
+  // Publish the result
+  std::lock_guard<std::mutex> lock(mutex_);
+  image.chain = std::move(chain);
+  image.preview_level = preview_level;
+  image.state = success ? status::decoded : status::failed;
+}
+
+void texture_streamer::upload_preview(entry& image) {
+  glBindTexture(GL_TEXTURE_2D, image.texture);
+
+  // Every level gets its storage. The ones larger than the preview receive
+  // their content later, until then the preview is the base of the texture
+  const auto& levels = image.chain.levels;
+  for (size_t i = 0; i < levels.size(); ++i) {
+    const bool now = GLint(i) >= image.preview_level;
+    glTexImage2D(GL_TEXTURE_2D, GLint(i), GL_RGBA, levels[i].width,
+                 levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 now ? levels[i].pixels : nullptr);
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, image.preview_level);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                  GLint(levels.size()) - 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,138 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#endif
+
+#ifndef __EMSCRIPTEN__
+#include <glad/glad.h>
+#else
+#include <GLES3/gl3.h>
+#endif
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "image_decoder.hh"
+#include "texture_cache.hh"
+#include "texture_upload_queue.hh"
+
+namespace gltf_insight {
+
+/// Decodes the images of the loaded asset only when something drawn uses
+/// them. Every texture starts as a 1x1 placeholder. Once a texture is
+/// requested, its image is decoded on a background thread, a small preview is
+/// put in its smallest mip levels right away, and the larger levels are then
+/// streamed through a `texture_upload_queue`. With a `texture_cache`, the
+/// decoded mip chains are kept on disk and decoding is skipped the next time.
+class texture_streamer {
+ public:
+  texture_streamer() = default;
+  texture_streamer(const texture_streamer&) = delete;
+  texture_streamer& operator=(const texture_streamer&) = delete;
+  ~texture_streamer();
+
+  /// Start the decoding threads. 0 means one per core, minus the one that
+  /// renders
+  void start(size_t nb_threads);
+
+  /// Stop and join the decoding threads
+  void stop();
+
+  /// Look up and store the decoded images in `cache`. Call before `start`
+  void set_cache(texture_cache cache);
+
+  /// Take over the images of a new asset. `textures[i]` is the texture of
+  /// image i, and gets a placeholder that looks like a flat normal map if
+  /// `normal_maps[i]` is true, or plain white otherwise. Needs a current
+  /// OpenGL context
+  void reset(std::vector<encoded_image> images,
+             const std::vector<GLuint>& textures,
+             const std::vector<bool>& normal_maps);
+
+  /// Ask for `texture` to be loaded. Textures that don't come from `reset`
+  /// are ignored
+  void request(GLuint texture);
+
+  /// Upload the previews of the images decoded since the last call, and queue
+  /// their full resolution content on `uploads`. Call once per frame, on the
+  /// thread that owns the OpenGL context
+  void update(texture_upload_queue& uploads);
+
+  /// Forget every image. Decoding in progress is dropped
+  void clear();
+
+  /// Number of textures that have their full resolution content on the GPU
+  size_t nb_resident() const;
+
+  size_t nb_textures() const;
+
+ private:
+  enum class status {
+    placeholder,
+    queued,
+    decoding,
+    decoded,
+    streaming,
+    resident,
+    failed
+  };
+
+  struct entry {
+    GLuint texture = 0;
+    status state = status::placeholder;
+    encoded_image encoded;
+    mip_chain chain;
+    GLint preview_level = 0;
+  };
+
+  std::vector<std::shared_ptr<entry>> entries_;
+  std::map<GLuint, std::shared_ptr<entry>> by_texture_;
+  std::deque<std::shared_ptr<entry>> queue_;
+  std::vector<std::thread> workers_;
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+  texture_cache cache_;
+
+  void work();
+  void decode(entry& image);
+  static void upload_preview(entry& image);
+};
+
+}  // namespace gltf_insight
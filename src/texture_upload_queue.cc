@@ -0,0 +1,186 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "texture_upload_queue.hh"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace gltf_insight;
+
+void texture_upload_queue::initialize(size_t nb_staging_buffers,
+                                      size_t staging_buffer_size) {
+  release();
+
+  buffer_size_ = staging_buffer_size;
+  ring_.resize(std::max<size_t>(1, nb_staging_buffers));
+  for (auto& buffer : ring_) {
+    glGenBuffers(1, &buffer.pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(buffer_size_), nullptr,
+                 GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  next_buffer_ = 0;
+}
+
+void texture_upload_queue::release() {
+  clear();
+  for (auto& buffer : ring_) {
+    if (buffer.fence) glDeleteSync(buffer.fence);
+    glDeleteBuffers(1, &buffer.pbo);
+  }
+  ring_.clear();
+  buffer_size_ = 0;
+}
+
+void texture_upload_queue::stream_level(GLuint texture, GLint level, int width,
+                                        int height, int components,
+                                        const unsigned char* pixels) {
+  if (!pixels || width <= 0 || height <= 0) return;
+
+  job new_job;
+  new_job.texture = texture;
+  new_job.level = level;
+  new_job.width = width;
+  new_job.height = height;
+  new_job.format = components == 4 ? GL_RGBA : GL_RGB;
+  new_job.row_size = size_t(width) * (components == 4 ? 4 : 3);
+  new_job.pixels = pixels;
+
+  pending_bytes_ += new_job.row_size * size_t(height);
+  jobs_.push_back(new_job);
+}
+
+bool texture_upload_queue::is_pending(GLuint texture) const {
+  return std::any_of(jobs_.begin(), jobs_.end(), [&](const job& queued) {
+    return queued.texture == texture;
+  });
+}
+
+void texture_upload_queue::upload(size_t byte_budget) {
+  if (jobs_.empty()) return;
+
+  // RGB rows are not always 4 bytes aligned
+  GLint unpack_alignment = 4;
+  glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpack_alignment);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  bool first_chunk = true;
+  while (!jobs_.empty() && (byte_budget > 0 || first_chunk)) {
+    staging_buffer* buffer = nullptr;
+    if (!ring_.empty()) {
+      buffer = &ring_[next_buffer_];
+      if (!is_available(*buffer)) break;
+      next_buffer_ = (next_buffer_ + 1) % ring_.size();
+    }
+
+    auto& current = jobs_.front();
+    const size_t sent = upload_rows(current, buffer, byte_budget);
+    byte_budget -= std::min(byte_budget, sent);
+    pending_bytes_ -= sent;
+    first_chunk = false;
+
+    if (current.next_row == current.height) {
+      finish(current);
+      jobs_.pop_front();
+    }
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, unpack_alignment);
+}
+
+void texture_upload_queue::clear() {
+  jobs_.clear();
+  pending_bytes_ = 0;
+}
+
+bool texture_upload_queue::is_available(staging_buffer& buffer) {
+  if (!buffer.fence) return true;
+
+  const GLenum status = glClientWaitSync(buffer.fence, 0, 0);
+  if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+    return false;
+
+  glDeleteSync(buffer.fence);
+  buffer.fence = nullptr;
+  return true;
+}
+
+size_t texture_upload_queue::upload_rows(job& current, staging_buffer* buffer,
+                                         size_t byte_budget) {
+  const size_t rows_left = size_t(current.height - current.next_row);
+  size_t nb_rows = std::min(rows_left, byte_budget / current.row_size);
+  if (buffer)
+    nb_rows = std::min(nb_rows, buffer_size_ / current.row_size);
+
+  // Rows larger than a staging buffer go through client memory
+  if (buffer && buffer_size_ < current.row_size) buffer = nullptr;
+  nb_rows = std::max<size_t>(1, nb_rows);
+
+  const size_t nb_bytes = nb_rows * current.row_size;
+  const unsigned char* source =
+      current.pixels + size_t(current.next_row) * current.row_size;
+
+  glBindTexture(GL_TEXTURE_2D, current.texture);
+  if (buffer) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->pbo);
+#ifdef __EMSCRIPTEN__
+    // WebGL has no buffer mapping
+    glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(nb_bytes), source);
+#else
+    // The fence guarantees the GPU is done with this buffer
+    void* destination = glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(nb_bytes),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+            GL_MAP_UNSYNCHRONIZED_BIT);
+    if (destination) {
+      std::memcpy(destination, source, nb_bytes);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    } else {
+      glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(nb_bytes), source);
+    }
+#endif
+    glTexSubImage2D(GL_TEXTURE_2D, current.level, 0, current.next_row,
+                    current.width, GLsizei(nb_rows), current.format,
+                    GL_UNSIGNED_BYTE, nullptr);
+    buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  } else {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glTexSubImage2D(GL_TEXTURE_2D, current.level, 0, current.next_row,
+                    current.width, GLsizei(nb_rows), current.format,
+                    GL_UNSIGNED_BYTE, source);
+  }
+
+  current.next_row += GLsizei(nb_rows);
+  return nb_bytes;
+}
+
+void texture_upload_queue::finish(const job& done) {
+  glBindTexture(GL_TEXTURE_2D, done.texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, done.level);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+}
@@ -0,0 +1,122 @@
+/*
+MIT License
+
+Copyright (c) 2019 Light Transport Entertainment Inc. And many contributors.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#endif
+
+#ifndef __EMSCRIPTEN__
+#include <glad/glad.h>
+#else
+#include <GLES3/gl3.h>
+#endif
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+namespace gltf_insight {
+
+/// Streams texture content to the GPU over several frames. Pixels are copied
+/// into a small ring of pixel buffer objects, and a buffer is only written
+/// again once its fence tells the GPU is done reading from it. Each call to
+/// `upload` sends a limited number of bytes, so the viewport keeps rendering
+/// while a texture heavy asset streams in.
+///
+/// Textures can be sampled while they are streaming: a level only becomes the
+/// base level of its texture once its last row is uploaded.
+class texture_upload_queue {
+ public:
+  texture_upload_queue() = default;
+  texture_upload_queue(const texture_upload_queue&) = delete;
+  texture_upload_queue& operator=(const texture_upload_queue&) = delete;
+
+  /// Create the staging buffers. Needs a current OpenGL context
+  void initialize(size_t nb_staging_buffers = 3,
+                  size_t staging_buffer_size = size_t(4) << 20);
+
+  /// Delete the staging buffers. Needs a current OpenGL context
+  void release();
+
+  /// Queue the upload of `level` of `texture`, that is already allocated
+  /// along with every smaller level. Once it is done, `level` becomes the base
+  /// level of the texture. `pixels` is read row by row until the upload is
+  /// done, so it has to stay valid until then, or until `clear()` is called
+  void stream_level(GLuint texture, GLint level, int width, int height,
+                    int components, const unsigned char* pixels);
+
+  /// True if `texture` still has data waiting to be uploaded
+  bool is_pending(GLuint texture) const;
+
+  /// Upload up to `byte_budget` bytes of queued texture data. At least one
+  /// row is sent if a staging buffer is free, so the queue always progresses
+  void upload(size_t byte_budget);
+
+  /// Forget every queued upload. Textures keep whatever was already sent
+  void clear();
+
+  bool empty() const { return jobs_.empty(); }
+
+  /// Number of bytes left to upload
+  size_t pending_bytes() const { return pending_bytes_; }
+
+ private:
+  struct job {
+    GLuint texture = 0;
+    GLint level = 0;
+    GLsizei width = 0;
+    GLsizei height = 0;
+    GLenum format = GL_RGBA;
+    size_t row_size = 0;
+    const unsigned char* pixels = nullptr;
+    GLsizei next_row = 0;
+  };
+
+  struct staging_buffer {
+    GLuint pbo = 0;
+    GLsync fence = nullptr;
+  };
+
+  std::deque<job> jobs_;
+  std::vector<staging_buffer> ring_;
+  size_t next_buffer_ = 0;
+  size_t buffer_size_ = 0;
+  size_t pending_bytes_ = 0;
+
+  /// True if the GPU is done with `buffer`. Never waits
+  static bool is_available(staging_buffer& buffer);
+
+  /// Upload rows of the first job, through `buffer` if there is one
+  size_t upload_rows(job& current, staging_buffer* buffer, size_t byte_budget);
+
+  static void finish(const job& done);
+};
+
+}  // namespace gltf_insight
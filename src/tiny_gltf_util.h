@@ -56,6 +56,17 @@ inline int find_main_mesh_node(const tinygltf::Model& model) {
   return -1;
 }
 
+// Integer member `key` of a JSON object, or `fallback` if it's missing. Numbers
+// written with a fractional part are truncated
+inline int get_int_value(const tinygltf::Value& object, const char* key,
+                         int fallback) {
+  if (!object.IsObject() || !object.Has(key)) return fallback;
+  const auto& value = object.Get(key);
+  if (value.IsInt()) return value.Get<int>();
+  if (value.IsReal()) return int(value.Get<double>());
+  return fallback;
+}
+
 namespace tinygltf {
 
 namespace util {
@@ -161,194 +172,6 @@ inline bool GetAnimationSamplerInputMinMax(
   }
 }
 
-// Utility function for decoding animation value
-inline float DecodeAnimationChannelValue(int8_t c) {
-  return std::max(float(c) / 127.0f, -1.0f);
-}
-inline float DecodeAnimationChannelValue(uint8_t c) {
-  return float(c) / 255.0f;
-}
-inline float DecodeAnimationChannelValue(int16_t c) {
-  return std::max(float(c) / 32767.0f, -1.0f);
-}
-inline float DecodeAnimationChannelValue(uint16_t c) {
-  return float(c) / 65525.0f;
-}
-
-inline const uint8_t* GetBufferAddress(const int i, const Accessor& accessor,
-                                       const BufferView& bufferViewObject,
-                                       const Buffer& buffer) {
-  if (i >= int(accessor.count)) return nullptr;
-
-  int byte_stride = accessor.ByteStride(bufferViewObject);
-  if (byte_stride == -1) {
-    return nullptr;
-  }
-
-  // TODO(syoyo): Bounds check.
-  const uint8_t* base_addr =
-      buffer.data.data() + bufferViewObject.byteOffset + accessor.byteOffset;
-  const uint8_t* addr = base_addr + i * byte_stride;
-  return addr;
-}
-
-inline bool DecodeScalarAnimationValue(const size_t i,
-                                       const tinygltf::Accessor& accessor,
-                                       const tinygltf::Model& model,
-                                       float* scalar) {
-  const BufferView& bufferView = model.bufferViews[size_t(accessor.bufferView)];
-  const Buffer& buffer = model.buffers[size_t(bufferView.buffer)];
-
-  const uint8_t* addr = GetBufferAddress(int(i), accessor, bufferView, buffer);
-  if (addr == nullptr) {
-    std::cerr << "Invalid glTF data?" << std::endl;
-    return false;
-  }
-
-  float value = 0.0f;
-
-  if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_BYTE) {
-    value =
-        DecodeAnimationChannelValue(*(reinterpret_cast<const int8_t*>(addr)));
-  } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-    value =
-        DecodeAnimationChannelValue(*(reinterpret_cast<const uint8_t*>(addr)));
-  } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_SHORT) {
-    value =
-        DecodeAnimationChannelValue(*(reinterpret_cast<const int16_t*>(addr)));
-  } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-    value =
-        DecodeAnimationChannelValue(*(reinterpret_cast<const uint16_t*>(addr)));
-  } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-    value = *(reinterpret_cast<const float*>(addr));
-  } else {
-    std::cerr << "??? Unknown componentType : "
-              << PrintComponentType(accessor.componentType) << std::endl;
-    return false;
-  }
-
-  (*scalar) = value;
-
-  return true;
-}
-
-inline bool DecodeTranslationAnimationValue(const size_t i,
-                                            const tinygltf::Accessor& accessor,
-                                            const tinygltf::Model& model,
-                                            float* xyz) {
-  if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
-    std::cerr << "`translation` must be float type." << std::endl;
-    return false;
-  }
-
-  const BufferView& bufferView = model.bufferViews[size_t(accessor.bufferView)];
-  const Buffer& buffer = model.buffers[size_t(bufferView.buffer)];
-
-  const uint8_t* addr = GetBufferAddress(int(i), accessor, bufferView, buffer);
-  if (addr == nullptr) {
-    std::cerr << "Invalid glTF data?" << std::endl;
-    return 0.0f;
-  }
-
-  const float* ptr = reinterpret_cast<const float*>(addr);
-
-  xyz[0] = *(ptr + 0);
-  xyz[1] = *(ptr + 1);
-  xyz[2] = *(ptr + 2);
-
-  return true;
-}
-
-inline bool DecodeScaleAnimationValue(const size_t i,
-                                      const tinygltf::Accessor& accessor,
-                                      const tinygltf::Model& model,
-                                      float* xyz) {
-  if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
-    std::cerr << "`scale` must be float type." << std::endl;
-    return false;
-  }
-
-  const BufferView& bufferView = model.bufferViews[size_t(accessor.bufferView)];
-  const Buffer& buffer = model.buffers[size_t(bufferView.buffer)];
-
-  const uint8_t* addr = GetBufferAddress(int(i), accessor, bufferView, buffer);
-  if (addr == nullptr) {
-    std::cerr << "Invalid glTF data?" << std::endl;
-    return 0.0f;
-  }
-
-  const float* ptr = reinterpret_cast<const float*>(addr);
-
-  xyz[0] = *(ptr + 0);
-  xyz[1] = *(ptr + 1);
-  xyz[2] = *(ptr + 2);
-
-  return true;
-}
-
-inline bool DecodeRotationAnimationValue(const size_t i,
-                                         const tinygltf::Accessor& accessor,
-                                         const tinygltf::Model& model,
-                                         float* xyzw) {
-  const BufferView& bufferView = model.bufferViews[size_t(accessor.bufferView)];
-  const Buffer& buffer = model.buffers[size_t(bufferView.buffer)];
-
-  const uint8_t* addr = GetBufferAddress(int(i), accessor, bufferView, buffer);
-  if (addr == nullptr) {
-    std::cerr << "Invalid glTF data?" << std::endl;
-    return false;
-  }
-
-  if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_BYTE) {
-    xyzw[0] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const int8_t*>(addr) + 0));
-    xyzw[1] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const int8_t*>(addr) + 1));
-    xyzw[2] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const int8_t*>(addr) + 2));
-    xyzw[3] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const int8_t*>(addr) + 3));
-  } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-    xyzw[0] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const uint8_t*>(addr) + 0));
-    xyzw[1] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const uint8_t*>(addr) + 1));
-    xyzw[2] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const uint8_t*>(addr) + 2));
-    xyzw[3] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const uint8_t*>(addr) + 3));
-  } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_SHORT) {
-    xyzw[0] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const int16_t*>(addr) + 0));
-    xyzw[1] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const int16_t*>(addr) + 1));
-    xyzw[2] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const int16_t*>(addr) + 2));
-    xyzw[3] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const int16_t*>(addr) + 3));
-  } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-    xyzw[0] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const uint16_t*>(addr) + 0));
-    xyzw[1] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const uint16_t*>(addr) + 1));
-    xyzw[2] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const uint16_t*>(addr) + 2));
-    xyzw[3] = DecodeAnimationChannelValue(
-        *(reinterpret_cast<const uint16_t*>(addr) + 3));
-  } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-    xyzw[0] = *(reinterpret_cast<const float*>(addr) + 0);
-    xyzw[1] = *(reinterpret_cast<const float*>(addr) + 1);
-    xyzw[2] = *(reinterpret_cast<const float*>(addr) + 2);
-    xyzw[3] = *(reinterpret_cast<const float*>(addr) + 3);
-  } else {
-    std::cerr << "??? Unknown componentType : "
-              << PrintComponentType(accessor.componentType) << std::endl;
-    return false;
-  }
-
-  return true;
-}
-
 }  // namespace util
 
 }  // namespace tinygltf